@@ -0,0 +1,377 @@
+// Replays an advertisement capture through the firmware's AWS detection path.
+//
+// Usage: adv_replay [-r] [-q] [-o out.advc] capture
+//
+//   capture    binary .advc file or a console log containing ADVCAP lines
+//   -r         replay at the original speed (default: as fast as possible)
+//   -q         do not print the ON/OFF timeline
+//   -o file    also write the records as a binary .advc capture
+//
+// Every record goes through aws_adv_prefilter(), the repeat cache and
+// aws_adv_decode(), like gap_event_handler() and the advert consumer, and then
+// through the firmware's own tool_presence on the shim's virtual clock, so
+// the power-off, scan and pre-start timers fire at the capture's times. It
+// also counts the esp_timer calls the old restart-per-advert timer would make
+// on the same capture against the lazily re-armed ones, and scores the
+// speculative pre-start cues (CONFIG_VACUUM_PRESTART_*) against the
+// activations that followed.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "aws_adv.h"
+#include "adv_capture.h"
+#include "tool_presence.h"
+#include "host_shim.h"
+
+typedef struct {
+    uint64_t records;
+    uint64_t reject_length;
+    uint64_t reject_mfg;
+    uint64_t reject_decode;
+    uint64_t aws;
+    uint64_t aws_repeats;           // Served from the repeat cache, not decoded
+    uint64_t aws_active;
+    uint64_t activations;
+    uint64_t on_time_us;
+    uint64_t process_ns;
+    uint64_t lag_max_us;
+    uint64_t lag_total_us;
+    uint64_t timer_calls_restart;   // esp_timer_stop + start_once per active advert
+} replay_stats_t;
+
+static replay_stats_t stats;
+static bool quiet = false;
+
+// The firmware's presence tracking, with pre-start but without spin-up
+static tool_presence_t presence;
+static int64_t tool_on_since_us = 0;
+static uint64_t last_idle_us = 0;
+static bool seen_idle = false;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int hex_nibble(int c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static void print_addr(const uint8_t *a)
+{
+    printf("%02x:%02x:%02x:%02x:%02x:%02x", a[0], a[1], a[2], a[3], a[4], a[5]);
+}
+
+// The edge events tool_presence posts to the state machine
+void vacuum_sm_post(vacuum_event_type_t type, int64_t timestamp_us)
+{
+    switch (type) {
+        case VACUUM_EVENT_TOOL_POWER_ON:
+            tool_on_since_us = timestamp_us;
+            stats.activations++;
+            break;
+        case VACUUM_EVENT_TOOL_POWER_OFF:
+            stats.on_time_us += (uint64_t)(timestamp_us - tool_on_since_us);
+            if (!quiet) {
+                printf("%12.6f s  TOOL OFF\n", timestamp_us / 1e6);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void power_off_timer_cb(void *arg)
+{
+    tool_presence_power_off_expired(&presence, esp_timer_get_time());
+}
+
+static void scan_timer_cb(void *arg)
+{
+    tool_presence_scan_expired(&presence, esp_timer_get_time());
+}
+
+static void prestart_timer_cb(void *arg)
+{
+    tool_presence_prestart_expired(&presence, esp_timer_get_time());
+}
+
+static void presence_init(void)
+{
+    tool_presence_timers_t timers;
+    esp_timer_create_args_t args = { .callback = power_off_timer_cb, .name = "power_off" };
+    esp_timer_create(&args, &timers.power_off);
+    args = (esp_timer_create_args_t){ .callback = scan_timer_cb, .name = "scan" };
+    esp_timer_create(&args, &timers.scan);
+    args = (esp_timer_create_args_t){ .callback = prestart_timer_cb, .name = "prestart" };
+    esp_timer_create(&args, &timers.prestart);
+
+    tool_presence_cfg_t cfg;
+    tool_presence_cfg_default(&cfg);
+    cfg.prestart_spinup = false;
+    tool_presence_init(&presence, &cfg, &timers);
+}
+
+static void replay_record(const adv_capture_rec_t *rec, uint64_t t_us)
+{
+    uint64_t start = now_ns();
+
+    stats.records++;
+    // Fires the timers due before this advert
+    shim_clock_advance_to((int64_t)t_us);
+
+    switch (aws_adv_prefilter(rec->data, rec->len)) {
+        case AWS_FILTER_REJECT_LENGTH:
+            stats.reject_length++;
+            break;
+        case AWS_FILTER_REJECT_MFG:
+            stats.reject_mfg++;
+            break;
+        default: {
+            bool was_on = presence.tool_powered;
+            tool_presence_seen_t seen = tool_presence_process(&presence, rec->addr, rec->rssi,
+                                                              rec->data, rec->len, (int64_t)t_us);
+            if (!seen.aws) {
+                stats.reject_decode++;
+                break;
+            }
+            stats.aws++;
+            stats.aws_repeats += seen.repeat;
+            if (!seen.adv.active) {
+                last_idle_us = t_us;
+                seen_idle = true;
+                break;
+            }
+            stats.aws_active++;
+            if (seen.may_drive) {
+                stats.timer_calls_restart += 2;
+            }
+            if (!was_on && presence.tool_powered && !quiet) {
+                printf("%12.6f s  TOOL ON   ", t_us / 1e6);
+                print_addr(rec->addr);
+                printf(" RSSI %d dBm", rec->rssi);
+                if (seen_idle) {
+                    // Upper bound on how late the radio saw the state change
+                    printf(", %.1f ms after last idle advert", (t_us - last_idle_us) / 1e3);
+                }
+                printf("\n");
+            }
+            break;
+        }
+    }
+
+    stats.process_ns += now_ns() - start;
+}
+
+static int load_file(const char *path, uint8_t **buf, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    *buf = malloc(size > 0 ? (size_t)size : 1);
+    *len = fread(*buf, 1, (size_t)size, f);
+    fclose(f);
+    return 0;
+}
+
+// Convert either capture flavour into a flat list of records
+static adv_capture_rec_t *parse_capture(const uint8_t *buf, size_t len, size_t *count)
+{
+    size_t cap = 1024, n = 0;
+    adv_capture_rec_t *recs = malloc(cap * sizeof(*recs));
+    const size_t magic_len = strlen(ADV_CAPTURE_MAGIC);
+
+    // The version byte also tells a binary capture from a log that starts
+    // with an "ADVCAP-BEGIN" line
+    if (len > magic_len && memcmp(buf, ADV_CAPTURE_MAGIC, magic_len) == 0 &&
+        buf[magic_len] == ADV_CAPTURE_VERSION) {
+        size_t pos = magic_len + 1;     // Skip magic and version byte
+        size_t used;
+        for (;;) {
+            if (n == cap) {
+                cap *= 2;
+                recs = realloc(recs, cap * sizeof(*recs));
+            }
+            used = adv_capture_decode(buf + pos, len - pos, &recs[n]);
+            if (used == 0) {
+                break;
+            }
+            pos += used;
+            n++;
+        }
+    } else {
+        const char *text = (const char *)buf;
+        const char *end = text + len;
+        const size_t prefix_len = strlen(ADV_CAPTURE_LINE_PREFIX);
+        while (text < end) {
+            const char *eol = memchr(text, '\n', (size_t)(end - text));
+            if (!eol) {
+                eol = end;
+            }
+            const char *p = text;
+            // The prefix may follow console noise on the same line
+            while (p + prefix_len <= eol && memcmp(p, ADV_CAPTURE_LINE_PREFIX, prefix_len) != 0) {
+                p++;
+            }
+            if (p + prefix_len <= eol) {
+                uint8_t raw[ADV_CAPTURE_MAX_REC_LEN];
+                size_t raw_len = 0;
+                p += prefix_len;
+                while (p + 1 < eol && raw_len < sizeof(raw) &&
+                       hex_nibble(p[0]) >= 0 && hex_nibble(p[1]) >= 0) {
+                    raw[raw_len++] = (uint8_t)(hex_nibble(p[0]) << 4 | hex_nibble(p[1]));
+                    p += 2;
+                }
+                if (n == cap) {
+                    cap *= 2;
+                    recs = realloc(recs, cap * sizeof(*recs));
+                }
+                if (adv_capture_decode(raw, raw_len, &recs[n]) != 0) {
+                    n++;
+                }
+            }
+            text = eol + 1;
+        }
+    }
+
+    *count = n;
+    return recs;
+}
+
+static int write_capture(const char *path, const adv_capture_rec_t *recs, size_t count)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    uint8_t buf[ADV_CAPTURE_MAX_REC_LEN];
+    fwrite(ADV_CAPTURE_MAGIC, 1, strlen(ADV_CAPTURE_MAGIC), f);
+    fputc(ADV_CAPTURE_VERSION, f);
+    for (size_t i = 0; i < count; i++) {
+        fwrite(buf, 1, adv_capture_encode(&recs[i], buf), f);
+    }
+    fclose(f);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    bool realtime = false;
+    const char *out_path = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "rqo:")) != -1) {
+        switch (opt) {
+            case 'r': realtime = true; break;
+            case 'q': quiet = true; break;
+            case 'o': out_path = optarg; break;
+            default:
+                fprintf(stderr, "Usage: %s [-r] [-q] [-o out.advc] capture\n", argv[0]);
+                return 2;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "Usage: %s [-r] [-q] [-o out.advc] capture\n", argv[0]);
+        return 2;
+    }
+
+    uint8_t *buf;
+    size_t len, count;
+    if (load_file(argv[optind], &buf, &len) != 0) {
+        return 1;
+    }
+    adv_capture_rec_t *recs = parse_capture(buf, len, &count);
+    free(buf);
+    if (count == 0) {
+        fprintf(stderr, "No records in %s\n", argv[optind]);
+        return 1;
+    }
+    if (out_path && write_capture(out_path, recs, count) != 0) {
+        return 1;
+    }
+
+    shim_clock_set_virtual(true);
+    presence_init();
+
+    // Capture timestamps are 32-bit; unwrap them into a monotonic timeline
+    // starting at zero
+    uint64_t t_us = 0;
+    uint64_t wall_start_ns = now_ns();
+    uint64_t replay_start_ns = wall_start_ns;
+
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0) {
+            t_us += (uint32_t)(recs[i].timestamp_us - recs[i - 1].timestamp_us);
+        }
+        if (realtime) {
+            uint64_t due_ns = replay_start_ns + t_us * 1000;
+            uint64_t now = now_ns();
+            if (now < due_ns) {
+                struct timespec ts = {
+                    .tv_sec = (time_t)((due_ns - now) / 1000000000ull),
+                    .tv_nsec = (long)((due_ns - now) % 1000000000ull)
+                };
+                nanosleep(&ts, NULL);
+            }
+            uint64_t lag_us = (now_ns() - due_ns) / 1000;
+            stats.lag_total_us += lag_us;
+            if (lag_us > stats.lag_max_us) {
+                stats.lag_max_us = lag_us;
+            }
+        }
+        replay_record(&recs[i], t_us);
+    }
+    // Let the pending power-off and pre-start windows run out
+    shim_clock_advance_to(INT64_MAX);
+    uint64_t wall_ns = now_ns() - wall_start_ns;
+
+    printf("\nReplayed %llu records covering %.3f s in %.3f s\n",
+           (unsigned long long)stats.records, t_us / 1e6, wall_ns / 1e9);
+    printf("Rejected length/mfg/decode: %llu/%llu/%llu\n",
+           (unsigned long long)stats.reject_length, (unsigned long long)stats.reject_mfg,
+           (unsigned long long)stats.reject_decode);
+    printf("AWS adverts: %llu (%llu active, %llu repeats skipped decode), activations: %llu, "
+           "tool on for %.3f s\n",
+           (unsigned long long)stats.aws, (unsigned long long)stats.aws_active,
+           (unsigned long long)stats.aws_repeats,
+           (unsigned long long)stats.activations, stats.on_time_us / 1e6);
+    printf("esp_timer calls: %llu restarting per advert, %u lazily re-armed incl. scan and pre-start "
+           "(%.1f/s vs %.1f/s)\n",
+           (unsigned long long)stats.timer_calls_restart, presence.timer_calls,
+           t_us ? stats.timer_calls_restart * 1e6 / t_us : 0.0,
+           t_us ? presence.timer_calls * 1e6 / t_us : 0.0);
+    printf("Pre-start (%d ms window, %d dB RSSI jump): %u cues, %u hits, %u misses, "
+           "%u activations uncued, mean lead %.1f ms\n",
+           CONFIG_VACUUM_PRESTART_WINDOW_MS, CONFIG_VACUUM_PRESTART_RSSI_JUMP_DB,
+           presence.prestart.cues, presence.prestart.hits, presence.prestart.misses,
+           (unsigned)(stats.activations - presence.prestart.hits),
+           presence.prestart.hits ? presence.prestart.lead_us / 1e3 / presence.prestart.hits : 0.0);
+    printf("Processing: %.1f ns/advert, %.0f adverts/s\n",
+           (double)stats.process_ns / stats.records,
+           stats.process_ns ? stats.records * 1e9 / stats.process_ns : 0.0);
+    if (realtime) {
+        printf("Scheduling lag: mean %.1f us, max %llu us\n",
+               (double)stats.lag_total_us / stats.records, (unsigned long long)stats.lag_max_us);
+    }
+
+    free(recs);
+    return 0;
+}
@@ -0,0 +1,224 @@
+// Host-side throughput benchmark for the AWS advertisement decoder.
+//
+// Usage: aws_bench [corpus.hex] [iterations]
+//
+// The corpus holds one hex-encoded AD payload per line ('#' starts a comment).
+// Every advert is decoded with aws_adv_decode() and, for comparison, with a
+// copy of the parser loop the firmware used before the AD iterator existed.
+// The manufacturer payloads are also matched on their own against the
+// firmware's signature table and a full 32-signature table.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "aws_adv.h"
+#include "aws_sig_wide.h"
+
+#define MAX_ADVERTS 4096
+#define MAX_AD_LEN  31
+#define MAX_MFG     (MAX_ADVERTS * 4)
+
+typedef struct {
+    uint8_t data[MAX_AD_LEN];
+    uint8_t len;
+} advert_t;
+
+static advert_t corpus[MAX_ADVERTS];
+static size_t corpus_len = 0;
+static ad_field_t mfg[MAX_MFG];
+static size_t mfg_len = 0;
+
+static int hex_nibble(int c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static int load_corpus(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), f) && corpus_len < MAX_ADVERTS) {
+        advert_t *adv = &corpus[corpus_len];
+        const char *p = line;
+        adv->len = 0;
+        if (*p == '#') {
+            continue;
+        }
+        while (hex_nibble(p[0]) >= 0 && hex_nibble(p[1]) >= 0 && adv->len < MAX_AD_LEN) {
+            adv->data[adv->len++] = (uint8_t)(hex_nibble(p[0]) << 4 | hex_nibble(p[1]));
+            p += 2;
+        }
+        if (adv->len > 0) {
+            corpus_len++;
+        }
+    }
+
+    fclose(f);
+    return 0;
+}
+
+// Parser loop as it was in process_aws_advertisement(), logging removed
+static int legacy_parse(const uint8_t *adv_data, uint16_t adv_len, int *active)
+{
+    int potential = 0;
+    *active = 0;
+    for (int i = 0; i < adv_len; ) {
+        uint8_t length = adv_data[i];
+        if (length == 0 || i + length >= adv_len) break;
+        uint8_t type = adv_data[i + 1];
+        const uint8_t *data = &adv_data[i + 2];
+        if (type == 0xFF && (length - 1) == 4) {
+            if (((data[0] & 0xfc) == 0xfc && (data[2] == 3 || data[2] == 6) && data[3] == 6)) {
+                potential = 1;
+                if (data[0] == 0xfd && data[1] == 0xaa) {
+                    *active = 1;
+                }
+            }
+        }
+        i += length + 1;
+    }
+    return potential;
+}
+
+// Manufacturer structures of the corpus, for the signature match alone
+static void collect_mfg(void)
+{
+    for (size_t i = 0; i < corpus_len; i++) {
+        ad_iter_t it;
+        ad_field_t field;
+        ad_iter_init(&it, corpus[i].data, corpus[i].len);
+        while (ad_iter_next(&it, &field) && mfg_len < MAX_MFG) {
+            if (field.type == AD_TYPE_MANUFACTURER) {
+                mfg[mfg_len++] = field;
+            }
+        }
+    }
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void report(const char *name, uint64_t elapsed_ns, uint64_t adverts,
+                   uint64_t present, uint64_t active)
+{
+    double secs = elapsed_ns / 1e9;
+    printf("%-10s %12.0f adverts/s %8.2f ns/advert  (present=%llu active=%llu)\n",
+           name, adverts / secs, (double)elapsed_ns / adverts,
+           (unsigned long long)present, (unsigned long long)active);
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = argc > 1 ? argv[1] : CORPUS_DIR "/shop_floor.hex";
+    long iterations = argc > 2 ? strtol(argv[2], NULL, 0) : 200000;
+
+    if (load_corpus(path) != 0 || corpus_len == 0) {
+        fprintf(stderr, "No adverts loaded from %s\n", path);
+        return 1;
+    }
+
+    uint64_t total = (uint64_t)corpus_len * (uint64_t)iterations;
+    printf("Corpus: %s (%zu adverts), %ld iterations\n", path, corpus_len, iterations);
+
+    // Cross-check the decoder against the legacy loop before timing anything
+    for (size_t i = 0; i < corpus_len; i++) {
+        aws_adv_t aws;
+        int legacy_active;
+        int legacy_present = legacy_parse(corpus[i].data, corpus[i].len, &legacy_active);
+        aws_adv_decode(corpus[i].data, corpus[i].len, &aws);
+        if (aws.present != (legacy_present != 0) || aws.active != (legacy_active != 0)) {
+            fprintf(stderr, "Mismatch on advert %zu\n", i);
+            return 1;
+        }
+    }
+
+    uint64_t present = 0, active = 0;
+    uint64_t start = now_ns();
+    for (long it = 0; it < iterations; it++) {
+        for (size_t i = 0; i < corpus_len; i++) {
+            aws_adv_t aws;
+            if (aws_adv_decode(corpus[i].data, corpus[i].len, &aws)) {
+                present++;
+                active += aws.active;
+            }
+        }
+    }
+    report("aws_adv", now_ns() - start, total, present, active);
+
+    // Staged pipeline as used by gap_event_handler(): pre-filter, then decode
+    uint64_t rejected = 0;
+    present = active = 0;
+    start = now_ns();
+    for (long it = 0; it < iterations; it++) {
+        for (size_t i = 0; i < corpus_len; i++) {
+            aws_adv_t aws;
+            if (aws_adv_prefilter(corpus[i].data, corpus[i].len) != AWS_FILTER_PASS) {
+                rejected++;
+            } else if (aws_adv_decode(corpus[i].data, corpus[i].len, &aws)) {
+                present++;
+                active += aws.active;
+            }
+        }
+    }
+    report("staged", now_ns() - start, total, present, active);
+    printf("%-10s %llu of %llu adverts rejected before decode\n", "",
+           (unsigned long long)rejected, (unsigned long long)total);
+
+    present = active = 0;
+    start = now_ns();
+    for (long it = 0; it < iterations; it++) {
+        for (size_t i = 0; i < corpus_len; i++) {
+            int a;
+            if (legacy_parse(corpus[i].data, corpus[i].len, &a)) {
+                present++;
+                active += a;
+            }
+        }
+    }
+    report("legacy", now_ns() - start, total, present, active);
+
+    // Signature match alone: the wide table's first four signatures are the
+    // firmware's, so they must agree bit for bit
+    collect_mfg();
+    for (size_t i = 0; i < mfg_len; i++) {
+        uint32_t fw = aws_sig_match(aws_sig_table, mfg[i].data, mfg[i].len);
+        uint32_t wide = aws_sig_match(&aws_sig_wide, mfg[i].data, mfg[i].len);
+        if (fw != (wide & ((1u << aws_sig_table->count) - 1))) {
+            fprintf(stderr, "Signature tables disagree on manufacturer payload %zu\n", i);
+            return 1;
+        }
+    }
+    const aws_sig_table_t *tables[] = { aws_sig_table, &aws_sig_wide };
+    for (size_t k = 0; k < 2; k++) {
+        uint64_t matched = 0;
+        start = now_ns();
+        for (long it = 0; it < iterations; it++) {
+            for (size_t i = 0; i < mfg_len; i++) {
+                matched += aws_sig_match(tables[k], mfg[i].data, mfg[i].len) != 0;
+            }
+        }
+        uint64_t elapsed = now_ns() - start;
+        char name[16];
+        snprintf(name, sizeof(name), "match/%u", tables[k]->count);
+        printf("%-10s %12.0f payloads/s %6.2f ns/payload (%zu manufacturer payloads, matched=%llu)\n",
+               name, mfg_len * (double)iterations / (elapsed / 1e9),
+               (double)elapsed / (mfg_len * (double)iterations), mfg_len, (unsigned long long)matched);
+    }
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+// Turns the firmware's deferred log records back into text.
+//
+// Usage: dlog_decode [monitor.log]
+//
+// Reads an `idf.py monitor` log (or stdin) and copies it to stdout, replacing
+// every "DLOG <hex>" line with the formatted message from dlog_msgs.h, in the
+// same layout the firmware prints with CONFIG_DEFERRED_LOG_TEXT.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "dlog.h"
+
+static int hex_nibble(int c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Decode the record after the prefix; false if the line is not a record
+static bool decode_line(const char *p, dlog_rec_t *rec)
+{
+    uint8_t raw[DLOG_MAX_REC_LEN];
+    size_t len = 0;
+
+    while (len < sizeof(raw) && hex_nibble(p[0]) >= 0 && hex_nibble(p[1]) >= 0) {
+        raw[len++] = (uint8_t)(hex_nibble(p[0]) << 4 | hex_nibble(p[1]));
+        p += 2;
+    }
+    return dlog_decode(raw, len, rec) == len && len > 0;
+}
+
+static void print_record(const dlog_rec_t *rec)
+{
+    const char *fmt = dlog_format(rec->id);
+
+    printf("D (%lu) dlog: ", (unsigned long)(rec->timestamp_us / 1000));
+    if (fmt) {
+        printf(fmt, (unsigned)rec->args[0], (unsigned)rec->args[1],
+               (unsigned)rec->args[2], (unsigned)rec->args[3]);
+    } else {
+        printf("unknown message %u", rec->id);
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    FILE *in = stdin;
+    char line[1024];
+    unsigned long records = 0;
+
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [monitor.log]\n", argv[0]);
+        return 1;
+    }
+    if (argc == 2) {
+        in = fopen(argv[1], "r");
+        if (!in) {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    while (fgets(line, sizeof(line), in)) {
+        // The prefix may follow console noise on the same line
+        const char *p = strstr(line, DLOG_LINE_PREFIX);
+        dlog_rec_t rec = { 0 };
+        if (p && decode_line(p + strlen(DLOG_LINE_PREFIX), &rec)) {
+            if (p > line) {
+                printf("%.*s\n", (int)(p - line), line);
+            }
+            print_record(&rec);
+            records++;
+        } else {
+            fputs(line, stdout);
+        }
+    }
+
+    if (in != stdin) {
+        fclose(in);
+    }
+    fprintf(stderr, "%lu records decoded\n", records);
+    return 0;
+}
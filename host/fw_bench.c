@@ -0,0 +1,273 @@
+// Microbenchmarks for the firmware hot paths, built against the host shims.
+//
+// Usage: fw_bench [iterations]
+//
+// Reports the per-event cost of the advert parser and repeat hash, the advert ring hand-off,
+// the vacuum state machine, the tool registry, the input sampler, the reactor's timer heap and
+// deferred logging versus snprintf.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "host_shim.h"
+#include "aws_adv.h"
+#include "adv_ring.h"
+#include "vacuum_sm.h"
+#include "input.h"
+#include "reactor.h"
+#include "tool_registry.h"
+#include "dlog.h"
+
+#define RELAY_GPIO 16
+
+typedef void (*bench_fn_t)(uint32_t i);
+
+static volatile uint32_t sink;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void run(const char *name, const char *unit, bench_fn_t fn, uint32_t iterations)
+{
+    // Warm up caches and branch predictors first
+    for (uint32_t i = 0; i < iterations / 10; i++) {
+        fn(i);
+    }
+    uint64_t start = now_ns();
+    for (uint32_t i = 0; i < iterations; i++) {
+        fn(i);
+    }
+    uint64_t elapsed = now_ns() - start;
+    printf("%-22s %8.2f ns/%s  %12.0f %s/s\n", name, (double)elapsed / iterations, unit,
+           iterations * 1e9 / elapsed, unit);
+}
+
+// ---------------------------------------------------------------------------
+// Advert parser: mostly non-AWS traffic with a few tool adverts mixed in
+
+static const uint8_t adv_phone[] = {
+    0x02, 0x01, 0x1a, 0x02, 0x0a, 0x0c, 0x0a, 0xff, 0x4c, 0x00, 0x10, 0x05, 0x03, 0x1c, 0x0f, 0x7a, 0x4a
+};
+static const uint8_t adv_beacon[] = {
+    0x02, 0x01, 0x06, 0x03, 0x03, 0xaa, 0xfe, 0x0d, 0x16, 0xaa, 0xfe, 0x10, 0xf8, 0x03,
+    0x67, 0x6f, 0x6f, 0x67, 0x6c, 0x65, 0x07
+};
+static const uint8_t adv_aws_idle[] = { 0x02, 0x01, 0x06, 0x05, 0xff, 0xfc, 0x00, 0x03, 0x06 };
+static const uint8_t adv_aws_active[] = { 0x02, 0x01, 0x06, 0x05, 0xff, 0xfd, 0xaa, 0x03, 0x06 };
+
+static const struct {
+    const uint8_t *data;
+    uint8_t len;
+} adv_mix[8] = {
+    { adv_phone, sizeof(adv_phone) }, { adv_beacon, sizeof(adv_beacon) },
+    { adv_phone, sizeof(adv_phone) }, { adv_aws_idle, sizeof(adv_aws_idle) },
+    { adv_beacon, sizeof(adv_beacon) }, { adv_phone, sizeof(adv_phone) },
+    { adv_beacon, sizeof(adv_beacon) }, { adv_aws_active, sizeof(adv_aws_active) },
+};
+
+static void bench_adv_parse(uint32_t i)
+{
+    aws_adv_t aws;
+    const uint8_t *data = adv_mix[i & 7].data;
+    uint8_t len = adv_mix[i & 7].len;
+    if (aws_adv_prefilter(data, len) == AWS_FILTER_PASS && aws_adv_decode(data, len, &aws)) {
+        sink += aws.active;
+    }
+}
+
+// AWS adverts only: full decode versus the repeat check that lets an
+// unchanged payload skip it
+static const uint8_t *const adv_aws[2] = { adv_aws_idle, adv_aws_active };
+
+static void bench_aws_decode(uint32_t i)
+{
+    aws_adv_t aws;
+    if (aws_adv_prefilter(adv_aws[i & 1], sizeof(adv_aws_idle)) == AWS_FILTER_PASS &&
+        aws_adv_decode(adv_aws[i & 1], sizeof(adv_aws_idle), &aws)) {
+        sink += aws.active;
+    }
+}
+
+static const uint8_t bench_ring_addr[6] = { 0xc4, 0x7e, 0x12, 0x34, 0x56, 0x78 };
+
+static void bench_aws_hash(uint32_t i)
+{
+    sink += aws_adv_hash(adv_aws[i & 1], sizeof(adv_aws_idle));
+}
+
+// ---------------------------------------------------------------------------
+// Advert ring: the host task's copy of an AWS advert plus, every 8 adverts,
+// the consumer draining the batch
+
+static adv_ring_t ring;
+
+static void bench_adv_ring(uint32_t i)
+{
+    bool was_empty;
+    sink += adv_ring_push(&ring, i, bench_ring_addr, -60, adv_aws[i & 1], sizeof(adv_aws_idle),
+                          &was_empty);
+    if ((i & 7) == 7) {
+        const adv_ring_rec_t *rec;
+        while ((rec = adv_ring_peek(&ring)) != NULL) {
+            sink += rec->len;
+            adv_ring_pop(&ring);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Vacuum state machine: tool detected, power on, power off, tool lost
+
+static vacuum_sm_t sm;
+static const vacuum_event_type_t sm_events[4] = {
+    VACUUM_EVENT_TOOL_DETECTED,
+    VACUUM_EVENT_TOOL_POWER_ON,
+    VACUUM_EVENT_TOOL_POWER_OFF,
+    VACUUM_EVENT_TOOL_LOST,
+};
+
+void vacuum_sm_post(vacuum_event_type_t type, int64_t timestamp_us)
+{
+    vacuum_event_t ev = { .type = type, .timestamp_us = timestamp_us };
+    vacuum_sm_handle_event(&sm, &ev);
+}
+
+static void bench_vacuum_sm(uint32_t i)
+{
+    vacuum_event_t ev = { .type = sm_events[i & 3], .timestamp_us = esp_timer_get_time() };
+    vacuum_sm_handle_event(&sm, &ev);
+    sink += sm.state;
+}
+
+// ---------------------------------------------------------------------------
+// Tool registry: adverts from 48 addresses into 32 slots, so the working set
+// keeps evicting, with a liveness sweep every 64 adverts
+
+#define REG_BENCH_TOOLS 48
+
+static tool_registry_t registry;
+static uint8_t reg_addrs[REG_BENCH_TOOLS][6];
+
+static void bench_registry(uint32_t i)
+{
+    int64_t now = (int64_t)i * 1000;
+    const uint8_t *addr = reg_addrs[(i * 7) % REG_BENCH_TOOLS];
+    tool_entry_t *t = tool_registry_seen(&registry, addr, -60, (i & 3) == 0, now, 1000000);
+    sink += t->active;
+    if ((i & 63) == 0) {
+        tool_registry_expire(&registry, now);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Input sampler: two inputs, each 5 ms sample a step through a 64-sample
+// cycle of contact bounce, press, bounce and release
+
+static input_t inputs;
+static const input_cfg_t input_cfgs[2] = {
+    { .gpio = 4, .active_low = true, .long_ms = 2000 },
+    { .gpio = 5, .active_low = true },
+};
+
+static void input_event(uint8_t input, input_event_t event, uint32_t now_ms, void *ctx)
+{
+    sink += event;
+}
+
+static void bench_input(uint32_t i)
+{
+    uint32_t phase = i & 63;
+    bool pressed = phase < 8 || (phase >= 32 && phase < 40) ? (i * 0x9E3779B1u) >> 31 : phase < 32;
+    sink += input_sample(&inputs, pressed ? 3 : 0, i * INPUT_SAMPLE_MS);
+}
+
+// ---------------------------------------------------------------------------
+// Reactor timer heap: eight periodic timers with different periods; each step
+// runs the earliest one, which re-arms itself
+
+#define REACTOR_BENCH_TIMERS 8
+
+static reactor_t reactor;
+static reactor_timer_t reactor_timers[REACTOR_BENCH_TIMERS];
+
+static void reactor_bench_cb(reactor_timer_t *timer, int64_t now_us)
+{
+    reactor_timer_arm(&reactor, timer, now_us + 1000 + 137 * (int64_t)(uintptr_t)timer->ctx);
+}
+
+static void bench_reactor(uint32_t i)
+{
+    sink += reactor_run_timer(&reactor, reactor_next_deadline(&reactor));
+}
+
+// ---------------------------------------------------------------------------
+// Per-advert debug log: deferred record versus formatting the same message.
+// The ring is drained every 64 records, as the drain task would.
+
+static const uint8_t bench_addr[6] = { 0xc4, 0x7e, 0x12, 0x34, 0x56, 0x78 };
+
+static void discard_record(const dlog_rec_t *rec, void *ctx)
+{
+    sink += rec->id;
+}
+
+static void bench_dlog(uint32_t i)
+{
+    const uint8_t *a = bench_addr;
+    DLOG(DLOG_AWS_ADVERT,
+         (uint32_t)a[0] << 16 | a[1] << 8 | a[2], (uint32_t)a[3] << 16 | a[4] << 8 | a[5],
+         (uint32_t)-60, 0xfdaa0306u + (i & 1));
+    if ((i & 63) == 63) {
+        dlog_drain(discard_record, NULL);
+    }
+}
+
+static void bench_snprintf(uint32_t i)
+{
+    char buf[128];
+    const uint8_t *a = bench_addr;
+    sink += snprintf(buf, sizeof(buf),
+                     "D (%lu) AWS_BLE_MANAGER: AWS tool %02x:%02x:%02x:%02x:%02x:%02x, RSSI: %d dBm, data: %02x,%02x,%02x,%02x",
+                     (unsigned long)i, a[0], a[1], a[2], a[3], a[4], a[5], -60, 0xfd, 0xaa, 0x03, 0x06 + (i & 1));
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iterations = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 10000000;
+
+    vacuum_sm_init(&sm, RELAY_GPIO);
+    sm.auto_mode = true;
+    shim_clock_set_virtual(true);
+    input_init(&inputs, input_cfgs, 2, input_event, NULL);
+    adv_ring_init(&ring);
+    reactor_init(&reactor);
+    for (int t = 0; t < REACTOR_BENCH_TIMERS; t++) {
+        reactor_timers[t] = (reactor_timer_t)REACTOR_TIMER_INIT(reactor_bench_cb, (void *)(uintptr_t)t, 0);
+        reactor_timer_arm(&reactor, &reactor_timers[t], t * 100);
+    }
+    tool_registry_init(&registry);
+    for (int t = 0; t < REG_BENCH_TOOLS; t++) {
+        uint8_t addr[6] = { 0xc4, 0x7e, 0x12, (uint8_t)(t * 37), (uint8_t)(t >> 8), (uint8_t)t };
+        memcpy(reg_addrs[t], addr, 6);
+    }
+
+    printf("%u iterations per benchmark\n", iterations);
+    run("advert parse", "advert", bench_adv_parse, iterations);
+    run("AWS advert decode", "advert", bench_aws_decode, iterations);
+    run("AWS advert repeat hash", "advert", bench_aws_hash, iterations);
+    run("advert ring hand-off", "advert", bench_adv_ring, iterations);
+    run("vacuum state machine", "event", bench_vacuum_sm, iterations);
+    run("tool registry", "advert", bench_registry, iterations);
+    run("input sample", "sample", bench_input, iterations);
+    run("reactor timer", "timer", bench_reactor, iterations);
+    run("deferred log record", "record", bench_dlog, iterations);
+    run("snprintf log line", "line", bench_snprintf, iterations);
+    return 0;
+}
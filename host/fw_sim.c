@@ -0,0 +1,1001 @@
+// Virtual-time simulation of the firmware's control path.
+//
+// Usage: fw_sim [options] [scenario]
+//
+//   scenario   timeline of tool, button and radio events (format below). ADVCAP
+//              lines from a console capture are read too and delivered as
+//              received adverts at their capture time. Without a scenario a
+//              synthetic shop day is generated.
+//   -t hours   length of the run (default 24, one shop day per 24 h); a
+//              scenario runs until shortly after its last line unless given
+//   -s seed    seed of the synthetic day and of the radio model (default 1)
+//   -l pct     advert loss on top of the scan duty cycle (default 5)
+//   -p us      delay of every event posted to the reactor (default 0)
+//   -q         statistics only, no timeline
+//   -w file    write the scenario that was run, in the scenario format
+//
+// Scenario lines; '#' starts a comment, times are [[h:]m:]s[.frac]:
+//
+//   <time> tool <name> off|idle|active   stops advertising / advertises idle / running
+//   <time> button <ms>                   button held for ms, with contact bounce
+//   <time> noise <ms>                    relay EMI ringing on the button line
+//   <time> dropout <ms>                  no advert gets through
+//
+// vacuum_sm.c, input.c, aws_adv.c and tool_presence.c (with the tool
+// registry and scan policy behind it) run unchanged on the shim's virtual
+// clock. esp_timer callbacks fire from the shim's timer list; the reactor core
+// schedules tool adverts, button samples and the scenario itself, and a queue
+// stands in for the reactor's. Nothing waits in real time, so a day takes well
+// under a second. Adverts take the BLE manager's path: prefilter, repeat cache,
+// decode, tool_presence_advert(). Tools advertise every SIM_ADV_MS plus the
+// random advDelay and are heard with the duty cycle of the current scan
+// profile, less the loss.
+//
+// stdout is the relay, LED and state timeline followed by latency statistics,
+// all in virtual time and reproducible for a seed, so runs of two firmware
+// versions can be diffed. Wall-clock speed goes to stderr.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include "host_shim.h"
+#include "esp_timer.h"
+#include "vacuum_sm.h"
+#include "input.h"
+#include "reactor.h"
+#include "tool_presence.h"
+#include "aws_adv.h"
+#include "adv_capture.h"
+
+#define SIM_TOOLS_MAX           8
+#define SIM_ADV_MS              100         // Tool advertising interval
+#define SIM_ADV_DELAY_US        10000       // Random advDelay added to each interval
+#define SIM_RELAY_GPIO          16
+#define SIM_BUTTON_GPIO         4
+#define SIM_BUTTON_LONG_MS      2000        // As main.c
+#define SIM_BOUNCE_EDGES        5           // Contact bounce per button transition (odd)
+#define SIM_BOUNCE_US           400         // ... one edge this often
+#define SIM_NOISE_US            200         // EMI ringing: one edge this often
+#define SIM_RUN_ON_US           60000000    // Simulated past the last scenario line
+#define SIM_QUEUE_LEN           64
+
+// ---------------------------------------------------------------------------
+// Scenario
+
+typedef enum {
+    STEP_TOOL,
+    STEP_BUTTON,
+    STEP_NOISE,
+    STEP_DROPOUT,
+    STEP_ADVERT,
+} step_op_t;
+
+typedef enum {
+    TOOL_OFF,
+    TOOL_IDLE,
+    TOOL_ACTIVE,
+} tool_mode_t;
+
+static const char *const mode_names[] = { "off", "idle", "active" };
+
+typedef struct {
+    int64_t t_us;
+    step_op_t op;
+    uint8_t tool;               // STEP_TOOL
+    uint8_t mode;               // STEP_TOOL: tool_mode_t
+    uint32_t ms;                // STEP_BUTTON, STEP_NOISE, STEP_DROPOUT
+    uint32_t rec;               // STEP_ADVERT: index into captured
+} step_t;
+
+typedef struct {
+    int64_t t_us;
+    bool level;
+} edge_t;
+
+typedef struct {
+    char name[32];
+    uint8_t addr[6];
+    tool_mode_t mode;
+    reactor_timer_t adv_timer;
+    bool run_served;            // Current active run switched the vacuum on
+    bool run_auto;              // ... and automatic mode was on when it began
+} sim_tool_t;
+
+typedef struct {
+    int64_t *us;
+    size_t n, cap;
+} series_t;
+
+static step_t *steps;
+static size_t step_count, step_cap, step_next;
+static adv_capture_rec_t *captured;
+static size_t captured_count, captured_cap;
+static edge_t *edges;
+static size_t edge_count, edge_cap, edge_next;
+static sim_tool_t tools[SIM_TOOLS_MAX];
+static uint8_t tool_count;
+
+static void *grow(void *p, size_t *cap, size_t size)
+{
+    *cap = *cap ? *cap * 2 : 1024;
+    p = realloc(p, *cap * size);
+    if (!p) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+static step_t *add_step(int64_t t_us, step_op_t op)
+{
+    if (step_count == step_cap) {
+        steps = grow(steps, &step_cap, sizeof(*steps));
+    }
+    steps[step_count] = (step_t){ .t_us = t_us, .op = op };
+    return &steps[step_count++];
+}
+
+static void add_edge(int64_t t_us, bool level)
+{
+    if (edge_count == edge_cap) {
+        edges = grow(edges, &edge_cap, sizeof(*edges));
+    }
+    edges[edge_count++] = (edge_t){ .t_us = t_us, .level = level };
+}
+
+static int tool_id(const char *name)
+{
+    for (int i = 0; i < tool_count; i++) {
+        if (strcmp(tools[i].name, name) == 0) {
+            return i;
+        }
+    }
+    if (tool_count == SIM_TOOLS_MAX) {
+        return -1;
+    }
+    sim_tool_t *t = &tools[tool_count];
+    snprintf(t->name, sizeof(t->name), "%s", name);
+    // Random static address, one per tool
+    memcpy(t->addr, (const uint8_t[]){ 0xc4, 0x4d, 0x41, 0x4b, 0x00, (uint8_t)tool_count }, 6);
+    return tool_count++;
+}
+
+// Deterministic on every platform, unlike rand()
+static uint64_t rng_state = 1;
+
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (uint32_t)((rng_state * 2685821657736338717ull) >> 32);
+}
+
+static uint32_t rng_range(uint32_t lo, uint32_t hi)
+{
+    return lo + rng() % (hi - lo + 1);
+}
+
+static void fmt_time(char *buf, size_t size, int64_t t_us)
+{
+    int64_t ms = t_us / 1000;
+    snprintf(buf, size, "%02lld:%02lld:%02lld.%03lld", (long long)(ms / 3600000),
+             (long long)(ms / 60000 % 60), (long long)(ms / 1000 % 60), (long long)(ms % 1000));
+}
+
+// [[h:]m:]s[.frac]
+static bool parse_time(const char *s, int64_t *t_us)
+{
+    double total = 0;
+    char *end;
+    for (;;) {
+        double v = strtod(s, &end);
+        if (end == s) {
+            return false;
+        }
+        total = total * 60 + v;
+        if (*end != ':') {
+            break;
+        }
+        s = end + 1;
+    }
+    *t_us = (int64_t)(total * 1e6 + 0.5);
+    return *end == '\0';
+}
+
+static int hex_nibble(int c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static void load_advcap(const char *hex, int64_t *last_us, int64_t *wrap_us)
+{
+    uint8_t buf[ADV_CAPTURE_MAX_REC_LEN];
+    size_t len = 0;
+    adv_capture_rec_t rec;
+
+    while (len < sizeof(buf) && hex_nibble(hex[0]) >= 0 && hex_nibble(hex[1]) >= 0) {
+        buf[len++] = (uint8_t)(hex_nibble(hex[0]) << 4 | hex_nibble(hex[1]));
+        hex += 2;
+    }
+    if (!adv_capture_decode(buf, len, &rec)) {
+        return;
+    }
+
+    // Capture timestamps are the low 32 bits of esp_timer_get_time()
+    int64_t t_us = *wrap_us + rec.timestamp_us;
+    if (t_us < *last_us) {
+        *wrap_us += (int64_t)1 << 32;
+        t_us += (int64_t)1 << 32;
+    }
+    *last_us = t_us;
+
+    if (captured_count == captured_cap) {
+        captured = grow(captured, &captured_cap, sizeof(*captured));
+    }
+    captured[captured_count] = rec;
+    add_step(t_us, STEP_ADVERT)->rec = (uint32_t)captured_count++;
+}
+
+static int load_scenario(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    char line[512], when[32], what[16], arg1[32], arg2[16];
+    int64_t last_us = 0, wrap_us = 0;
+    int lineno = 0;
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        const char *cap = strstr(line, ADV_CAPTURE_LINE_PREFIX);
+        if (cap) {
+            load_advcap(cap + strlen(ADV_CAPTURE_LINE_PREFIX), &last_us, &wrap_us);
+            continue;
+        }
+        char *hash = strchr(line, '#');
+        if (hash) {
+            *hash = '\0';
+        }
+        int n = sscanf(line, "%31s %15s %31s %15s", when, what, arg1, arg2);
+        if (n <= 0) {
+            continue;
+        }
+
+        int64_t t_us;
+        bool ok = n >= 3 && parse_time(when, &t_us);
+        if (ok && strcmp(what, "tool") == 0 && n == 4) {
+            int id = tool_id(arg1);
+            int mode = -1;
+            for (int m = 0; m < 3; m++) {
+                if (strcmp(arg2, mode_names[m]) == 0) {
+                    mode = m;
+                }
+            }
+            ok = id >= 0 && mode >= 0;
+            if (ok) {
+                step_t *s = add_step(t_us, STEP_TOOL);
+                s->tool = (uint8_t)id;
+                s->mode = (uint8_t)mode;
+            }
+        } else if (ok && n == 3 && (strcmp(what, "button") == 0 || strcmp(what, "noise") == 0 ||
+                                    strcmp(what, "dropout") == 0)) {
+            step_op_t op = what[0] == 'b' ? STEP_BUTTON : what[0] == 'n' ? STEP_NOISE : STEP_DROPOUT;
+            add_step(t_us, op)->ms = (uint32_t)strtoul(arg1, NULL, 10);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            fprintf(stderr, "%s:%d: cannot parse: %s", path, lineno, line);
+            fclose(f);
+            return -1;
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+static void save_scenario(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    char when[32];
+    uint8_t buf[ADV_CAPTURE_MAX_REC_LEN];
+
+    if (!f) {
+        perror(path);
+        return;
+    }
+    fprintf(f, "# fw_sim scenario\n");
+    for (size_t i = 0; i < step_count; i++) {
+        const step_t *s = &steps[i];
+        fmt_time(when, sizeof(when), s->t_us);
+        switch (s->op) {
+            case STEP_TOOL:
+                fprintf(f, "%s  tool %s %s\n", when, tools[s->tool].name, mode_names[s->mode]);
+                break;
+            case STEP_BUTTON:
+            case STEP_NOISE:
+            case STEP_DROPOUT:
+                fprintf(f, "%s  %s %u\n", when,
+                        s->op == STEP_BUTTON ? "button" : s->op == STEP_NOISE ? "noise" : "dropout", s->ms);
+                break;
+            case STEP_ADVERT: {
+                size_t len = adv_capture_encode(&captured[s->rec], buf);
+                fprintf(f, "%s", ADV_CAPTURE_LINE_PREFIX);
+                for (size_t k = 0; k < len; k++) {
+                    fprintf(f, "%02x", buf[k]);
+                }
+                fprintf(f, "\n");
+                break;
+            }
+        }
+    }
+    fclose(f);
+}
+
+static void add_tool_step(int64_t t_us, int tool, tool_mode_t mode)
+{
+    step_t *st = add_step(t_us, STEP_TOOL);
+    st->tool = (uint8_t)tool;
+    st->mode = (uint8_t)mode;
+}
+
+// A shop day from day_us on: batteries in around 7:00, automatic mode
+// switched on, each tool used in bursts between breaks, lunch, a battery
+// swap, a few radio dropouts and relay EMI on the button line, an
+// accidental double tap, automatic mode off at 17:00
+static void synthesize_day(int64_t day_us)
+{
+    static const struct {
+        const char *name;
+        uint32_t run_min_s, run_max_s, gap_mean_s;
+    } kinds[] = {
+        { "saw", 5, 60, 300 },
+        { "sander", 30, 600, 600 },
+        { "drill", 2, 20, 180 },
+    };
+    const int64_t s = 1000000, h = 3600 * s;
+    const int64_t open_us = day_us + 7 * h, close_us = day_us + 17 * h;
+    const int64_t lunch_us = day_us + 12 * h, lunch_end_us = lunch_us + 45 * 60 * s;
+
+    add_step(open_us + 15 * 60 * s, STEP_BUTTON)->ms = 150;
+    for (int k = 0; k < 3; k++) {
+        int id = tool_id(kinds[k].name);
+        int64_t t = open_us + rng_range(0, 600) * s;
+        bool swapped = false;
+
+        add_tool_step(t, id, TOOL_IDLE);
+        for (;;) {
+            t += rng_range(20, 2 * kinds[k].gap_mean_s) * s;
+            int64_t run = rng_range(kinds[k].run_min_s, kinds[k].run_max_s) * s;
+            if (t + run >= close_us) {
+                break;
+            }
+            if (t < lunch_end_us && t + run > lunch_us) {
+                t = lunch_end_us;
+                continue;
+            }
+            add_tool_step(t, id, TOOL_ACTIVE);
+            add_tool_step(t + run, id, TOOL_IDLE);
+            t += run;
+            if (!swapped && t > day_us + 14 * h) {
+                // Battery swap: the tool is gone for a minute or two
+                swapped = true;
+                add_tool_step(t + 5 * s, id, TOOL_OFF);
+                t += rng_range(60, 120) * s;
+                add_tool_step(t, id, TOOL_IDLE);
+            }
+        }
+        add_tool_step(close_us + rng_range(300, 1800) * s, id, TOOL_OFF);
+    }
+
+    add_step(lunch_us + 5 * 60 * s, STEP_BUTTON)->ms = 100;
+    add_step(lunch_us + 5 * 60 * s + 220000, STEP_BUTTON)->ms = 100;
+    for (int64_t t = open_us; t < close_us; t += h) {
+        if (rng() % 2) {
+            add_step(t + rng_range(0, 3599) * s, STEP_DROPOUT)->ms = rng_range(1000, 40000);
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        add_step(open_us + rng_range(3600, 9 * 3600) * s, STEP_NOISE)->ms = rng_range(20, 200);
+    }
+    add_step(close_us, STEP_BUTTON)->ms = 150;
+}
+
+static int cmp_step(const void *a, const void *b)
+{
+    const step_t *x = a, *y = b;
+    if (x->t_us != y->t_us) {
+        return (x->t_us > y->t_us) - (x->t_us < y->t_us);
+    }
+    return (x > y) - (x < y);
+}
+
+static int cmp_edge(const void *a, const void *b)
+{
+    const edge_t *x = a, *y = b;
+    if (x->t_us != y->t_us) {
+        return (x->t_us > y->t_us) - (x->t_us < y->t_us);
+    }
+    return (x > y) - (x < y);
+}
+
+static int cmp_i64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Button line, active low: bounce on every transition, EMI as a burst of edges
+static void build_edges(void)
+{
+    for (size_t i = 0; i < step_count; i++) {
+        const step_t *s = &steps[i];
+        if (s->op == STEP_BUTTON) {
+            int64_t up_us = s->t_us + (int64_t)s->ms * 1000;
+            for (int k = 0; k < SIM_BOUNCE_EDGES; k++) {
+                add_edge(s->t_us + k * SIM_BOUNCE_US, k % 2);
+                add_edge(up_us + k * SIM_BOUNCE_US, !(k % 2));
+            }
+        } else if (s->op == STEP_NOISE) {
+            int64_t n = (int64_t)s->ms * 1000 / SIM_NOISE_US;
+            for (int64_t k = 0; k < n; k++) {
+                add_edge(s->t_us + k * SIM_NOISE_US, k % 2);
+            }
+            add_edge(s->t_us + n * SIM_NOISE_US, true);
+        }
+    }
+    // Stable, so a transition's edges stay in order
+    qsort(edges, edge_count, sizeof(*edges), cmp_edge);
+}
+
+// ---------------------------------------------------------------------------
+// Firmware under test, wired up as in main.c and bt_manager.c
+
+static reactor_t reactor;
+static vacuum_sm_t sm;
+static input_t inputs;
+static tool_presence_t presence;
+static int64_t post_delay_us = 0;
+static unsigned loss_pct = 5;
+static bool quiet = false;
+
+static const input_cfg_t input_cfgs[] = {
+    { .gpio = SIM_BUTTON_GPIO, .active_low = true,
+      .long_ms = SIM_BUTTON_LONG_MS },
+};
+
+// Radio
+static int64_t last_active_rx_us;
+static int64_t dropout_until_us;
+
+// Scoring
+static int64_t cause_on_us, cause_off_us, press_us;
+static series_t lat_on, lat_off, lat_toggle;
+static struct {
+    uint64_t sent, heard, decoded;
+    uint32_t dropouts, presses, relay_writes, relay_changes, led_changes, lost;
+    uint32_t missed_runs, runs, pairings;
+} st;
+
+static void series_add(series_t *s, int64_t us)
+{
+    if (s->n == s->cap) {
+        s->us = grow(s->us, &s->cap, sizeof(*s->us));
+    }
+    s->us[s->n++] = us;
+}
+
+static void timeline(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+static void timeline(const char *fmt, ...)
+{
+    char when[32];
+    va_list ap;
+
+    if (quiet) {
+        return;
+    }
+    fmt_time(when, sizeof(when), esp_timer_get_time());
+    printf("%s  ", when);
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+    printf("\n");
+}
+
+// Stand-in for the reactor queue: callbacks run in order, post_delay_us late
+static reactor_msg_t queue[SIM_QUEUE_LEN];
+static int64_t queue_due[SIM_QUEUE_LEN];
+static unsigned queue_head, queue_len;
+
+static void sim_post(reactor_fn_t fn, void *ctx, uint32_t arg, int64_t timestamp_us)
+{
+    if (queue_len == SIM_QUEUE_LEN) {
+        reactor.stats.dropped++;
+        return;
+    }
+    unsigned i = (queue_head + queue_len++) % SIM_QUEUE_LEN;
+    queue[i] = (reactor_msg_t){ .fn = fn, .ctx = ctx, .arg = arg, .timestamp_us = timestamp_us };
+    queue_due[i] = esp_timer_get_time() + post_delay_us;
+    if (queue_len > reactor.stats.queue_max) {
+        reactor.stats.queue_max = (uint16_t)queue_len;
+    }
+}
+
+static void drain_queue(int64_t now_us)
+{
+    while (queue_len && queue_due[queue_head] <= now_us) {
+        reactor_msg_t msg = queue[queue_head];
+        queue_head = (queue_head + 1) % SIM_QUEUE_LEN;
+        queue_len--;
+        reactor_dispatch(&reactor, &msg);
+    }
+}
+
+static void vacuum_sm_event(void *ctx, uint32_t type, int64_t timestamp_us)
+{
+    vacuum_event_t ev = { .type = (vacuum_event_type_t)type, .timestamp_us = timestamp_us };
+    vacuum_state_t prev = sm.state;
+    uint32_t writes = sm.relay_writes;
+    uint8_t level = sm.relay_level;
+    int64_t now = esp_timer_get_time();
+
+    vacuum_sm_handle_event(&sm, &ev);
+
+    if (sm.state != prev) {
+        timeline("STATE %s -> %s", vacuum_state_name(prev), vacuum_state_name(sm.state));
+        if (sm.state == VACUUM_STATE_ACTIVE) {
+            for (int i = 0; i < tool_count; i++) {
+                tools[i].run_served |= tools[i].mode == TOOL_ACTIVE;
+            }
+        }
+        tool_presence_follow_state(&presence, sm.state, now);
+    }
+    if (sm.relay_writes == writes) {
+        return;
+    }
+    st.relay_writes += sm.relay_writes - writes;
+    if (sm.relay_level == level) {
+        return;
+    }
+    st.relay_changes++;
+
+    // Score the write against what caused it
+    char cause[48] = "";
+    if (type == VACUUM_EVENT_AUTO_TOGGLE && press_us) {
+        series_add(&lat_toggle, now - press_us);
+        snprintf(cause, sizeof(cause), "  (button +%.1f ms)", (now - press_us) / 1e3);
+        press_us = 0;
+    } else if (sm.state == VACUUM_STATE_ACTIVE && prev != VACUUM_STATE_ACTIVE && cause_on_us) {
+        series_add(&lat_on, now - cause_on_us);
+        snprintf(cause, sizeof(cause), "  (tool on +%.1f ms)", (now - cause_on_us) / 1e3);
+        cause_on_us = 0;
+    } else if (prev == VACUUM_STATE_ACTIVE && sm.state == VACUUM_STATE_STANDBY) {
+        int64_t from = cause_off_us ? cause_off_us : last_active_rx_us;
+        series_add(&lat_off, now - from);
+        snprintf(cause, sizeof(cause), "  (tool off +%.1f ms)", (now - from) / 1e3);
+        cause_off_us = 0;
+    }
+    timeline("RELAY %u%s", sm.relay_level, cause);
+}
+
+void vacuum_sm_post(vacuum_event_type_t type, int64_t timestamp_us)
+{
+    if (type == VACUUM_EVENT_TOOL_POWER_ON && !cause_on_us && sm.auto_mode) {
+        cause_on_us = timestamp_us;     // A captured advert is its own cause
+    } else if (type == VACUUM_EVENT_TOOL_LOST) {
+        st.lost++;
+    }
+    sim_post(vacuum_sm_event, NULL, (uint32_t)type, timestamp_us);
+}
+
+// LEDs: every change of each channel; one-shots hand the LED back when done
+static void led_oneshot_end(reactor_timer_t *timer, int64_t now_us);
+static reactor_timer_t led_oneshot_timer = REACTOR_TIMER_INIT(led_oneshot_end, NULL, 0);
+static led_pattern_t led_shown[LED_CHANNEL_COUNT];
+
+static const char *led_pattern_name(led_pattern_t p)
+{
+    static const char *const names[] = {
+        "OFF", "ON", "SLOW_BLINK", "FAST_BLINK", "PULSE", "DOUBLE_FLASH",
+    };
+    return p < LED_PATTERN_COUNT ? names[p] : "?";
+}
+
+static void led_show(led_channel_t channel, led_pattern_t pattern)
+{
+    if (led_shown[channel] != pattern) {
+        led_shown[channel] = pattern;
+        st.led_changes++;
+        timeline("LED %s %s", channel == LED_CHANNEL_STATUS ? "status" : "aux", led_pattern_name(pattern));
+    }
+}
+
+static void led_hook(led_channel_t channel, led_pattern_t pattern)
+{
+    const led_pattern_desc_t *desc = led_pattern_desc(pattern);
+
+    if (channel == LED_CHANNEL_STATUS && desc->count) {
+        reactor_timer_arm(&reactor, &led_oneshot_timer,
+                          esp_timer_get_time() + (int64_t)desc->count * desc->period_ms * 1000);
+    } else if (channel == LED_CHANNEL_STATUS && reactor_timer_armed(&led_oneshot_timer)) {
+        return;     // Shown when the one-shot ends
+    }
+    led_show(channel, pattern);
+}
+
+static void led_oneshot_end(reactor_timer_t *timer, int64_t now_us)
+{
+    led_show(LED_CHANNEL_STATUS, shim_led_pattern());
+}
+
+// The BLE manager's timer callbacks and advert consumer, without the locking
+static void power_off_timer_cb(void *arg)
+{
+    tool_presence_power_off_expired(&presence, esp_timer_get_time());
+}
+
+static void scan_timer_cb(void *arg)
+{
+    tool_presence_scan_expired(&presence, esp_timer_get_time());
+}
+
+static void ble_advert(const uint8_t *addr, int8_t rssi, const uint8_t *data, size_t len, int64_t now)
+{
+    if (aws_adv_prefilter(data, len) != AWS_FILTER_PASS) {
+        return;
+    }
+    tool_presence_seen_t seen = tool_presence_process(&presence, addr, rssi, data, (uint8_t)len, now);
+    st.decoded += seen.aws;
+    if (seen.aws && seen.may_drive && seen.adv.active) {
+        last_active_rx_us = now;
+    }
+}
+
+// Radio: a tool's adverts, heard with the scan duty cycle less the loss
+static void tool_advert(reactor_timer_t *timer, int64_t now_us)
+{
+    sim_tool_t *t = timer->ctx;
+    const scan_params_t *scan = scan_profile_params(presence.scan.profile);
+    uint32_t heard_per_64k = (uint32_t)((uint64_t)65536 * scan->window / scan->itvl * (100 - loss_pct) / 100);
+
+    st.sent++;
+    if (now_us >= dropout_until_us && (rng() & 0xffff) < heard_per_64k) {
+        bool active = t->mode == TOOL_ACTIVE;
+        uint8_t kind = (t - tools) % 2 ? 0x06 : 0x03;
+        const uint8_t adv[] = {
+            0x02, AD_TYPE_FLAGS, 0x06,
+            0x05, AD_TYPE_MANUFACTURER, active ? 0xfd : 0xfc, active ? 0xaa : 0x00, kind, 0x06,
+        };
+        st.heard++;
+        ble_advert(t->addr, (int8_t)(-55 - 3 * (t - tools)), adv, sizeof(adv), now_us);
+    }
+    reactor_timer_arm(&reactor, timer, timer->deadline_us + SIM_ADV_MS * 1000 + rng() % SIM_ADV_DELAY_US);
+}
+
+// Button: input.c's sampling, with the level interrupt and reactor timer of
+// its ESP half
+static void sample_timer_cb(reactor_timer_t *timer, int64_t now_us);
+static reactor_timer_t sample_timer = REACTOR_TIMER_INIT(sample_timer_cb, NULL, 0);
+static bool irq_enabled = true;
+
+static void sample_start(void *ctx, uint32_t arg, int64_t timestamp_us)
+{
+    if (!reactor_timer_armed(&sample_timer)) {
+        reactor_timer_arm(&reactor, &sample_timer, timestamp_us + INPUT_SAMPLE_MS * 1000);
+    }
+}
+
+// Level interrupt: fires while the line is away from its debounced level
+static void line_irq(int64_t now_us)
+{
+    bool active = gpio_get_level(SIM_BUTTON_GPIO) == 0;
+    if (irq_enabled && active != inputs.in[0].active) {
+        irq_enabled = false;
+        inputs.isr_count++;
+        sim_post(sample_start, NULL, 0, now_us);
+    }
+}
+
+static void sample_timer_cb(reactor_timer_t *timer, int64_t now_us)
+{
+    uint32_t mask = gpio_get_level(SIM_BUTTON_GPIO) == 0;
+    if (input_sample(&inputs, mask, (uint32_t)(now_us / 1000))) {
+        int64_t next = timer->deadline_us + INPUT_SAMPLE_MS * 1000;
+        reactor_timer_arm(&reactor, timer, next > now_us ? next : now_us + INPUT_SAMPLE_MS * 1000);
+    } else {
+        irq_enabled = true;
+        line_irq(now_us);
+    }
+}
+
+static void line_edge(reactor_timer_t *timer, int64_t now_us)
+{
+    while (edge_next < edge_count && edges[edge_next].t_us <= now_us) {
+        shim_gpio_set_input(SIM_BUTTON_GPIO, edges[edge_next++].level);
+        line_irq(now_us);
+    }
+    if (edge_next < edge_count) {
+        reactor_timer_arm(&reactor, timer, edges[edge_next].t_us);
+    }
+}
+
+static reactor_timer_t line_timer = REACTOR_TIMER_INIT(line_edge, NULL, 0);
+
+static void run_command(void *ctx, uint32_t cmd, int64_t timestamp_us)
+{
+    int n = tool_presence_pair_active(&presence, timestamp_us);
+    st.pairings++;
+    timeline("PAIR %d running tools", n);
+    led_set_pattern(LED_PATTERN_DOUBLE_FLASH);
+}
+
+// Gestures as in main.c
+static void input_event(uint8_t input, input_event_t event, uint32_t now_ms, void *ctx)
+{
+    switch (event) {
+        case INPUT_EVENT_SHORT:
+            vacuum_sm_post(VACUUM_EVENT_AUTO_TOGGLE, esp_timer_get_time());
+            break;
+        case INPUT_EVENT_LONG:
+            sim_post(run_command, NULL, 'p', esp_timer_get_time());
+            break;
+        default:
+            break;
+    }
+}
+
+// Scenario steps due now
+static void tool_set_mode(sim_tool_t *t, tool_mode_t mode, int64_t now_us)
+{
+    if (mode == t->mode) {
+        return;
+    }
+    if (t->mode == TOOL_ACTIVE) {
+        if (!t->run_served && t->run_auto) {
+            st.missed_runs++;
+            timeline("MISSED run of %s", t->name);
+        }
+        bool others = false;
+        for (int i = 0; i < tool_count; i++) {
+            others |= &tools[i] != t && tools[i].mode == TOOL_ACTIVE;
+        }
+        if (!others) {
+            cause_off_us = now_us;
+            cause_on_us = 0;
+        }
+    }
+    if (mode == TOOL_ACTIVE) {
+        st.runs++;
+        t->run_served = sm.state == VACUUM_STATE_ACTIVE;
+        t->run_auto = sm.auto_mode;
+        if (!cause_on_us && sm.auto_mode && sm.state != VACUUM_STATE_ACTIVE) {
+            cause_on_us = now_us;
+        }
+        cause_off_us = 0;
+    }
+    if (mode == TOOL_OFF) {
+        reactor_timer_cancel(&reactor, &t->adv_timer);
+    } else if (t->mode == TOOL_OFF) {
+        reactor_timer_arm(&reactor, &t->adv_timer, now_us + rng() % (SIM_ADV_MS * 1000));
+    }
+    t->mode = mode;
+}
+
+static void script_step(reactor_timer_t *timer, int64_t now_us)
+{
+    while (step_next < step_count && steps[step_next].t_us <= now_us) {
+        const step_t *s = &steps[step_next++];
+        switch (s->op) {
+            case STEP_TOOL:
+                timeline("> tool %s %s", tools[s->tool].name, mode_names[s->mode]);
+                tool_set_mode(&tools[s->tool], (tool_mode_t)s->mode, now_us);
+                break;
+            case STEP_BUTTON:
+                timeline("> button %u ms", s->ms);
+                st.presses++;
+                press_us = now_us + (int64_t)s->ms * 1000;     // A short press acts on release
+                break;
+            case STEP_NOISE:
+                timeline("> noise %u ms", s->ms);
+                break;
+            case STEP_DROPOUT:
+                timeline("> dropout %u ms", s->ms);
+                st.dropouts++;
+                if (now_us + (int64_t)s->ms * 1000 > dropout_until_us) {
+                    dropout_until_us = now_us + (int64_t)s->ms * 1000;
+                }
+                break;
+            case STEP_ADVERT: {
+                const adv_capture_rec_t *rec = &captured[s->rec];
+                st.sent++;
+                st.heard++;
+                ble_advert(rec->addr, rec->rssi, rec->data, rec->len, now_us);
+                break;
+            }
+        }
+    }
+    if (step_next < step_count) {
+        reactor_timer_arm(&reactor, timer, steps[step_next].t_us);
+    }
+}
+
+static reactor_timer_t script_timer = REACTOR_TIMER_INIT(script_step, NULL, 0);
+
+// ---------------------------------------------------------------------------
+
+static void init_firmware(void)
+{
+    esp_timer_create_args_t power_off_args = { .callback = power_off_timer_cb, .name = "power_off" };
+    esp_timer_create_args_t scan_args = { .callback = scan_timer_cb, .name = "scan" };
+    tool_presence_timers_t timers = { 0 };     // No pre-start
+    tool_presence_cfg_t cfg;
+
+    shim_clock_set_virtual(true);
+    reactor_init(&reactor);
+    shim_led_set_hook(led_hook);
+    led_init(CONFIG_LED_GPIO, CONFIG_LED_AUX_GPIO);
+    vacuum_sm_init(&sm, SIM_RELAY_GPIO);
+    gpio_set_level(SIM_RELAY_GPIO, 0);
+    esp_timer_create(&power_off_args, &timers.power_off);
+    esp_timer_create(&scan_args, &timers.scan);
+    tool_presence_cfg_default(&cfg);
+    tool_presence_init(&presence, &cfg, &timers);
+
+    shim_gpio_set_input(SIM_BUTTON_GPIO, 1);
+    input_init(&inputs, input_cfgs, 1, input_event, NULL);
+    inputs.in[0].long_sent = true;
+
+    for (int i = 0; i < tool_count; i++) {
+        tools[i].adv_timer = (reactor_timer_t)REACTOR_TIMER_INIT(tool_advert, &tools[i], 0);
+    }
+    if (step_count) {
+        reactor_timer_arm(&reactor, &script_timer, steps[0].t_us);
+    }
+    if (edge_count) {
+        reactor_timer_arm(&reactor, &line_timer, edges[0].t_us);
+    }
+}
+
+// Earliest of reactor timers, esp_timers and queued events, then run it all
+static void run(int64_t end_us)
+{
+    for (;;) {
+        int64_t next = reactor_next_deadline(&reactor);
+        int64_t t = shim_timer_next_deadline();
+        if (t < next) {
+            next = t;
+        }
+        if (queue_len && queue_due[queue_head] < next) {
+            next = queue_due[queue_head];
+        }
+        if (next > end_us) {
+            break;
+        }
+        if (next < esp_timer_get_time()) {
+            next = esp_timer_get_time();
+        }
+
+        reactor.stats.wakeups++;
+        shim_clock_advance_to(next);
+        drain_queue(next);
+        while (reactor_run_timer(&reactor, next)) {
+            drain_queue(next);
+        }
+    }
+    shim_clock_advance_to(end_us);
+}
+
+static void report_series(const char *name, series_t *s, const char *extra)
+{
+    if (s->n == 0) {
+        printf("# %-13s n=0%s\n", name, extra);
+        return;
+    }
+    qsort(s->us, s->n, sizeof(*s->us), cmp_i64);
+    printf("# %-13s n=%zu  p50 %.1f ms  p95 %.1f ms  max %.1f ms%s\n", name, s->n,
+           s->us[s->n / 2] / 1e3, s->us[(s->n * 95) / 100 < s->n ? (s->n * 95) / 100 : s->n - 1] / 1e3,
+           s->us[s->n - 1] / 1e3, extra);
+}
+
+static double wall_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL, *out = NULL;
+    double hours = 0;
+    unsigned seed = 1;
+    char extra[64], span[32];
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            hours = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seed = (unsigned)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            loss_pct = (unsigned)strtoul(argv[++i], NULL, 0);
+            loss_pct = loss_pct > 100 ? 100 : loss_pct;
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            post_delay_us = strtoll(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-q") == 0) {
+            quiet = true;
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            out = argv[++i];
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "Usage: %s [-t hours] [-s seed] [-l loss%%] [-p us] [-q] [-w out.txt] [scenario]\n",
+                    argv[0]);
+            return 1;
+        } else {
+            path = argv[i];
+        }
+    }
+    rng_state = 0x9e3779b97f4a7c15ull ^ seed;
+
+    int64_t end_us;
+    if (path) {
+        if (load_scenario(path) != 0) {
+            return 1;
+        }
+        qsort(steps, step_count, sizeof(*steps), cmp_step);
+        end_us = hours > 0 ? (int64_t)(hours * 3600e6)
+                 : (step_count ? steps[step_count - 1].t_us : 0) + SIM_RUN_ON_US;
+    } else {
+        end_us = (int64_t)((hours > 0 ? hours : 24) * 3600e6);
+        for (int64_t day_us = 0; day_us < end_us; day_us += 24 * 3600000000LL) {
+            synthesize_day(day_us);
+        }
+        qsort(steps, step_count, sizeof(*steps), cmp_step);
+    }
+    if (out) {
+        save_scenario(out);
+    }
+    build_edges();
+    init_firmware();
+    // The radio draws its own sequence, the same for a scenario file and
+    // the synthetic day it was written from
+    rng_state = 0x2545f4914f6cdd1dull ^ seed;
+
+    double start = wall_s();
+    run(end_us);
+    double elapsed = wall_s() - start;
+
+    fmt_time(span, sizeof(span), end_us);
+    printf("# %s simulated, %u tools, seed %u, loss %u%%, post delay %lld us\n",
+           span, tool_count, seed, loss_pct, (long long)post_delay_us);
+    printf("# adverts       sent %llu, heard %llu (%.1f%%), AWS decoded %llu, %u dropouts\n",
+           (unsigned long long)st.sent, (unsigned long long)st.heard,
+           st.sent ? 100.0 * st.heard / st.sent : 0.0, (unsigned long long)st.decoded, st.dropouts);
+    printf("# button        %u presses, %lu interrupts, %lu samples, %lu edges -> %lu changes, %lu storms\n",
+           st.presses, (unsigned long)inputs.isr_count, (unsigned long)inputs.samples,
+           (unsigned long)inputs.edges, (unsigned long)inputs.changes, (unsigned long)inputs.storms);
+    printf("# relay         %u writes, %u changes; %u LED changes; %u scan profile switches\n",
+           st.relay_writes, st.relay_changes, st.led_changes, presence.scan.switches);
+    snprintf(extra, sizeof(extra), "  (%u runs, %u missed)", st.runs, st.missed_runs);
+    report_series("tool on", &lat_on, extra);
+    snprintf(extra, sizeof(extra), "  (%u tool lost)", st.lost);
+    report_series("tool off", &lat_off, extra);
+    report_series("button", &lat_toggle, "");
+    printf("# reactor       %lu wakeups, %lu timers, %lu messages, queue max %u, heap max %u\n",
+           (unsigned long)reactor.stats.wakeups, (unsigned long)reactor.stats.timers,
+           (unsigned long)reactor.stats.messages, reactor.stats.queue_max, reactor.stats.heap_max);
+
+    fprintf(stderr, "fw_sim: %.2f h of firmware time in %.3f s (%.0fx real time)\n",
+            end_us / 3600e6, elapsed, elapsed > 0 ? end_us / 1e6 / elapsed : 0.0);
+    return 0;
+}
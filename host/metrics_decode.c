@@ -0,0 +1,132 @@
+// Turns the firmware's METRICS frames into a readable report.
+//
+// Usage: metrics_decode [monitor.log]
+//
+// Reads an `idf.py monitor` log (or stdin) and prints a report for every
+// "METRICS <hex>" line. Rates and CPU shares cover the interval since the
+// previous frame in the log, or the time since boot for the first one. CPU
+// shares are of one core, so on a dual-core chip they add up to 200%.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "metrics.h"
+
+static int hex_nibble(int c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Decode the frame after the prefix; false if the line holds no valid frame
+static bool decode_line(const char *p, metrics_t *m)
+{
+    uint8_t raw[METRICS_MAX_LEN];
+    size_t len = 0;
+
+    while (len < sizeof(raw) && hex_nibble(p[0]) >= 0 && hex_nibble(p[1]) >= 0) {
+        raw[len++] = (uint8_t)(hex_nibble(p[0]) << 4 | hex_nibble(p[1]));
+        p += 2;
+    }
+    return metrics_decode(raw, len, m) == len && len > 0;
+}
+
+static const metrics_task_t *find_task(const metrics_t *m, const char *name)
+{
+    for (int i = 0; i < m->ntasks; i++) {
+        if (strcmp(m->tasks[i].name, name) == 0) {
+            return &m->tasks[i];
+        }
+    }
+    return NULL;
+}
+
+static uint32_t per_s(uint32_t delta, uint32_t ms)
+{
+    return ms ? (uint32_t)((uint64_t)delta * 1000 / ms) : 0;
+}
+
+// prev is NULL for the first frame or after a reboot
+static void print_report(const metrics_t *m, const metrics_t *prev)
+{
+    uint32_t ms = prev ? m->uptime_ms - prev->uptime_ms : m->uptime_ms;
+    uint32_t adverts = prev ? m->adverts - prev->adverts : m->adverts;
+    uint32_t calls = prev ? m->timer_calls - prev->timer_calls : m->timer_calls;
+    // Unsigned differences survive one wrap of the 32-bit run-time counter
+    uint32_t total = prev ? m->runtime_total - prev->runtime_total : m->runtime_total;
+
+    printf("Metrics at %lu.%03lu s (%s %lu ms)\n",
+           (unsigned long)(m->uptime_ms / 1000), (unsigned long)(m->uptime_ms % 1000),
+           prev ? "interval" : "since boot,", (unsigned long)ms);
+    printf("  Heap: %lu free (min %lu), internal %lu free (min %lu, largest block %lu)\n",
+           (unsigned long)m->heap_free, (unsigned long)m->heap_min_free,
+           (unsigned long)m->internal_free, (unsigned long)m->internal_min_free,
+           (unsigned long)m->internal_largest);
+    printf("  Adverts: %lu (%lu/s), rejected length/mfg/decode: %lu/%lu/%lu, ring drops: %lu\n",
+           (unsigned long)m->adverts, (unsigned long)per_s(adverts, ms),
+           (unsigned long)m->reject_length, (unsigned long)m->reject_mfg,
+           (unsigned long)m->reject_decode, (unsigned long)m->ring_drops);
+    printf("  Timer calls: %lu (%lu/s)\n",
+           (unsigned long)m->timer_calls, (unsigned long)per_s(calls, ms));
+    printf("  %-12s %4s %7s %10s\n", "task", "prio", "cpu%", "stack free");
+    for (int i = 0; i < m->ntasks; i++) {
+        const metrics_task_t *t = &m->tasks[i];
+        const metrics_task_t *pt = prev ? find_task(prev, t->name) : NULL;
+        uint32_t run = pt ? t->runtime - pt->runtime : t->runtime;
+        printf("  %-12s %4u %6.1f%% %10u\n", t->name, t->priority,
+               total ? 100.0 * run / total : 0.0, t->stack_hwm);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    FILE *in = stdin;
+    char line[2048];
+    static metrics_t frames[2];
+    unsigned long decoded = 0;
+    int cur = 0;
+    bool have_prev = false;
+
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [monitor.log]\n", argv[0]);
+        return 1;
+    }
+    if (argc == 2) {
+        in = fopen(argv[1], "r");
+        if (!in) {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    while (fgets(line, sizeof(line), in)) {
+        // The prefix may follow console noise on the same line
+        const char *p = strstr(line, METRICS_LINE_PREFIX);
+        if (!p || !decode_line(p + strlen(METRICS_LINE_PREFIX), &frames[cur])) {
+            continue;
+        }
+        const metrics_t *prev = &frames[cur ^ 1];
+        // Uptime going backwards means the device rebooted in between
+        if (!have_prev || frames[cur].uptime_ms < prev->uptime_ms) {
+            prev = NULL;
+        }
+        if (decoded) {
+            printf("\n");
+        }
+        print_report(&frames[cur], prev);
+        have_prev = true;
+        cur ^= 1;
+        decoded++;
+    }
+
+    if (in != stdin) {
+        fclose(in);
+    }
+    fprintf(stderr, "%lu frames decoded\n", decoded);
+    return 0;
+}
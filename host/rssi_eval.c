@@ -0,0 +1,372 @@
+// Scores the firmware's RSSI proximity gate on recorded or synthetic traces.
+//
+// Usage: rssi_eval [options] [trace]
+//
+//   trace      text trace, one advert per line:  <time_ms> <tool> <rssi_dbm> <inside 0|1>
+//              '#' starts a comment. Lines "ADVCAP <hex>" from a console capture
+//              are read too; their tools count as inside when listed with -i.
+//              Without a trace a synthetic hour of shop traffic is generated.
+//   -e dbm     score this enter threshold only (default: sweep -90..-50 dBm)
+//   -H db      hysteresis, exit = enter - db (default 8)
+//   -n db2     measurement noise variance (default CONFIG_VACUUM_PROXIMITY_NOISE_DB2)
+//   -d db2/s   drift variance per second (default CONFIG_VACUUM_PROXIMITY_DRIFT_DB2_S)
+//   -i addr    tool address inside the radius for ADVCAP input (repeatable)
+//   -s seed    seed of the synthetic trace
+//   -w file    write the trace that was scored, in the text format
+//
+// Every advert goes through proximity_update(), the integer filter the
+// firmware runs per tool, and the same gate is also scored on the raw RSSI.
+// A false activation is the gate letting a tool in while it is outside the
+// radius. Activation latency runs from the first advert after a tool comes
+// inside to the advert that opens its gate; a tool that leaves again before
+// that is a miss.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "proximity.h"
+#include "aws_adv.h"
+#include "adv_capture.h"
+
+#define MAX_TOOLS       64
+#define MAX_INSIDE      16
+
+typedef struct {
+    int64_t t_us;
+    uint8_t tool;
+    int8_t rssi;
+    bool inside;
+} sample_t;
+
+typedef struct {
+    sample_t *s;
+    size_t n, cap;
+    char names[MAX_TOOLS][24];
+    uint8_t tools;
+} trace_t;
+
+typedef struct {
+    uint32_t false_entries;     // Gate opened while outside the radius
+    uint64_t outside, outside_open;
+    uint32_t arrivals, missed;
+    int64_t *lat_us;            // Per caught arrival
+    uint32_t lat_n;
+} score_t;
+
+static trace_t trace;
+
+static void add_sample(int64_t t_us, uint8_t tool, int8_t rssi, bool inside)
+{
+    if (trace.n == trace.cap) {
+        trace.cap = trace.cap ? trace.cap * 2 : 4096;
+        trace.s = realloc(trace.s, trace.cap * sizeof(*trace.s));
+    }
+    trace.s[trace.n++] = (sample_t){ .t_us = t_us, .tool = tool, .rssi = rssi, .inside = inside };
+}
+
+static int tool_id(const char *name)
+{
+    for (int i = 0; i < trace.tools; i++) {
+        if (strcmp(trace.names[i], name) == 0) {
+            return i;
+        }
+    }
+    if (trace.tools == MAX_TOOLS) {
+        return -1;
+    }
+    snprintf(trace.names[trace.tools], sizeof(trace.names[0]), "%s", name);
+    return trace.tools++;
+}
+
+// ---------------------------------------------------------------------------
+// Input
+
+static char inside_addrs[MAX_INSIDE][18];
+static int inside_count;
+
+static int hex_nibble(int c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static void load_advcap(const char *hex, int64_t *last_us, int64_t *wrap_us)
+{
+    uint8_t buf[ADV_CAPTURE_MAX_REC_LEN];
+    size_t len = 0;
+    adv_capture_rec_t rec;
+    aws_adv_t aws;
+    char addr[18];
+
+    while (len < sizeof(buf) && hex_nibble(hex[0]) >= 0 && hex_nibble(hex[1]) >= 0) {
+        buf[len++] = (uint8_t)(hex_nibble(hex[0]) << 4 | hex_nibble(hex[1]));
+        hex += 2;
+    }
+    if (!adv_capture_decode(buf, len, &rec) || !aws_adv_decode(rec.data, rec.len, &aws)) {
+        return;
+    }
+
+    // Capture timestamps are the low 32 bits of esp_timer_get_time()
+    int64_t t_us = *wrap_us + rec.timestamp_us;
+    if (t_us < *last_us) {
+        *wrap_us += (int64_t)1 << 32;
+        t_us += (int64_t)1 << 32;
+    }
+    *last_us = t_us;
+
+    snprintf(addr, sizeof(addr), "%02x:%02x:%02x:%02x:%02x:%02x",
+             rec.addr[0], rec.addr[1], rec.addr[2], rec.addr[3], rec.addr[4], rec.addr[5]);
+    bool inside = false;
+    for (int i = 0; i < inside_count; i++) {
+        inside |= strcasecmp(inside_addrs[i], addr) == 0;
+    }
+    int id = tool_id(addr);
+    if (id >= 0) {
+        add_sample(t_us, (uint8_t)id, rec.rssi, inside);
+    }
+}
+
+static int load_trace(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    char line[256], name[64];
+    double t_ms;
+    int rssi, inside;
+    int64_t last_us = 0, wrap_us = 0;
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        const char *cap = strstr(line, ADV_CAPTURE_LINE_PREFIX);
+        if (cap) {
+            load_advcap(cap + strlen(ADV_CAPTURE_LINE_PREFIX), &last_us, &wrap_us);
+        } else if (line[0] != '#' && sscanf(line, "%lf %63s %d %d", &t_ms, name, &rssi, &inside) == 4) {
+            int id = tool_id(name);
+            if (id >= 0) {
+                add_sample((int64_t)(t_ms * 1000), (uint8_t)id, (int8_t)rssi, inside != 0);
+            }
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Synthetic shop hour: log-distance path loss with log-normal shadowing and
+// short body-blocking fades. Radius 3 m.
+
+#define SYN_RADIUS_M        3.0
+#define SYN_TX_1M_DBM       -59.0
+#define SYN_PATH_EXP        2.2
+#define SYN_SIGMA_DB        4.0
+#define SYN_ADV_MS          100
+
+static double gauss(void)
+{
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0), v = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+static int8_t syn_rssi(double d_m, double extra_loss_db)
+{
+    double r = SYN_TX_1M_DBM - 10 * SYN_PATH_EXP * log10(d_m) - extra_loss_db + SYN_SIGMA_DB * gauss();
+    return (int8_t)(r < -100 ? -100 : r);
+}
+
+static void synthesize(void)
+{
+    // bench: saw on the bench next to the vacuum
+    // across: tool in the next bay, behind a partition
+    // walker: carried between the bench and the far end of the shop
+    int bench = tool_id("bench"), across = tool_id("across"), walker = tool_id("walker");
+    double walker_d = 1.0, walker_target = 1.0;
+    int64_t fade_until[3] = { 0 };
+
+    for (int64_t t_ms = 0; t_ms < 3600 * 1000; t_ms += SYN_ADV_MS) {
+        int64_t t_us = t_ms * 1000 + rand() % 10000;
+        int ids[3] = { bench, across, walker };
+
+        if (t_ms % 20000 == 0) {
+            // New destination every 20 s, half of them inside the radius
+            walker_target = rand() % 2 ? 0.5 + 2.0 * rand() / RAND_MAX : 4.0 + 8.0 * rand() / RAND_MAX;
+        }
+        walker_d += (walker_target - walker_d) * 0.02;   // About 1 m/s
+
+        for (int k = 0; k < 3; k++) {
+            if (rand() % 600 == 0) {
+                fade_until[k] = t_ms + 500 + rand() % 2500;
+            }
+            double fade = t_ms < fade_until[k] ? 10.0 : 0.0;
+            double d = k == 0 ? 1.5 : k == 1 ? 7.0 : walker_d;
+            double wall = k == 1 ? 6.0 : 0.0;
+            add_sample(t_us, (uint8_t)ids[k], syn_rssi(d, wall + fade), d <= SYN_RADIUS_M);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Scoring
+
+static int cmp_i64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void score(const proximity_cfg_t *cfg, bool raw, score_t *sc)
+{
+    proximity_t prox[MAX_TOOLS];
+    bool was_inside[MAX_TOOLS] = { false }, waiting[MAX_TOOLS] = { false };
+    int64_t arrived_us[MAX_TOOLS];
+
+    memset(sc, 0, sizeof(*sc));
+    sc->lat_us = malloc((trace.n + 1) * sizeof(int64_t));
+    for (int i = 0; i < MAX_TOOLS; i++) {
+        proximity_reset(&prox[i]);
+    }
+
+    for (size_t i = 0; i < trace.n; i++) {
+        const sample_t *s = &trace.s[i];
+        proximity_t *p = &prox[s->tool];
+        bool was_open = p->near;
+
+        if (raw) {
+            // Same thresholds on every single reading
+            if (!p->near && s->rssi >= cfg->enter_dbm) {
+                p->near = true;
+            } else if (p->near && s->rssi < cfg->exit_dbm) {
+                p->near = false;
+            }
+        } else {
+            proximity_update(p, cfg, s->rssi, s->t_us);
+        }
+
+        if (!s->inside) {
+            sc->outside++;
+            sc->outside_open += p->near;
+            sc->false_entries += p->near && !was_open;
+            if (waiting[s->tool]) {
+                sc->missed++;
+                waiting[s->tool] = false;
+            }
+        } else {
+            if (!was_inside[s->tool]) {
+                sc->arrivals++;
+                arrived_us[s->tool] = s->t_us;
+                waiting[s->tool] = true;
+            }
+            if (waiting[s->tool] && p->near) {
+                sc->lat_us[sc->lat_n++] = s->t_us - arrived_us[s->tool];
+                waiting[s->tool] = false;
+            }
+        }
+        was_inside[s->tool] = s->inside;
+    }
+    qsort(sc->lat_us, sc->lat_n, sizeof(int64_t), cmp_i64);
+}
+
+static double pct_ms(const score_t *sc, int pct)
+{
+    if (sc->lat_n == 0) {
+        return 0;
+    }
+    return sc->lat_us[(sc->lat_n - 1) * pct / 100] / 1e3;
+}
+
+static void print_row(const char *filter, const proximity_cfg_t *cfg, const score_t *sc, double hours)
+{
+    printf("%-7s %6d %5d %9.1f %8.2f%% %8u %8u %8.0f %8.0f %8.0f\n",
+           filter, cfg->enter_dbm, cfg->exit_dbm, hours > 0 ? sc->false_entries / hours : 0,
+           sc->outside ? 100.0 * sc->outside_open / sc->outside : 0, sc->arrivals, sc->missed,
+           pct_ms(sc, 50), pct_ms(sc, 95), pct_ms(sc, 100));
+}
+
+int main(int argc, char **argv)
+{
+    proximity_cfg_t cfg;
+    int enter = 0, hysteresis = 8;
+    bool single = false;
+    const char *path = NULL, *out = NULL;
+    unsigned seed = 1;
+
+    proximity_cfg_default(&cfg);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            enter = atoi(argv[++i]);
+            single = true;
+        } else if (strcmp(argv[i], "-H") == 0 && i + 1 < argc) {
+            hysteresis = atoi(argv[++i]);
+            hysteresis = hysteresis < 1 ? 1 : hysteresis;     // Exit must stay below enter
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            cfg.noise_q8 = (uint32_t)atoi(argv[++i]) << PROXIMITY_Q;
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            cfg.drift_q8 = (uint32_t)atoi(argv[++i]) << PROXIMITY_Q;
+        } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc && inside_count < MAX_INSIDE) {
+            snprintf(inside_addrs[inside_count++], sizeof(inside_addrs[0]), "%s", argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seed = (unsigned)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            out = argv[++i];
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            fprintf(stderr, "usage: %s [-e dbm] [-H db] [-n db2] [-d db2/s] [-i addr] [-s seed] "
+                    "[-w file] [trace]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (path) {
+        if (load_trace(path) != 0) {
+            return 1;
+        }
+    } else {
+        srand(seed);
+        synthesize();
+    }
+    if (trace.n == 0) {
+        fprintf(stderr, "no adverts in the trace\n");
+        return 1;
+    }
+    if (out) {
+        FILE *f = fopen(out, "w");
+        if (!f) {
+            perror(out);
+            return 1;
+        }
+        fprintf(f, "# time_ms tool rssi_dbm inside\n");
+        for (size_t i = 0; i < trace.n; i++) {
+            fprintf(f, "%.3f %s %d %d\n", trace.s[i].t_us / 1e3, trace.names[trace.s[i].tool],
+                    trace.s[i].rssi, trace.s[i].inside);
+        }
+        fclose(f);
+    }
+
+    double hours = (trace.s[trace.n - 1].t_us - trace.s[0].t_us) / 3.6e9;
+    printf("%zu adverts from %u tools over %.2f h%s, noise %u dB^2, drift %u dB^2/s\n",
+           trace.n, trace.tools, hours, path ? "" : " (synthetic)",
+           cfg.noise_q8 >> PROXIMITY_Q, cfg.drift_q8 >> PROXIMITY_Q);
+    printf("%-7s %6s %5s %9s %9s %8s %8s %8s %8s %8s\n", "filter", "enter", "exit", "false/h",
+           "out-open", "arrivals", "missed", "p50 ms", "p95 ms", "max ms");
+
+    for (int e = single ? enter : -90; e <= (single ? enter : -50); e += 2) {
+        score_t sc;
+        cfg.enter_dbm = (int8_t)e;
+        cfg.exit_dbm = (int8_t)(e - hysteresis);
+        for (int raw = 1; raw >= 0; raw--) {
+            score(&cfg, raw, &sc);
+            print_row(raw ? "raw" : "kalman", &cfg, &sc, hours);
+            free(sc.lat_us);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,17 @@
+// Host shim for driver/gpio.h: levels are kept in memory
+#ifndef SHIM_DRIVER_GPIO_H
+#define SHIM_DRIVER_GPIO_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#define SHIM_GPIO_COUNT 40
+
+typedef int gpio_num_t;
+
+#define GPIO_NUM_2 2
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level);
+int gpio_get_level(gpio_num_t gpio_num);
+
+#endif // SHIM_DRIVER_GPIO_H
@@ -0,0 +1,10 @@
+// Host shim for esp_attr.h: placement attributes are meaningless on the host
+#ifndef SHIM_ESP_ATTR_H
+#define SHIM_ESP_ATTR_H
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+
+#endif // SHIM_ESP_ATTR_H
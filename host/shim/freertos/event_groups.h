@@ -0,0 +1,21 @@
+// Host shim for freertos/event_groups.h
+//
+// Single-threaded: xEventGroupWaitBits() never blocks and returns the
+// current bits, which is what a host driving the logic step by step needs.
+#ifndef SHIM_FREERTOS_EVENT_GROUPS_H
+#define SHIM_FREERTOS_EVENT_GROUPS_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef uint32_t EventBits_t;
+typedef struct shim_event_group *EventGroupHandle_t;
+
+EventGroupHandle_t xEventGroupCreate(void);
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits,
+                                BaseType_t clear_on_exit, BaseType_t wait_for_all,
+                                TickType_t ticks_to_wait);
+
+#endif // SHIM_FREERTOS_EVENT_GROUPS_H
@@ -0,0 +1,10 @@
+// Host shim for freertos/task.h
+#ifndef SHIM_FREERTOS_TASK_H
+#define SHIM_FREERTOS_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+TickType_t xTaskGetTickCount(void);
+TickType_t xTaskGetTickCountFromISR(void);
+
+#endif // SHIM_FREERTOS_TASK_H
@@ -0,0 +1,55 @@
+// Host-only controls for the ESP-IDF shims
+#ifndef HOST_SHIM_H
+#define HOST_SHIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_log.h"
+#include "driver/gpio.h"
+#include "led_control.h"
+
+/**
+ * @brief Switch esp_timer_get_time() to a virtual clock starting at 0
+ * @param enable true for virtual time, false for CLOCK_MONOTONIC
+ */
+void shim_clock_set_virtual(bool enable);
+
+/**
+ * @brief Advance the virtual clock, firing due esp_timer callbacks in order
+ * @param t_us New virtual time
+ */
+void shim_clock_advance_to(int64_t t_us);
+
+/**
+ * @brief Time of the earliest armed esp_timer
+ * @return Deadline in us, or INT64_MAX if no timer is armed
+ */
+int64_t shim_timer_next_deadline(void);
+
+/**
+ * @brief Drive an input pin level (what gpio_get_level() returns)
+ */
+void shim_gpio_set_input(gpio_num_t gpio_num, int level);
+
+/**
+ * @brief Number of gpio_set_level() calls since start
+ */
+uint32_t shim_gpio_write_count(void);
+
+/**
+ * @brief Pattern most recently passed to led_set_pattern()
+ */
+led_pattern_t shim_led_pattern(void);
+
+/**
+ * @brief Called on every led_channel_set_pattern(), one-shots included
+ */
+typedef void (*shim_led_hook_t)(led_channel_t channel, led_pattern_t pattern);
+
+/**
+ * @brief Observe LED pattern changes
+ * @param hook Callback, NULL to remove it
+ */
+void shim_led_set_hook(shim_led_hook_t hook);
+
+#endif // HOST_SHIM_H
@@ -0,0 +1,311 @@
+// Host implementations of the ESP-IDF/FreeRTOS calls used by the portable
+// firmware modules: GPIO, esp_timer, event groups, tick count and the
+// led_control API.
+
+#include <stdlib.h>
+#include <time.h>
+
+#include "host_shim.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "led_control.h"
+
+esp_log_level_t shim_log_level = ESP_LOG_NONE;
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        default: return "UNKNOWN ERROR";
+    }
+}
+
+// ---------------------------------------------------------------------------
+// GPIO
+
+static int gpio_levels[SHIM_GPIO_COUNT];
+static uint32_t gpio_writes = 0;
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    if (gpio_num < 0 || gpio_num >= SHIM_GPIO_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpio_levels[gpio_num] = level ? 1 : 0;
+    gpio_writes++;
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    if (gpio_num < 0 || gpio_num >= SHIM_GPIO_COUNT) {
+        return 0;
+    }
+    return gpio_levels[gpio_num];
+}
+
+void shim_gpio_set_input(gpio_num_t gpio_num, int level)
+{
+    if (gpio_num >= 0 && gpio_num < SHIM_GPIO_COUNT) {
+        gpio_levels[gpio_num] = level ? 1 : 0;
+    }
+}
+
+uint32_t shim_gpio_write_count(void)
+{
+    return gpio_writes;
+}
+
+// ---------------------------------------------------------------------------
+// Clock and esp_timer
+
+#define SHIM_MAX_TIMERS 32
+
+struct shim_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    bool in_use;
+    bool armed;
+    int64_t deadline_us;
+    uint64_t period_us;
+};
+
+static struct shim_timer timers[SHIM_MAX_TIMERS];
+static bool clock_virtual = false;
+static int64_t clock_now_us = 0;
+
+int64_t esp_timer_get_time(void)
+{
+    if (clock_virtual) {
+        return clock_now_us;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void shim_clock_set_virtual(bool enable)
+{
+    clock_virtual = enable;
+    clock_now_us = 0;
+}
+
+int64_t shim_timer_next_deadline(void)
+{
+    int64_t next = INT64_MAX;
+    for (int i = 0; i < SHIM_MAX_TIMERS; i++) {
+        if (timers[i].armed && timers[i].deadline_us < next) {
+            next = timers[i].deadline_us;
+        }
+    }
+    return next;
+}
+
+void shim_clock_advance_to(int64_t t_us)
+{
+    for (;;) {
+        // Fire the earliest due timer; callbacks may re-arm any timer
+        struct shim_timer *due = NULL;
+        for (int i = 0; i < SHIM_MAX_TIMERS; i++) {
+            if (timers[i].armed && timers[i].deadline_us <= t_us &&
+                (!due || timers[i].deadline_us < due->deadline_us)) {
+                due = &timers[i];
+            }
+        }
+        if (!due) {
+            break;
+        }
+        if (due->deadline_us > clock_now_us) {
+            clock_now_us = due->deadline_us;
+        }
+        if (due->period_us) {
+            due->deadline_us += (int64_t)due->period_us;
+        } else {
+            due->armed = false;
+        }
+        due->callback(due->arg);
+    }
+    if (t_us > clock_now_us) {
+        clock_now_us = t_us;
+    }
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle)
+{
+    for (int i = 0; i < SHIM_MAX_TIMERS; i++) {
+        if (!timers[i].in_use) {
+            timers[i] = (struct shim_timer){
+                .callback = args->callback,
+                .arg = args->arg,
+                .in_use = true,
+            };
+            *out_handle = &timers[i];
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = true;
+    timer->period_us = 0;
+    timer->deadline_us = esp_timer_get_time() + (int64_t)timeout_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = true;
+    timer->period_us = period_us;
+    timer->deadline_us = esp_timer_get_time() + (int64_t)period_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    timer->armed = false;
+    timer->in_use = false;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    return timer->armed;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(esp_timer_get_time() / 1000);
+}
+
+TickType_t xTaskGetTickCountFromISR(void)
+{
+    return xTaskGetTickCount();
+}
+
+// ---------------------------------------------------------------------------
+// Event groups
+
+struct shim_event_group {
+    EventBits_t bits;
+};
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    return calloc(1, sizeof(struct shim_event_group));
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    group->bits |= bits;
+    return group->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    EventBits_t old = group->bits;
+    group->bits &= ~bits;
+    return old;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group)
+{
+    return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits,
+                                BaseType_t clear_on_exit, BaseType_t wait_for_all,
+                                TickType_t ticks_to_wait)
+{
+    (void)wait_for_all;
+    (void)ticks_to_wait;
+    EventBits_t current = group->bits;
+    if (clear_on_exit) {
+        group->bits &= ~bits;
+    }
+    return current;
+}
+
+// ---------------------------------------------------------------------------
+// led_control API: records the steady status LED pattern, the pattern
+// descriptors (led_pattern.c) are linked separately
+
+static led_pattern_t led_current = LED_PATTERN_OFF;
+static shim_led_hook_t led_hook = NULL;
+
+esp_err_t led_init(int status_gpio, int aux_gpio)
+{
+    led_current = LED_PATTERN_OFF;
+    return ESP_OK;
+}
+
+esp_err_t led_channel_set_pattern(led_channel_t channel, led_pattern_t pattern)
+{
+    if (led_hook) {
+        led_hook(channel, pattern);
+    }
+    if (channel == LED_CHANNEL_STATUS && !led_pattern_is_oneshot(pattern)) {
+        led_current = pattern;
+    }
+    return ESP_OK;
+}
+
+esp_err_t led_set_pattern(led_pattern_t pattern)
+{
+    return led_channel_set_pattern(LED_CHANNEL_STATUS, pattern);
+}
+
+esp_err_t led_on(void)
+{
+    return led_set_pattern(LED_PATTERN_ON);
+}
+
+esp_err_t led_off(void)
+{
+    return led_set_pattern(LED_PATTERN_OFF);
+}
+
+esp_err_t led_toggle(void)
+{
+    return led_set_pattern(led_current == LED_PATTERN_ON ? LED_PATTERN_OFF : LED_PATTERN_ON);
+}
+
+led_pattern_t led_get_pattern(void)
+{
+    return led_current;
+}
+
+led_pattern_t shim_led_pattern(void)
+{
+    return led_current;
+}
+
+void shim_led_set_hook(shim_led_hook_t hook)
+{
+    led_hook = hook;
+}
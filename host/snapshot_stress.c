@@ -0,0 +1,148 @@
+// Concurrency stress test of the state snapshot latch.
+//
+// Usage: snapshot_stress [seconds] [readers]
+//
+// One writer thread publishes snapshots as fast as it can while the reader
+// threads copy them and check that every copy is internally consistent (all
+// fields derived from the same publish) and that versions never go
+// backwards. Exits non-zero on the first torn or stale read.
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "vacuum_snapshot.h"
+
+#define MAX_READERS 16
+
+static vacuum_snapshot_latch_t latch;
+static atomic_bool stop;
+static atomic_uint failures;
+
+typedef struct {
+    pthread_t thread;
+    uint64_t reads;
+    uint64_t changes;
+} reader_t;
+
+// Every field is a function of n, so a copy mixing two publishes shows up
+static void fill(vacuum_snapshot_t *snap, uint32_t n)
+{
+    memset(snap, 0, sizeof(*snap));
+    snap->state = (vacuum_state_t)(n % 3);
+    snap->auto_mode = n & 1;
+    snap->tool_detected = n & 2;
+    snap->tool_power = n & 4;
+    snap->prestarted = n & 8;
+    snap->relay_level = (n >> 4) & 1;
+    snap->tools_active = n % (VACUUM_SNAPSHOT_TOOLS + 1);
+    for (int t = 0; t < VACUUM_SNAPSHOT_TOOLS; t++) {
+        for (int b = 0; b < 6; b++) {
+            snap->tools[t][b] = (uint8_t)(n * 7 + t * 6 + b);
+        }
+    }
+    snap->transition_us = (int64_t)n * 1000003;
+    snap->published_us = -(int64_t)n;
+}
+
+static bool consistent(const vacuum_snapshot_t *snap)
+{
+    vacuum_snapshot_t expect;
+    uint32_t n = (uint32_t)(-snap->published_us);
+
+    if (snap->version == 0) {
+        memset(&expect, 0, sizeof(expect));     // vacuum_snapshot_init()
+    } else {
+        fill(&expect, n);
+        expect.version = snap->version;
+    }
+    return memcmp(&expect, snap, sizeof(expect)) == 0 &&
+           (snap->version == 0 || snap->version == n + 1);
+}
+
+static void *writer_main(void *arg)
+{
+    vacuum_snapshot_t snap;
+    uint64_t *published = arg;
+
+    for (uint32_t n = 0; !atomic_load_explicit(&stop, memory_order_relaxed); n++) {
+        fill(&snap, n);
+        vacuum_snapshot_publish(&latch, &snap);
+        (*published)++;
+    }
+    return NULL;
+}
+
+static void *reader_main(void *arg)
+{
+    reader_t *r = arg;
+    vacuum_snapshot_t snap;
+    uint32_t last_version = 0;
+
+    while (!atomic_load_explicit(&stop, memory_order_relaxed)) {
+        vacuum_state_get(&snap);
+        r->reads++;
+        if (!consistent(&snap)) {
+            fprintf(stderr, "torn read: version %u\n", snap.version);
+            atomic_fetch_add(&failures, 1);
+            atomic_store(&stop, true);
+        } else if (snap.version < last_version) {
+            fprintf(stderr, "version went back: %u after %u\n", snap.version, last_version);
+            atomic_fetch_add(&failures, 1);
+            atomic_store(&stop, true);
+        }
+        if (snap.version != last_version) {
+            r->changes++;
+        }
+        last_version = snap.version;
+    }
+    return NULL;
+}
+
+void vacuum_state_get(vacuum_snapshot_t *out)
+{
+    vacuum_snapshot_read(&latch, out);
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+    int readers = argc > 2 ? atoi(argv[2]) : 3;
+    reader_t reader[MAX_READERS] = { 0 };
+    pthread_t writer;
+    uint64_t published = 0;
+
+    if (readers < 1 || readers > MAX_READERS) {
+        fprintf(stderr, "readers must be 1..%d\n", MAX_READERS);
+        return 2;
+    }
+
+    vacuum_snapshot_init(&latch);
+    pthread_create(&writer, NULL, writer_main, &published);
+    for (int i = 0; i < readers; i++) {
+        pthread_create(&reader[i].thread, NULL, reader_main, &reader[i]);
+    }
+
+    struct timespec ts = { (time_t)seconds, (long)((seconds - (time_t)seconds) * 1e9) };
+    nanosleep(&ts, NULL);
+    atomic_store(&stop, true);
+
+    pthread_join(writer, NULL);
+    uint64_t reads = 0, changes = 0;
+    for (int i = 0; i < readers; i++) {
+        pthread_join(reader[i].thread, NULL);
+        reads += reader[i].reads;
+        changes += reader[i].changes;
+    }
+
+    unsigned retries = atomic_load(&latch.retries);
+    printf("%d readers, %.1f s: %llu publishes, %llu reads (%llu saw a new version), "
+           "%u retries (%.3f%%), %u failures\n",
+           readers, seconds, (unsigned long long)published, (unsigned long long)reads,
+           (unsigned long long)changes, retries, reads ? retries * 100.0 / reads : 0.0,
+           atomic_load(&failures));
+    return atomic_load(&failures) ? 1 : 0;
+}
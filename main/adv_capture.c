@@ -0,0 +1,85 @@
+#include "adv_capture.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+#ifdef CONFIG_ADV_CAPTURE_ENABLE
+
+// Flight-recorder ring written by the NimBLE host task. The writer never
+// blocks: it overwrites the oldest slot, and while a dump is in progress it
+// drops records instead of touching slots the dump is reading.
+static adv_capture_rec_t capture_ring[CONFIG_ADV_CAPTURE_RECORDS];
+static atomic_uint capture_head = 0;       // Total records ever written
+static atomic_bool capture_writing = false;
+static atomic_bool capture_dumping = false;
+static atomic_uint capture_dropped = 0;
+
+void adv_capture_record(uint8_t addr_type, const uint8_t *addr, int8_t rssi,
+                        const uint8_t *data, uint8_t len)
+{
+    atomic_store(&capture_writing, true);
+    if (atomic_load(&capture_dumping)) {
+        atomic_store(&capture_writing, false);
+        atomic_fetch_add_explicit(&capture_dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    unsigned head = atomic_load_explicit(&capture_head, memory_order_relaxed);
+    adv_capture_rec_t *rec = &capture_ring[head % CONFIG_ADV_CAPTURE_RECORDS];
+
+    rec->timestamp_us = (uint32_t)esp_timer_get_time();
+    rec->addr_type = addr_type;
+    memcpy(rec->addr, addr, sizeof(rec->addr));
+    rec->rssi = rssi;
+    rec->len = len > ADV_CAPTURE_MAX_AD ? ADV_CAPTURE_MAX_AD : len;
+    memcpy(rec->data, data, rec->len);
+
+    atomic_store_explicit(&capture_head, head + 1, memory_order_release);
+    atomic_store(&capture_writing, false);
+}
+
+void adv_capture_dump(void)
+{
+    uint8_t buf[ADV_CAPTURE_MAX_REC_LEN];
+
+    // Stop the writer and wait for an in-flight record to complete
+    atomic_store(&capture_dumping, true);
+    while (atomic_load(&capture_writing)) {
+        vTaskDelay(1);
+    }
+
+    unsigned head = atomic_load_explicit(&capture_head, memory_order_acquire);
+    unsigned count = head < CONFIG_ADV_CAPTURE_RECORDS ? head : CONFIG_ADV_CAPTURE_RECORDS;
+
+    printf("ADVCAP-BEGIN records=%u dropped=%u\n", count, atomic_load(&capture_dropped));
+    for (unsigned i = head - count; i != head; i++) {
+        size_t n = adv_capture_encode(&capture_ring[i % CONFIG_ADV_CAPTURE_RECORDS], buf);
+        printf(ADV_CAPTURE_LINE_PREFIX);
+        for (size_t j = 0; j < n; j++) {
+            printf("%02x", buf[j]);
+        }
+        printf("\n");
+    }
+    printf("ADVCAP-END\n");
+    fflush(stdout);
+
+    atomic_store(&capture_dumping, false);
+}
+
+#else
+
+void adv_capture_record(uint8_t addr_type, const uint8_t *addr, int8_t rssi,
+                        const uint8_t *data, uint8_t len)
+{
+}
+
+void adv_capture_dump(void)
+{
+    printf("ADVCAP-BEGIN records=0 dropped=0\nADVCAP-END\n");
+}
+
+#endif // CONFIG_ADV_CAPTURE_ENABLE
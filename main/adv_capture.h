@@ -0,0 +1,113 @@
+#ifndef ADV_CAPTURE_H
+#define ADV_CAPTURE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Capture format shared by the firmware and the host replay tool.
+//
+// A capture file starts with the 4-byte magic "ADVC" and a 1-byte version,
+// followed by records. Each record is a fixed 13-byte little-endian header
+// and `len` raw AD bytes:
+//
+//   u32 timestamp_us   low 32 bits of esp_timer_get_time() (wraps ~71 min)
+//   u8  addr_type      BLE_ADDR_PUBLIC / BLE_ADDR_RANDOM / ...
+//   u8  addr[6]        as in ble_addr_t.val
+//   i8  rssi           dBm
+//   u8  len            number of AD bytes that follow (<= 31)
+//
+// Over UART every record is printed as one "ADVCAP <hex>" line, framed by
+// "ADVCAP-BEGIN" / "ADVCAP-END" lines, so captures can be cut straight out
+// of an `idf.py monitor` log.
+
+#define ADV_CAPTURE_MAGIC           "ADVC"
+#define ADV_CAPTURE_VERSION         1
+#define ADV_CAPTURE_MAX_AD          31
+#define ADV_CAPTURE_HDR_LEN         13
+#define ADV_CAPTURE_MAX_REC_LEN     (ADV_CAPTURE_HDR_LEN + ADV_CAPTURE_MAX_AD)
+#define ADV_CAPTURE_LINE_PREFIX     "ADVCAP "
+
+/**
+ * @brief One captured BLE_GAP_EVENT_DISC event
+ */
+typedef struct {
+    uint32_t timestamp_us;
+    uint8_t addr_type;
+    uint8_t addr[6];
+    int8_t rssi;
+    uint8_t len;
+    uint8_t data[ADV_CAPTURE_MAX_AD];
+} adv_capture_rec_t;
+
+/**
+ * @brief Serialize a record into the capture format
+ * @param rec Record
+ * @param buf Destination, at least ADV_CAPTURE_MAX_REC_LEN bytes
+ * @return Number of bytes written
+ */
+static inline size_t adv_capture_encode(const adv_capture_rec_t *rec, uint8_t *buf)
+{
+    uint8_t len = rec->len > ADV_CAPTURE_MAX_AD ? ADV_CAPTURE_MAX_AD : rec->len;
+    buf[0] = (uint8_t)rec->timestamp_us;
+    buf[1] = (uint8_t)(rec->timestamp_us >> 8);
+    buf[2] = (uint8_t)(rec->timestamp_us >> 16);
+    buf[3] = (uint8_t)(rec->timestamp_us >> 24);
+    buf[4] = rec->addr_type;
+    for (int i = 0; i < 6; i++) {
+        buf[5 + i] = rec->addr[i];
+    }
+    buf[11] = (uint8_t)rec->rssi;
+    buf[12] = len;
+    for (int i = 0; i < len; i++) {
+        buf[ADV_CAPTURE_HDR_LEN + i] = rec->data[i];
+    }
+    return ADV_CAPTURE_HDR_LEN + len;
+}
+
+/**
+ * @brief Parse one record from the capture format
+ * @param buf Source bytes
+ * @param avail Number of bytes available in buf
+ * @param rec Destination record
+ * @return Number of bytes consumed, 0 if buf holds no complete record
+ */
+static inline size_t adv_capture_decode(const uint8_t *buf, size_t avail, adv_capture_rec_t *rec)
+{
+    if (avail < ADV_CAPTURE_HDR_LEN || buf[12] > ADV_CAPTURE_MAX_AD ||
+        avail < (size_t)ADV_CAPTURE_HDR_LEN + buf[12]) {
+        return 0;
+    }
+    rec->timestamp_us = (uint32_t)buf[0] | (uint32_t)buf[1] << 8 |
+                        (uint32_t)buf[2] << 16 | (uint32_t)buf[3] << 24;
+    rec->addr_type = buf[4];
+    for (int i = 0; i < 6; i++) {
+        rec->addr[i] = buf[5 + i];
+    }
+    rec->rssi = (int8_t)buf[11];
+    rec->len = buf[12];
+    for (int i = 0; i < rec->len; i++) {
+        rec->data[i] = buf[ADV_CAPTURE_HDR_LEN + i];
+    }
+    return ADV_CAPTURE_HDR_LEN + rec->len;
+}
+
+#ifdef ESP_PLATFORM
+
+/**
+ * @brief Append one advert to the capture ring (NimBLE host task only)
+ *
+ * Lock-free and non-blocking; the oldest record is overwritten when the ring
+ * is full, and adverts arriving during a dump are counted as dropped.
+ */
+void adv_capture_record(uint8_t addr_type, const uint8_t *addr, int8_t rssi,
+                        const uint8_t *data, uint8_t len);
+
+/**
+ * @brief Print the ring contents to the console as ADVCAP lines
+ */
+void adv_capture_dump(void);
+
+#endif // ESP_PLATFORM
+
+#endif // ADV_CAPTURE_H
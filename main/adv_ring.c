@@ -0,0 +1,58 @@
+#include "adv_ring.h"
+#include <string.h>
+
+_Static_assert((ADV_RING_SIZE & (ADV_RING_SIZE - 1)) == 0,
+               "CONFIG_ADV_RING_RECORDS must be a power of two");
+
+void adv_ring_init(adv_ring_t *ring)
+{
+    atomic_store_explicit(&ring->head, 0, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, 0, memory_order_relaxed);
+    ring->overflows = 0;
+}
+
+bool adv_ring_push(adv_ring_t *ring, int64_t rx_time_us, const uint8_t *addr, int8_t rssi,
+                   const uint8_t *data, uint8_t len, bool *was_empty)
+{
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    // Acquire pairs with adv_ring_pop(): the consumer is done with the slot
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    if (head - tail >= ADV_RING_SIZE) {
+        ring->overflows++;
+        return false;
+    }
+
+    adv_ring_rec_t *rec = &ring->recs[head & ADV_RING_MASK];
+    if (len > ADV_RING_MAX_AD) {
+        len = ADV_RING_MAX_AD;
+    }
+    rec->rx_time_us = rx_time_us;
+    memcpy(rec->addr, addr, 6);
+    rec->rssi = rssi;
+    rec->len = len;
+    memcpy(rec->data, data, len);
+
+    // Publishes the record. Sequentially consistent together with the tail
+    // reload below and the consumer's pop/peek, so either this side sees the
+    // consumer caught up (and wakes it) or the consumer sees this record
+    // before it goes back to sleep; a wake-up can be spurious but never lost.
+    atomic_store(&ring->head, head + 1);
+    if (was_empty) {
+        *was_empty = atomic_load(&ring->tail) == head;
+    }
+    return true;
+}
+
+const adv_ring_rec_t *adv_ring_peek(adv_ring_t *ring)
+{
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned head = atomic_load(&ring->head);
+    return head == tail ? NULL : &ring->recs[tail & ADV_RING_MASK];
+}
+
+void adv_ring_pop(adv_ring_t *ring)
+{
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store(&ring->tail, tail + 1);
+}
@@ -0,0 +1,83 @@
+#ifndef ADV_RING_H
+#define ADV_RING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Hand-off of AWS-shaped adverts from the NimBLE host task (producer) to the
+// advert consumer task. Single producer, single consumer, no locks: the
+// producer only writes head, the consumer only writes tail, and a full ring
+// drops the advert rather than blocking the host task.
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+#ifndef CONFIG_ADV_RING_RECORDS
+#define CONFIG_ADV_RING_RECORDS 32
+#endif
+
+#define ADV_RING_SIZE   CONFIG_ADV_RING_RECORDS
+#define ADV_RING_MASK   (ADV_RING_SIZE - 1)
+#define ADV_RING_MAX_AD 31      // Legacy advertising payload limit
+
+/**
+ * @brief One advert, as much of the GAP discovery event as processing needs
+ */
+typedef struct {
+    int64_t rx_time_us;         // Arrival on the host task
+    uint8_t addr[6];
+    int8_t rssi;
+    uint8_t len;
+    uint8_t data[ADV_RING_MAX_AD];
+} adv_ring_rec_t;
+
+typedef struct {
+    atomic_uint head;           // Next slot to fill (producer only)
+    atomic_uint tail;           // Next slot to consume (consumer only)
+    uint32_t overflows;         // Adverts dropped on a full ring (producer only)
+    adv_ring_rec_t recs[ADV_RING_SIZE];
+} adv_ring_t;
+
+/**
+ * @brief Empty the ring and clear its counters
+ * @param ring Ring
+ */
+void adv_ring_init(adv_ring_t *ring);
+
+/**
+ * @brief Copy an advert into the ring (producer side)
+ *
+ * Payloads longer than ADV_RING_MAX_AD are truncated.
+ *
+ * @param ring Ring
+ * @param rx_time_us Arrival time
+ * @param addr BLE address
+ * @param rssi Advert RSSI
+ * @param data AD payload
+ * @param len Payload length
+ * @param was_empty Set to whether the consumer had caught up before this
+ *                  advert, i.e. whether it needs a wake-up; may be NULL
+ * @return false if the ring was full and the advert was dropped
+ */
+bool adv_ring_push(adv_ring_t *ring, int64_t rx_time_us, const uint8_t *addr, int8_t rssi,
+                   const uint8_t *data, uint8_t len, bool *was_empty);
+
+/**
+ * @brief Oldest queued advert (consumer side)
+ *
+ * The record stays valid, and is not overwritten, until adv_ring_pop().
+ *
+ * @param ring Ring
+ * @return Record or NULL if the ring is empty
+ */
+const adv_ring_rec_t *adv_ring_peek(adv_ring_t *ring);
+
+/**
+ * @brief Release the record returned by adv_ring_peek() (consumer side)
+ * @param ring Ring
+ */
+void adv_ring_pop(adv_ring_t *ring);
+
+#endif // ADV_RING_H
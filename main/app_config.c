@@ -0,0 +1,201 @@
+#include "app_config.h"
+#include <stddef.h>
+#include <string.h>
+#include "nvs.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+
+static const char *TAG = "APP_CONFIG";
+
+#define APP_CONFIG_NAMESPACE    "makuum"
+#define APP_CONFIG_KEY          "config"
+#define APP_RTC_MAGIC           0x4d4b5557  // "MKUW"
+
+// Survives every reset except power-on; validated by magic and CRCs
+typedef struct {
+    uint32_t magic;
+    app_config_t config;
+    app_live_t live;
+    uint32_t live_crc;
+} app_rtc_t;
+
+static RTC_NOINIT_ATTR app_rtc_t rtc;
+static app_config_t config;
+
+static uint32_t crc32(const void *p, size_t len)
+{
+    return esp_rom_crc32_le(0, p, len);
+}
+
+static void seal(app_config_t *c)
+{
+    c->crc = crc32(c, offsetof(app_config_t, crc));
+}
+
+static bool config_valid(const app_config_t *c)
+{
+    return c->version == APP_CONFIG_VERSION && c->size == sizeof(*c) &&
+           c->crc == crc32(c, offsetof(app_config_t, crc));
+}
+
+// defaults_crc identifies the Kconfig values, so a rebuild with new ones
+// replaces a stored configuration made from the old ones
+static void make_defaults(app_config_t *c)
+{
+    memset(c, 0, sizeof(*c));
+    c->version = APP_CONFIG_VERSION;
+    c->size = sizeof(*c);
+    c->relay_gpio = CONFIG_VACUUM_RELAY_GPIO;
+    c->button_gpio = CONFIG_VACUUM_BUTTON_GPIO;
+    c->led_gpio = CONFIG_LED_GPIO;
+    c->led_aux_gpio = CONFIG_LED_AUX_GPIO;
+    c->activation_timeout_s = CONFIG_VACUUM_ACTIVATION_TIMEOUT;
+    strncpy(c->device_name, CONFIG_BT_DEVICE_NAME, APP_CONFIG_NAME_LEN - 1);
+    c->defaults_crc = crc32(c, sizeof(*c));
+    seal(c);
+}
+
+// Flash and RTC copies are always written together
+static esp_err_t save(void)
+{
+    nvs_handle_t handle;
+
+    seal(&config);
+    rtc.config = config;
+
+    esp_err_t ret = nvs_open(APP_CONFIG_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    ret = nvs_set_blob(handle, APP_CONFIG_KEY, &config, sizeof(config));
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save configuration: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+static void load_nvs(void)
+{
+    app_config_t defaults;
+    nvs_handle_t handle;
+    size_t size = sizeof(config);
+    bool dirty = false;
+
+    make_defaults(&defaults);
+
+    esp_err_t ret = nvs_open(APP_CONFIG_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s - using defaults", esp_err_to_name(ret));
+        config = defaults;
+        return;
+    }
+
+    ret = nvs_get_blob(handle, APP_CONFIG_KEY, &config, &size);
+    if (ret != ESP_OK || size != sizeof(config) || !config_valid(&config)) {
+        ESP_LOGW(TAG, "No valid configuration stored (%s) - using defaults",
+                 ret == ESP_OK ? "bad size, version or CRC" : esp_err_to_name(ret));
+        config = defaults;
+        dirty = true;
+    } else if (config.defaults_crc != defaults.defaults_crc) {
+        // Keep what the user set at runtime, take everything else from Kconfig
+        ESP_LOGI(TAG, "Kconfig defaults changed - updating configuration");
+        defaults.auto_mode = config.auto_mode;
+        defaults.paired_count = config.paired_count;
+        memcpy(defaults.paired, config.paired, sizeof(defaults.paired));
+        config = defaults;
+        dirty = true;
+    }
+    nvs_close(handle);
+
+    if (dirty) {
+        save();
+    }
+    rtc.config = config;
+}
+
+static bool warm_reset(esp_reset_reason_t reason)
+{
+    switch (reason) {
+        case ESP_RST_SW:
+        case ESP_RST_PANIC:
+        case ESP_RST_INT_WDT:
+        case ESP_RST_TASK_WDT:
+        case ESP_RST_WDT:
+        case ESP_RST_BROWNOUT:
+        case ESP_RST_DEEPSLEEP:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool app_config_init(app_live_t *live)
+{
+    esp_reset_reason_t reason = esp_reset_reason();
+
+    if (warm_reset(reason) && rtc.magic == APP_RTC_MAGIC && config_valid(&rtc.config) &&
+        rtc.live_crc == crc32(&rtc.live, sizeof(rtc.live))) {
+        app_config_t defaults;
+        make_defaults(&defaults);
+        if (rtc.config.defaults_crc == defaults.defaults_crc) {
+            config = rtc.config;
+        } else {
+            // Flashing a build with other Kconfig values can be a warm reset;
+            // the blob is merged with the new defaults as on a cold boot
+            ESP_LOGI(TAG, "RTC copy made from other Kconfig defaults - reloading");
+            load_nvs();
+        }
+        *live = rtc.live;
+        ESP_LOGI(TAG, "Warm restart (reset reason %d) - state restored from RTC memory", reason);
+        return true;
+    }
+
+    load_nvs();
+    live->state = VACUUM_STATE_IDLE;
+    live->auto_mode = config.auto_mode;
+    rtc.live = *live;
+    rtc.live_crc = crc32(&rtc.live, sizeof(rtc.live));
+    rtc.magic = APP_RTC_MAGIC;
+    return false;
+}
+
+const app_config_t *app_config(void)
+{
+    return &config;
+}
+
+esp_err_t app_config_set_paired(const uint8_t (*paired)[6], uint8_t count)
+{
+    if (count > TOOL_PAIRED_MAX) {
+        count = TOOL_PAIRED_MAX;
+    }
+    memset(config.paired, 0, sizeof(config.paired));
+    memcpy(config.paired, paired, (size_t)count * 6);
+    config.paired_count = count;
+    return save();
+}
+
+esp_err_t app_config_set_auto_mode(bool auto_mode)
+{
+    if (config.auto_mode == auto_mode) {
+        return ESP_OK;
+    }
+    config.auto_mode = auto_mode;
+    return save();
+}
+
+void app_config_note_live(vacuum_state_t state, bool auto_mode)
+{
+    // A reset between these writes leaves a bad CRC, i.e. a cold boot
+    rtc.live.state = (uint8_t)state;
+    rtc.live.auto_mode = auto_mode;
+    rtc.live_crc = crc32(&rtc.live, sizeof(rtc.live));
+}
@@ -0,0 +1,99 @@
+#ifndef APP_CONFIG_H
+#define APP_CONFIG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "tool_registry.h"
+#include "vacuum_sm.h"
+
+// Runtime configuration, stored as one packed, CRC-protected, versioned NVS
+// blob and read once at boot. The Kconfig options are the defaults for the
+// first boot, and again whenever they change.
+//
+// A copy of the configuration and the live state (vacuum state, automatic
+// mode) is kept in RTC slow memory, which survives software, panic and
+// watchdog resets. After such a reset app_config_init() restores both from
+// there without reading flash, unless the copy was made from other Kconfig
+// defaults.
+
+#define APP_CONFIG_VERSION      1
+#define APP_CONFIG_NAME_LEN     32
+
+/**
+ * @brief Persistent configuration (NVS blob layout, little-endian)
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t version;                // APP_CONFIG_VERSION
+    uint8_t reserved;
+    uint16_t size;                  // sizeof(app_config_t)
+    uint32_t defaults_crc;          // CRC of the Kconfig defaults it was made from
+    int8_t relay_gpio;
+    int8_t button_gpio;
+    int8_t led_gpio;
+    int8_t led_aux_gpio;            // -1 if not fitted
+    uint16_t activation_timeout_s;  // Manual activation hold
+    uint8_t auto_mode;              // Automatic mode at power-on
+    uint8_t paired_count;
+    uint8_t paired[TOOL_PAIRED_MAX][6];
+    char device_name[APP_CONFIG_NAME_LEN];
+    uint32_t crc;                   // CRC-32 of everything before it
+} app_config_t;
+
+/**
+ * @brief Live state carried across a warm restart
+ */
+typedef struct {
+    uint8_t state;                  // vacuum_state_t
+    uint8_t auto_mode;
+} app_live_t;
+
+/**
+ * @brief Load the configuration: from RTC memory after a warm restart,
+ * otherwise from NVS, falling back to the Kconfig defaults
+ *
+ * Call once, after nvs_flash_init(), before app_config().
+ *
+ * @param live Set to the state before the reset, or zeroed after a cold boot
+ * @return true on a warm restart
+ */
+bool app_config_init(app_live_t *live);
+
+/**
+ * @brief Current configuration
+ * @return Configuration (read only)
+ */
+const app_config_t *app_config(void);
+
+/**
+ * @brief Store the paired tools in NVS and RTC memory
+ *
+ * Blocks on flash; call from the console task (or app_main) only.
+ *
+ * @param paired Paired addresses
+ * @param count Number of addresses
+ * @return ESP_OK on success
+ */
+esp_err_t app_config_set_paired(const uint8_t (*paired)[6], uint8_t count);
+
+/**
+ * @brief Store the power-on automatic mode, if it changed
+ *
+ * Blocks on flash when it writes; call from the console task (or app_main) only.
+ *
+ * @param auto_mode Automatic mode
+ * @return ESP_OK on success
+ */
+esp_err_t app_config_set_auto_mode(bool auto_mode);
+
+/**
+ * @brief Record the live state for a warm restart
+ *
+ * Only writes RTC memory, so it is cheap enough for the reactor.
+ *
+ * @param state Vacuum state
+ * @param auto_mode Automatic mode
+ */
+void app_config_note_live(vacuum_state_t state, bool auto_mode);
+
+#endif // APP_CONFIG_H
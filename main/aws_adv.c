@@ -0,0 +1,133 @@
+#include "aws_adv.h"
+#include "aws_sig_table.h"
+#include <string.h>
+
+const aws_sig_table_t *const aws_sig_table = &aws_sigs;
+
+bool ad_iter_next(ad_iter_t *it, ad_field_t *field)
+{
+    if (it->pos >= it->end) {
+        return false;
+    }
+
+    uint8_t length = it->pos[0];
+    // Length byte covers the type byte plus payload; it must fit in what is left
+    if (length == 0 || (size_t)(it->end - it->pos) <= length) {
+        it->pos = it->end;
+        return false;
+    }
+
+    field->type = it->pos[1];
+    field->len = length - 1;
+    field->data = it->pos + 2;
+    it->pos += length + 1;
+    return true;
+}
+
+bool ad_find(const uint8_t *data, size_t len, uint8_t type, ad_field_t *field)
+{
+    ad_iter_t it;
+    ad_iter_init(&it, data, len);
+    while (ad_iter_next(&it, field)) {
+        if (field->type == type) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t aws_sig_match(const aws_sig_table_t *table, const uint8_t *data, size_t len)
+{
+    if (len > table->max_len) {
+        return 0;
+    }
+    uint32_t bits = table->len_bits[len];
+    for (size_t i = 0; i < len; i++) {
+        bits &= table->byte_bits[i][data[i]];
+    }
+    return bits;
+}
+
+const char *aws_sig_name(uint8_t sig)
+{
+    return sig < aws_sig_table->count ? aws_sig_table->names[sig] : "none";
+}
+
+aws_filter_t aws_adv_prefilter(const uint8_t *adv, size_t len)
+{
+    const aws_sig_table_t *table = aws_sig_table;
+
+    // Length + type + shortest payload
+    if (len < (size_t)table->min_len + 2) {
+        return AWS_FILTER_REJECT_LENGTH;
+    }
+
+    ad_iter_t it;
+    ad_field_t field;
+    ad_iter_init(&it, adv, len);
+    while (ad_iter_next(&it, &field)) {
+        if (field.type != AD_TYPE_MANUFACTURER || field.len > table->max_len) {
+            continue;
+        }
+        uint32_t bits = table->len_bits[field.len];
+        if (bits && (bits & table->byte_bits[0][field.data[0]])) {
+            return AWS_FILTER_PASS;
+        }
+    }
+    return AWS_FILTER_REJECT_MFG;
+}
+
+bool aws_mfg_decode(const uint8_t *data, size_t len, aws_adv_t *out)
+{
+    uint32_t bits = aws_sig_match(aws_sig_table, data, len);
+
+    if (bits == 0) {
+        out->present = false;
+        out->active = false;
+        out->sig = AWS_SIG_NONE;
+        return false;
+    }
+
+    out->present = true;
+    out->active = (bits & aws_sig_table->active_bits) != 0;
+    out->sig = (uint8_t)__builtin_ctz(bits);
+    out->len = (uint8_t)len;
+    memcpy(out->raw, data, len);
+    return true;
+}
+
+bool aws_adv_decode(const uint8_t *adv, size_t len, aws_adv_t *out)
+{
+    ad_iter_t it;
+    ad_field_t field;
+    aws_adv_t mfg;
+
+    memset(out, 0, sizeof(*out));
+    out->sig = AWS_SIG_NONE;
+    ad_iter_init(&it, adv, len);
+
+    while (ad_iter_next(&it, &field)) {
+        if (field.type != AD_TYPE_MANUFACTURER ||
+            !aws_mfg_decode(field.data, field.len, &mfg)) {
+            continue;
+        }
+        // Keep the first match, but let a later active structure win
+        if (!out->present || (mfg.active && !out->active)) {
+            *out = mfg;
+        }
+        if (out->active) {
+            break;
+        }
+    }
+
+    return out->present;
+}
+
+uint32_t aws_adv_hash(const uint8_t *adv, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ adv[i]) * 16777619u;
+    }
+    return h;
+}
@@ -0,0 +1,189 @@
+#ifndef AWS_ADV_H
+#define AWS_ADV_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// AD structure types (Bluetooth Core Specification Supplement, Part A)
+#define AD_TYPE_FLAGS               0x01
+#define AD_TYPE_UUID16_INCOMPLETE   0x02
+#define AD_TYPE_UUID16_COMPLETE     0x03
+#define AD_TYPE_UUID128_INCOMPLETE  0x06
+#define AD_TYPE_UUID128_COMPLETE    0x07
+#define AD_TYPE_NAME_SHORT          0x08
+#define AD_TYPE_NAME_COMPLETE       0x09
+#define AD_TYPE_SERVICE_DATA16      0x16
+#define AD_TYPE_MANUFACTURER        0xFF
+
+// Makita AWS manufacturer payloads (AD type 0xFF, no company ID) are
+// described in aws_signatures.txt, which tools/aws_sig_gen.py compiles into
+// the match tables of aws_sig_match()
+#define AWS_SIG_MAX_LEN             8       // Longest payload a signature can describe
+#define AWS_SIG_NONE                0xFF    // aws_adv_t.sig when nothing matched
+
+// Tools stop advertising "active" when the motor stops; treat the tool as
+// off once no active advert has been seen for this long (AWS protocol)
+#define AWS_POWER_OFF_DELAY_US      1000000
+
+/**
+ * @brief One AD structure, referencing the advertisement buffer (no copy)
+ */
+typedef struct {
+    uint8_t type;           // AD type byte
+    uint8_t len;            // Payload length, excluding the type byte
+    const uint8_t *data;    // Payload, points into the advertisement buffer
+} ad_field_t;
+
+/**
+ * @brief Bounds-checked iterator over the AD structures of one advertisement
+ */
+typedef struct {
+    const uint8_t *pos;
+    const uint8_t *end;
+} ad_iter_t;
+
+/**
+ * @brief Result of the cheap pre-filter run before any full decode
+ */
+typedef enum {
+    AWS_FILTER_PASS,            // Candidate, needs the full decode
+    AWS_FILTER_REJECT_LENGTH,   // Too short to hold an AWS structure
+    AWS_FILTER_REJECT_MFG,      // No AWS-shaped manufacturer structure
+} aws_filter_t;
+
+/**
+ * @brief Compiled signature table (generated, see aws_signatures.txt)
+ *
+ * Bit n of every word stands for signature n. byte_bits[i][b] holds the
+ * signatures accepting byte value b at payload offset i, len_bits[n] the
+ * signatures of payload length n.
+ */
+typedef struct {
+    const uint32_t (*byte_bits)[256];   // [max_len][256]
+    const uint32_t *len_bits;           // [max_len + 1]
+    const char *const *names;           // [count]
+    uint32_t active_bits;               // Signatures meaning the motor runs
+    uint8_t count;
+    uint8_t min_len;
+    uint8_t max_len;
+} aws_sig_table_t;
+
+/**
+ * @brief Decoded AWS manufacturer data
+ */
+typedef struct {
+    bool present;                   // AWS tool signature matched
+    bool active;                    // Tool reports it is running
+    uint8_t sig;                    // First matching signature, AWS_SIG_NONE if none
+    uint8_t len;                    // Payload length
+    uint8_t raw[AWS_SIG_MAX_LEN];   // Matched manufacturer payload
+} aws_adv_t;
+
+/**
+ * @brief The firmware's signature table, from aws_signatures.txt
+ */
+extern const aws_sig_table_t *const aws_sig_table;
+
+/**
+ * @brief Start iterating over an advertisement payload
+ * @param it Iterator to initialize
+ * @param data Raw AD bytes
+ * @param len Number of AD bytes
+ */
+static inline void ad_iter_init(ad_iter_t *it, const uint8_t *data, size_t len)
+{
+    it->pos = data;
+    it->end = data + len;
+}
+
+/**
+ * @brief Fetch the next AD structure
+ *
+ * Stops at the first zero-length structure or at a structure that would run
+ * past the end of the buffer, so truncated adverts are never over-read.
+ *
+ * @param it Iterator
+ * @param field Filled with the next structure on success
+ * @return true if a structure was returned, false at the end of the payload
+ */
+bool ad_iter_next(ad_iter_t *it, ad_field_t *field);
+
+/**
+ * @brief Find the first AD structure of a given type
+ * @param data Raw AD bytes
+ * @param len Number of AD bytes
+ * @param type AD type to look for
+ * @param field Filled with the structure on success
+ * @return true if found
+ */
+bool ad_find(const uint8_t *data, size_t len, uint8_t type, ad_field_t *field);
+
+/**
+ * @brief Match a manufacturer payload against a signature table
+ *
+ * One table lookup per payload byte ANDed together, whatever the number of
+ * signatures.
+ *
+ * @param table Compiled signatures
+ * @param data Manufacturer payload (AD type byte excluded)
+ * @param len Payload length
+ * @return Set of matching signatures, bit n for signature n; 0 if none
+ */
+uint32_t aws_sig_match(const aws_sig_table_t *table, const uint8_t *data, size_t len);
+
+/**
+ * @brief Name of a signature in the firmware's table
+ * @param sig Signature index, as in aws_adv_t.sig
+ * @return Name from aws_signatures.txt, "none" for AWS_SIG_NONE
+ */
+const char *aws_sig_name(uint8_t sig);
+
+/**
+ * @brief Cheap reject test for non-AWS adverts
+ *
+ * Only looks at structure lengths, types and the first manufacturer byte
+ * (whether any signature of that length accepts it), so phones, beacons and
+ * headphones are dropped before aws_adv_decode().
+ *
+ * @param adv Raw AD bytes
+ * @param len Number of AD bytes
+ * @return AWS_FILTER_PASS for candidates, otherwise the rejecting stage
+ */
+aws_filter_t aws_adv_prefilter(const uint8_t *adv, size_t len);
+
+/**
+ * @brief Decode one manufacturer-data payload as an AWS tool status
+ * @param data Manufacturer payload (AD type byte excluded)
+ * @param len Payload length
+ * @param out Decoded result; cleared when the payload is not AWS
+ * @return true if the payload carries the AWS signature
+ */
+bool aws_mfg_decode(const uint8_t *data, size_t len, aws_adv_t *out);
+
+/**
+ * @brief Decode a complete advertisement payload
+ *
+ * Walks every AD structure; a tool is reported active if any of its AWS
+ * manufacturer structures says so.
+ *
+ * @param adv Raw AD bytes
+ * @param len Number of AD bytes
+ * @param out Decoded result
+ * @return true if an AWS tool signature was found
+ */
+bool aws_adv_decode(const uint8_t *adv, size_t len, aws_adv_t *out);
+
+/**
+ * @brief 32-bit FNV-1a hash of an advertisement payload
+ *
+ * A quick reject before comparing a tool's advert with its last one, so a
+ * repeated payload is recognised without decoding it.
+ *
+ * @param adv Raw AD bytes
+ * @param len Number of AD bytes
+ * @return Hash
+ */
+uint32_t aws_adv_hash(const uint8_t *adv, size_t len);
+
+#endif // AWS_ADV_H
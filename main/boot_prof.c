@@ -0,0 +1,86 @@
+#include "boot_prof.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include "esp_log.h"
+
+static const char *TAG = "BOOT_PROF";
+
+// 0 = not reached; a 32-bit microsecond stamp covers the first 71 minutes
+static atomic_uint marks[BOOT_MS_COUNT];
+
+static const char *const ms_names[BOOT_MS_COUNT] = {
+    [BOOT_MS_APP_MAIN] = "app_main",
+    [BOOT_MS_NVS] = "nvs",
+    [BOOT_MS_CONFIG] = "config",
+    [BOOT_MS_BT_START] = "bt start",
+    [BOOT_MS_LED] = "led",
+    [BOOT_MS_INPUT] = "input",
+    [BOOT_MS_RELAY] = "relay",
+    [BOOT_MS_BT_READY] = "bt ready",
+    [BOOT_MS_TASKS] = "tasks",
+    [BOOT_MS_NIMBLE_SYNC] = "nimble sync",
+    [BOOT_MS_SCAN] = "scan",
+    [BOOT_MS_FIRST_ADVERT] = "first advert",
+    [BOOT_MS_FIRST_DETECTION] = "first detection",
+};
+
+void boot_prof_mark(boot_ms_t ms, int64_t timestamp_us)
+{
+    // Cheap enough for the advert path once the milestone is set
+    if (atomic_load_explicit(&marks[ms], memory_order_relaxed) != 0) {
+        return;
+    }
+    unsigned t = timestamp_us < 1 ? 1 : timestamp_us > UINT32_MAX ? UINT32_MAX : (unsigned)timestamp_us;
+    unsigned unset = 0;
+    atomic_compare_exchange_strong_explicit(&marks[ms], &unset, t,
+                                            memory_order_relaxed, memory_order_relaxed);
+}
+
+uint32_t boot_prof_get(boot_ms_t ms)
+{
+    return atomic_load_explicit(&marks[ms], memory_order_relaxed);
+}
+
+const char *boot_prof_name(boot_ms_t ms)
+{
+    return ms < BOOT_MS_COUNT ? ms_names[ms] : "?";
+}
+
+void boot_prof_report(void)
+{
+    uint32_t t[BOOT_MS_COUNT];
+    bool done[BOOT_MS_COUNT] = { false };
+    uint32_t prev = 0;
+
+    for (int i = 0; i < BOOT_MS_COUNT; i++) {
+        t[i] = boot_prof_get(i);
+    }
+
+    // Milestones on parallel paths interleave, so print them by time
+    ESP_LOGI(TAG, "Boot profile (us since app start):");
+    for (;;) {
+        int next = -1;
+        for (int i = 0; i < BOOT_MS_COUNT; i++) {
+            if (!done[i] && t[i] != 0 && (next < 0 || t[i] < t[next])) {
+                next = i;
+            }
+        }
+        if (next < 0) {
+            break;
+        }
+        done[next] = true;
+        ESP_LOGI(TAG, "  %-16s %9lu  +%lu", ms_names[next],
+                 (unsigned long)t[next], (unsigned long)(t[next] - prev));
+        prev = t[next];
+    }
+    for (int i = 0; i < BOOT_MS_COUNT; i++) {
+        if (t[i] == 0) {
+            ESP_LOGI(TAG, "  %-16s not reached", ms_names[i]);
+        }
+    }
+    if (t[BOOT_MS_FIRST_DETECTION]) {
+        ESP_LOGI(TAG, "App start to first detection: %lu ms, to scanning: %lu ms",
+                 (unsigned long)(t[BOOT_MS_FIRST_DETECTION] / 1000),
+                 (unsigned long)(t[BOOT_MS_SCAN] / 1000));
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef BOOT_PROF_H
+#define BOOT_PROF_H
+
+#include <stdint.h>
+
+// Boot milestones from app start to the first tool detection, each stamped
+// once with esp_timer_get_time(). Time zero is when esp_timer starts, right
+// after the ROM and second-stage bootloader hand over to the app; the
+// bootloader's own share is in its log timestamps.
+typedef enum {
+    BOOT_MS_APP_MAIN,           // app_main() entered
+    BOOT_MS_NVS,                // nvs_flash_init() done
+    BOOT_MS_CONFIG,             // Configuration loaded (RTC or NVS)
+    BOOT_MS_BT_START,           // BLE controller and host bring-up started
+    BOOT_MS_LED,                // led_init() done
+    BOOT_MS_INPUT,              // Button sampling started
+    BOOT_MS_RELAY,              // Relay and state machine ready
+    BOOT_MS_BT_READY,           // bt_manager_init() returned
+    BOOT_MS_TASKS,              // Application tasks started
+    BOOT_MS_NIMBLE_SYNC,        // NimBLE host synced with the controller
+    BOOT_MS_SCAN,               // GAP discovery running
+    BOOT_MS_FIRST_ADVERT,       // First advert of any kind received
+    BOOT_MS_FIRST_DETECTION,    // First tool that may drive the vacuum detected
+    BOOT_MS_COUNT
+} boot_ms_t;
+
+/**
+ * @brief Record a milestone; only the first call per milestone counts
+ *
+ * Lock-free, safe from any task.
+ *
+ * @param ms Milestone
+ * @param timestamp_us esp_timer_get_time() when it was reached
+ */
+void boot_prof_mark(boot_ms_t ms, int64_t timestamp_us);
+
+/**
+ * @brief Time a milestone was reached
+ * @param ms Milestone
+ * @return Microseconds since app start, 0 if not reached yet
+ */
+uint32_t boot_prof_get(boot_ms_t ms);
+
+/**
+ * @brief Name of a milestone
+ * @param ms Milestone
+ * @return Constant string
+ */
+const char *boot_prof_name(boot_ms_t ms);
+
+/**
+ * @brief Log every milestone reached, in time order, with the step from
+ * the previous one
+ */
+void boot_prof_report(void);
+
+#endif // BOOT_PROF_H
@@ -1,4 +1,20 @@
 #include "bt_manager.h"
+#include "aws_adv.h"
+#include "adv_capture.h"
+#include "adv_ring.h"
+#include "vacuum_sm.h"
+#include "lat_trace.h"
+#include "tool_presence.h"
+#include "tool_store.h"
+#include "app_config.h"
+#include "boot_prof.h"
+#include "dlog.h"
+#include "led_control.h"
+#include "power_mgmt.h"
+#include "static_alloc.h"
+#include "metrics.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
 #include <string.h>
 #include <stdio.h>
 #include "esp_log.h"
@@ -13,7 +29,6 @@
 
 static const char *TAG = "AWS_BLE_MANAGER";
 
-static EventGroupHandle_t app_event_group = NULL;
 // static bool aws_tool_detected = false;
 static bool ble_scanning = false;
 static bool nimble_synced = false;
@@ -26,175 +41,206 @@ static bool nimble_synced = false;
 // #define AWS_TOOL_ACTIVE_DATA    0x01
 // #define AWS_TOOL_IDLE_DATA      0x00
 
-// Scan parameters for AWS tool detection - More aggressive scanning
+// Scan parameters for AWS tool detection; interval, window and scan type
+// come from the current scan policy profile
 static struct ble_gap_disc_params ble_scan_params = {
-    .itvl = 0x30,    // 30ms (in 0.625ms units) - Faster interval
-    .window = 0x30,  // 30ms (in 0.625ms units) - 100% duty cycle
     .filter_policy = 0, // Accept all
     .limited = 0,    // General discovery
-    .passive = 0,    // Active scanning to get more data
-    .filter_duplicates = 0  // Don't filter duplicates - see all advertisements
 };
 
-static void aws_tool_power_off_timer_cb(void *arg)
+// Tools in range, their power-off deadlines, the scan policy and the
+// pre-start predictor, shared by the NimBLE host task, the esp_timer task,
+// the reactor (state machine) and the console task. The mutex also orders
+// the edge events those paths post.
+static tool_presence_t presence;
+static SemaphoreHandle_t state_mutex = NULL;
+STATIC_MUTEX_STORAGE(state)
+static uint32_t scan_restarts = 0;
+
+// AWS-shaped adverts handed from the NimBLE host task to the consumer task,
+// which does everything past the prefilter
+#define ADV_CONSUMER_STACK      4096
+#define ADV_CONSUMER_PRIORITY   (configMAX_PRIORITIES - 3)
+
+static adv_ring_t adv_ring;
+static TaskHandle_t adv_consumer = NULL;
+STATIC_TASK_STORAGE(adv_consumer, ADV_CONSUMER_STACK)
+
+static int gap_event_handler(struct ble_gap_event *event, void *arg);
+
+// Called with state_mutex held
+static void start_scan(void)
 {
-    ESP_LOGI(TAG, "⏰ AWS tool power-off delay expired - deactivating vacuum");
-    
-    if (app_event_group) {
-        xEventGroupClearBits(app_event_group, TOOL_POWER_ON_BIT);
+    const scan_params_t *params = scan_profile_params(presence.scan.profile);
+    ble_scan_params.itvl = params->itvl;
+    ble_scan_params.window = params->window;
+    ble_scan_params.passive = params->passive;
+    ble_scan_params.filter_duplicates = params->filter_duplicates;
+
+    int rc = ble_gap_disc(BLE_OWN_ADDR_PUBLIC, BLE_HS_FOREVER, &ble_scan_params,
+                          gap_event_handler, NULL);
+    ble_scanning = rc == 0;
+    scan_restarts++;
+    if (rc != 0) {
+        ESP_LOGE(TAG, "Failed to start scanning: %d", rc);
     }
 }
 
-static esp_timer_handle_t power_off_timer = NULL;
+// Called with state_mutex held when the scan policy switched profile
+static void scan_profile_changed(scan_profile_t from, scan_profile_t to, void *ctx)
+{
+    if (nimble_synced) {
+        ble_gap_disc_cancel();
+        start_scan();
+    }
+}
 
-static void start_power_off_timer(void)
+#ifdef CONFIG_VACUUM_PRESTART_ENABLE
+// Called with state_mutex held: a pre-start window keeps the CPU and radio
+// out of light sleep until the tool starts or the window runs out
+static void prestart_hold(bool hold, void *ctx)
 {
-    // Stop existing timer if running
-    if (power_off_timer) {
-        esp_timer_stop(power_off_timer);
+    if (hold) {
+        power_mgmt_lock();
+    } else {
+        power_mgmt_unlock();
     }
+}
+#endif
+
+static void scan_timer_cb(void *arg)
+{
+    int64_t now = esp_timer_get_time();
 
-    // Start 1-second delay timer (as per AWS protocol)
-    esp_timer_start_once(power_off_timer, 1000000); // 1 second in microseconds
+    pm_note_wake(PM_WAKE_SCAN_TIMER);
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    tool_presence_scan_expired(&presence, now);
+    xSemaphoreGive(state_mutex);
 }
 
-static void process_aws_advertisement(const struct ble_gap_disc_desc *disc)
+static void aws_tool_power_off_timer_cb(void *arg)
 {
-    const uint8_t *adv_data = disc->data;
-    uint16_t adv_len = disc->length_data;
-    
-    bool aws_tool_active = false;
-    bool potential_aws_device = false;
-    
-    // Log raw advertisement data for debugging
-    ESP_LOGD(TAG, "📡 Processing advertisement, length: %d", adv_len);
-    
-    // Parse advertisement data for AWS service UUID and device name
-    for (int i = 0; i < adv_len; ) {
-        if (i >= adv_len) break;
-        
-        uint8_t length = adv_data[i];
-        if (length == 0 || i + length >= adv_len) break;
-        
-        uint8_t type = adv_data[i + 1];
-        const uint8_t *data = &adv_data[i + 2];
-        
-        ESP_LOGV(TAG, "AD type: 0x%02X, length: %d", type, length - 1);
-        
-        // Check for complete/incomplete local name (type 0x08, 0x09)
-        // if (type == 0x08 || type == 0x09) {
-        //     char name[32] = {0};
-        //     int name_len = (length - 1) < 31 ? (length - 1) : 31;
-        //     memcpy(name, data, name_len);
-        //     ESP_LOGD(TAG, "📱 Device name: %s", name);
-            
-        //     // Check for AWS/Makita device names
-        //     if (strstr(name, "AWS") || strstr(name, "MAKITA") || 
-        //         strstr(name, "aws") || strstr(name, "makita") ||
-        //         strstr(name, "TOOL")) {
-        //         potential_aws_device = true;
-        //         ESP_LOGI(TAG, "🎯 Potential AWS device name found: %s", name);
-        //     }
-        // }
-        
-        // Check for 16-bit service UUIDs (type 0x02, 0x03)
-        // else if ((type == 0x02 || type == 0x03) && (length - 1) >= 2) {
-        //     for (int j = 0; j < (length - 1); j += 2) {
-        //         uint16_t uuid = (data[j + 1] << 8) | data[j];
-        //         ESP_LOGV(TAG, "16-bit Service UUID: 0x%04X", uuid);
-        //         if (uuid == 0xFFF0) {  // AWS service UUID (16-bit version)
-        //             aws_service_found = true;
-        //             ESP_LOGI(TAG, "🔍 Found AWS 16-bit service UUID: 0xFFF0");
-        //         }
-        //     }
-        // }
-        
-        // Check for 128-bit service UUID (type 0x06 or 0x07)
-        // else if ((type == 0x06 || type == 0x07) && (length - 1) == 16) {
-        //     // Compare with AWS service UUID
-        //     uint8_t aws_uuid[] = AWS_SERVICE_UUID_128;
-        //     if (memcmp(data, aws_uuid, 16) == 0) {
-        //         aws_service_found = true;
-        //         ESP_LOGI(TAG, "🔍 Found AWS 128-bit service UUID in advertisement");
-        //     }
-            
-        //     // Log UUID for debugging
-        //     ESP_LOGD(TAG, "128-bit UUID: %02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
-        //             data[15], data[14], data[13], data[12],
-        //             data[11], data[10], data[9], data[8],
-        //             data[7], data[6], data[5], data[4],
-        //             data[3], data[2], data[1], data[0]);
-        // }
-        
-        // Check for manufacturer data that might contain tool status
-        if (type == 0xFF && (length - 1) == 4) {
-            ESP_LOGD(TAG, "📦 Manufacturer data found, length: %d, %x,%x, %x,%x", length - 1, data[0], data[1], data[2], data[3]);
-            
-            // Check for AWS tool active pattern
-            if (((data[0]&0xfc) == 0xfc && (data[2] == 3 || data[2] == 6) && data[3] == 6)) {
-                potential_aws_device = true;
-                ESP_LOGD(TAG, "🔋 AWS tool detected");
-                if (data[0] == 0xfd && data[1] == 0xaa) {
-                    ESP_LOGD(TAG, "🔋 AWS tool ACTIVE signal detected in manufacturer data");
-                    aws_tool_active = true;
-                }
-            }
-        }
-        
-        // Check for service data
-        // else if (type == 0x16 && (length - 1) >= 2) {
-        //     uint16_t service_uuid = (data[1] << 8) | data[0];
-        //     ESP_LOGV(TAG, "Service data for UUID: 0x%04X", service_uuid);
-        //     if (service_uuid == 0xFFF0) {
-        //         aws_service_found = true;
-        //         ESP_LOGI(TAG, "🔍 Found AWS service data");
-        //     }
-        // }
-        
-        i += length + 1;
+    int64_t now = esp_timer_get_time();
+
+    pm_note_wake(PM_WAKE_POWER_TIMER);
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    tool_presence_power_off_expired(&presence, now);
+    xSemaphoreGive(state_mutex);
+}
+
+#ifdef CONFIG_VACUUM_PRESTART_ENABLE
+static void prestart_timer_cb(void *arg)
+{
+    int64_t now = esp_timer_get_time();
+
+    pm_note_wake(PM_WAKE_PRESTART_TIMER);
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    tool_presence_prestart_expired(&presence, now);
+    xSemaphoreGive(state_mutex);
+}
+#endif
+
+static bt_filter_stats_t filter_stats;
+
+static void process_aws_advertisement(const adv_ring_rec_t *rec)
+{
+    const uint8_t *a = rec->addr;
+
+    // Stages 3-4: repeat cache, decode, tool registry and edge events
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    tool_presence_seen_t seen = tool_presence_process(&presence, a, rec->rssi, rec->data,
+                                                      rec->len, rec->rx_time_us);
+    xSemaphoreGive(state_mutex);
+
+    const aws_adv_t *aws = &seen.adv;
+    if (!seen.aws) {
+        filter_stats.reject_decode++;
+    } else if (seen.repeat) {
+        filter_stats.known_hits++;
+        filter_stats.repeat_hits++;
+    } else if (seen.known) {
+        filter_stats.known_hits++;
+        DLOG(DLOG_AWS_ADVERT,
+             (uint32_t)a[0] << 16 | a[1] << 8 | a[2], (uint32_t)a[3] << 16 | a[4] << 8 | a[5],
+             (uint32_t)rec->rssi,
+             (uint32_t)aws->raw[0] << 24 | aws->raw[1] << 16 | aws->raw[2] << 8 | aws->raw[3]);
+    } else {
+        filter_stats.new_tools++;
+        ESP_LOGI(TAG, "🎯 New AWS tool %02x:%02x:%02x:%02x:%02x:%02x (%s), RSSI: %d dBm%s",
+                 a[0], a[1], a[2], a[3], a[4], a[5], aws_sig_name(aws->sig), rec->rssi,
+                 seen.may_drive ? "" : " (not paired)");
     }
-    
-    // Detect AWS tool based on service UUID OR potential device name
-    if (potential_aws_device && app_event_group) {
-        xEventGroupSetBits(app_event_group, BT_CONNECTED_BIT);
-
-        if(aws_tool_active) {
-            // Reset the power-off timer since we're still seeing the tool
-            // ESP_LOGI(TAG, "🔌 AWS tool ACTIVATED");
-            xEventGroupSetBits(app_event_group, TOOL_POWER_ON_BIT);
-            start_power_off_timer();
+}
+
+// Drains the advert ring in batches. The host task wakes it only when the
+// ring goes from empty to non-empty, so a burst of adverts costs one wake-up.
+static void adv_consumer_task(void *arg)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        pm_note_wake(PM_WAKE_ADV_CONSUMER);
+
+        uint32_t batch = 0;
+        const adv_ring_rec_t *rec;
+        while ((rec = adv_ring_peek(&adv_ring)) != NULL) {
+            lat_trace_record(LAT_STAGE_DEQUEUE, rec->rx_time_us);
+            process_aws_advertisement(rec);
+            adv_ring_pop(&adv_ring);
+            batch++;
+        }
+        if (batch) {
+            filter_stats.batches++;
+            if (batch > filter_stats.batch_max) {
+                filter_stats.batch_max = batch;
+            }
         }
     }
 }
 
 static int gap_event_handler(struct ble_gap_event *event, void *arg)
 {
+    int64_t rx_time_us;
+
     switch (event->type) {
         case BLE_GAP_EVENT_DISC:
-            // Discovery event - advertisement received
-            {
-                char addr_str[18];
-                snprintf(addr_str, sizeof(addr_str), "%02x:%02x:%02x:%02x:%02x:%02x",
-                         event->disc.addr.val[0], event->disc.addr.val[1], event->disc.addr.val[2],
-                         event->disc.addr.val[3], event->disc.addr.val[4], event->disc.addr.val[5]);
-                
-                // Log all devices with decent signal strength
-                if (event->disc.rssi > -70) {
-                    ESP_LOGD(TAG, "📱 BLE device: %s, RSSI: %d dBm, AD len: %d", 
-                            addr_str, event->disc.rssi, event->disc.length_data);
-                } else {
-                    ESP_LOGV(TAG, "📱 BLE device: %s, RSSI: %d dBm (weak)", addr_str, event->disc.rssi);
+            // Discovery event - advertisement received. Reject non-AWS adverts
+            // here at a fixed cost and hand the rest to the consumer task, so
+            // the host task never formats, logs or waits on state_mutex.
+            rx_time_us = esp_timer_get_time();
+            pm_note_wake(PM_WAKE_ADVERT);
+            boot_prof_mark(BOOT_MS_FIRST_ADVERT, rx_time_us);
+            filter_stats.adverts++;
+            if (event->disc.event_type == BLE_HCI_ADV_RPT_EVTYPE_SCAN_RSP) {
+                filter_stats.scan_rsp++;
+            }
+            adv_capture_record(event->disc.addr.type, event->disc.addr.val, event->disc.rssi,
+                               event->disc.data, event->disc.length_data);
+            switch (aws_adv_prefilter(event->disc.data, event->disc.length_data)) {
+                case AWS_FILTER_REJECT_LENGTH:
+                    // Stage 1: too short for an AWS manufacturer structure
+                    filter_stats.reject_length++;
+                    break;
+                case AWS_FILTER_REJECT_MFG:
+                    // Stage 2: no AWS-shaped manufacturer structure
+                    filter_stats.reject_mfg++;
+                    break;
+                default: {
+                    bool was_empty;
+                    if (adv_ring_push(&adv_ring, rx_time_us, event->disc.addr.val,
+                                      event->disc.rssi, event->disc.data,
+                                      event->disc.length_data, &was_empty) && was_empty) {
+                        xTaskNotifyGive(adv_consumer);
+                    }
+                    break;
                 }
-                
-                // Process advertisement for AWS protocol
-                process_aws_advertisement(&event->disc);
             }
             break;
             
         case BLE_GAP_EVENT_DISC_COMPLETE:
             ESP_LOGI(TAG, "BLE scan complete, restarting...");
-            ble_gap_disc(BLE_OWN_ADDR_PUBLIC, BLE_HS_FOREVER, &ble_scan_params, 
-                        gap_event_handler, NULL);
+            xSemaphoreTake(state_mutex, portMAX_DELAY);
+            start_scan();
+            xSemaphoreGive(state_mutex);
             break;
             
         default:
@@ -212,28 +258,29 @@ static void on_nimble_reset(int reason)
 
 static void on_nimble_sync(void)
 {
+    boot_prof_mark(BOOT_MS_NIMBLE_SYNC, esp_timer_get_time());
     ESP_LOGI(TAG, "NimBLE sync completed");
-    nimble_synced = true;
     
     ESP_LOGI(TAG, "✅ NimBLE ready for scanning");
     
-    // Set more aggressive scan parameters for better detection
-    ble_scan_params.itvl = 0x20;    // 20ms - Very fast scanning
-    ble_scan_params.window = 0x20;  // 20ms - 100% duty cycle
-    
-    // Automatically start scanning when sync is complete
-    ESP_LOGI(TAG, "🔍 Starting aggressive AWS tool detection...");
-    ESP_LOGI(TAG, "📋 Scan params: interval=20ms, window=20ms (100% duty cycle)");
-    
-    int rc = ble_gap_disc(BLE_OWN_ADDR_PUBLIC, BLE_HS_FOREVER, &ble_scan_params, 
-                         gap_event_handler, NULL);
-    if (rc == 0) {
-        ble_scanning = true;
-        ESP_LOGI(TAG, "🔍 BLE scanning started - looking for AWS tools");
+    // Automatically start scanning when sync is complete, in whatever
+    // profile the scan policy currently wants
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    nimble_synced = true;
+    start_scan();
+    scan_profile_t profile = presence.scan.profile;
+    const scan_params_t *params = scan_profile_params(profile);
+    xSemaphoreGive(state_mutex);
+
+    if (ble_scanning) {
+        boot_prof_mark(BOOT_MS_SCAN, esp_timer_get_time());
+        ESP_LOGI(TAG, "🔍 BLE scanning started %lld ms after reset - looking for AWS tools",
+                 (long long)(esp_timer_get_time() / 1000));
+        ESP_LOGI(TAG, "📋 Scan profile %s: interval=%u, window=%u (0.625 ms units), %s",
+                 scan_profile_name(profile), params->itvl, params->window,
+                 params->passive ? "passive" : "active");
         // ESP_LOGI(TAG, "📋 Listening for Makita AWS devices (AWS_XXXX, AWSTOOL, MAKITA)");
         // ESP_LOGI(TAG, "📋 Monitoring service UUIDs: 0xFFF0, 0000fff0-0000-1000-8000-00805f9b34fb");
-    } else {
-        ESP_LOGE(TAG, "Failed to start scanning: %d", rc);
     }
 }
 
@@ -244,10 +291,81 @@ void ble_host_task(void *param) {
 
 esp_err_t bt_manager_init(EventGroupHandle_t event_group)
 {
-    app_event_group = event_group;
+#ifdef CONFIG_DEBUG_MODE
     esp_log_level_set(TAG, ESP_LOG_DEBUG);  // only this tag logs at DEBUG or higher
+#endif
     ESP_LOGI(TAG, "🔧 Initializing Makita AWS BLE Scanner...");
 
+    state_mutex = STATIC_MUTEX_CREATE(state);
+    if (state_mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create registry mutex");
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Create the presence timers before the first advert can arrive
+    tool_presence_timers_t timers = { 0 };
+    esp_timer_create_args_t timer_args = {
+        .callback = aws_tool_power_off_timer_cb,
+        .name = "aws_power_off_timer"
+    };
+    
+    esp_err_t ret = esp_timer_create(&timer_args, &timers.power_off);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create power-off timer: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    esp_timer_create_args_t scan_timer_args = {
+        .callback = scan_timer_cb,
+        .name = "scan_policy_timer"
+    };
+    ret = esp_timer_create(&scan_timer_args, &timers.scan);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create scan policy timer: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    tool_presence_cfg_t cfg;
+    tool_presence_cfg_default(&cfg);
+    cfg.events = event_group;
+    cfg.scan_profile_cb = scan_profile_changed;
+#ifdef CONFIG_VACUUM_PRESTART_ENABLE
+    esp_timer_create_args_t prestart_timer_args = {
+        .callback = prestart_timer_cb,
+        .name = "prestart_timer"
+    };
+    ret = esp_timer_create(&prestart_timer_args, &timers.prestart);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create pre-start timer: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    cfg.prestart_hold_cb = prestart_hold;
+#endif
+
+    tool_presence_init(&presence, &cfg, &timers);
+#ifdef CONFIG_VACUUM_PROXIMITY_ENABLE
+    proximity_cfg_t prox_cfg;
+    proximity_cfg_default(&prox_cfg);
+    tool_registry_set_proximity(&presence.registry, &prox_cfg);
+    ESP_LOGI(TAG, "Proximity gate: enter %d dBm, exit %d dBm", prox_cfg.enter_dbm, prox_cfg.exit_dbm);
+#endif
+    if (tool_store_load(&presence.registry) != ESP_OK) {
+        ESP_LOGI(TAG, "No paired tools - any AWS tool will drive the vacuum");
+    }
+
+    // The consumer must exist before the first advert is queued
+    adv_ring_init(&adv_ring);
+    BaseType_t created = STATIC_TASK_CREATE(adv_consumer, adv_consumer_task, "adv_consumer",
+                                            ADV_CONSUMER_STACK, NULL, ADV_CONSUMER_PRIORITY,
+                                            &adv_consumer,
+                                            CONFIG_ADV_CONSUMER_CORE < 0 ? tskNO_AFFINITY
+                                                                         : CONFIG_ADV_CONSUMER_CORE);
+    if (created != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create advert consumer task");
+        return ESP_ERR_NO_MEM;
+    }
+    metrics_note_task("adv_consumer", ADV_CONSUMER_STACK);
+
     // Initialize NimBLE host
     nimble_port_init();
 
@@ -260,18 +378,6 @@ esp_err_t bt_manager_init(EventGroupHandle_t event_group)
 
     ESP_LOGI(TAG, "✅ NimBLE initialized successfully");
     
-    // Create power-off delay timer
-    esp_timer_create_args_t timer_args = {
-        .callback = aws_tool_power_off_timer_cb,
-        .name = "aws_power_off_timer"
-    };
-    
-    esp_err_t ret = esp_timer_create(&timer_args, &power_off_timer);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to create power-off timer: %s", esp_err_to_name(ret));
-        return ret;
-    }
-    
     ESP_LOGD(TAG, "✅ Makita AWS BLE Scanner initialized successfully");
     ESP_LOGI(TAG, "🔍 Ready to detect AWS tool power events");
     
@@ -282,18 +388,152 @@ esp_err_t bt_aws_tool_on(void)
 {
     ESP_LOGI(TAG, "🔌 Manual AWS tool ON");
     
-    if (app_event_group) {
-        xEventGroupSetBits(app_event_group, TOOL_POWER_ON_BIT);
-        xEventGroupSetBits(app_event_group, BT_CONNECTED_BIT);
-    }
-    
-    start_power_off_timer();
+    int64_t now = esp_timer_get_time();
+    int64_t hold_us = (int64_t)app_config()->activation_timeout_s * 1000000;
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    tool_presence_manual_on(&presence, now, hold_us);
+    xSemaphoreGive(state_mutex);
     return ESP_OK;
 }
 
+void bt_scan_follow_state(vacuum_state_t state)
+{
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    tool_presence_follow_state(&presence, state, esp_timer_get_time());
+    xSemaphoreGive(state_mutex);
+}
+
 void bt_aws_print_status(void)
 {
+    static uint32_t last_timer_calls = 0;
+    static uint32_t last_adverts = 0;
+    static int64_t last_status_us = 0;
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    bool armed = presence.power_off_armed;
+    uint32_t calls = presence.timer_calls;
+    scan_profile_t profile = presence.scan.profile;
+    uint32_t switches = presence.scan.switches;
+    uint32_t restarts = scan_restarts;
+    uint8_t count = presence.registry.count;
+    uint8_t paired = presence.registry.paired_count;
+    uint8_t driving = presence.registry.driving;
+    uint32_t evictions = presence.registry.evictions;
+    xSemaphoreGive(state_mutex);
+
+    int64_t now = esp_timer_get_time();
+    int64_t elapsed_us = now - last_status_us;
+    uint32_t adverts = filter_stats.adverts;
+    uint32_t calls_per_s = elapsed_us > 0 ?
+        (uint32_t)((uint64_t)(calls - last_timer_calls) * 1000000 / elapsed_us) : 0;
+    uint32_t adverts_per_s = elapsed_us > 0 ?
+        (uint32_t)((uint64_t)(adverts - last_adverts) * 1000000 / elapsed_us) : 0;
+    last_timer_calls = calls;
+    last_adverts = adverts;
+    last_status_us = now;
+
     ESP_LOGI(TAG, "📊 AWS Tool Status:");
-    ESP_LOGI(TAG, "   BLE scanning: %s", ble_scanning ? "YES" : "NO");
-    ESP_LOGI(TAG, "   Timer active: %s", power_off_timer ? "YES" : "NO");
-}
\ No newline at end of file
+    ESP_LOGI(TAG, "   BLE scanning: %s, profile %s, %lu profile switches, %lu scan restarts",
+             ble_scanning ? "YES" : "NO", scan_profile_name(profile), switches, restarts);
+    ESP_LOGI(TAG, "   Timer active: %s, %lu esp_timer calls (%lu/s)",
+             armed ? "YES" : "NO", calls, calls_per_s);
+    ESP_LOGI(TAG, "   Adverts: %lu (%lu/s, %lu scan responses), rejected length/mfg/decode: %lu/%lu/%lu",
+             adverts, adverts_per_s, filter_stats.scan_rsp, filter_stats.reject_length,
+             filter_stats.reject_mfg, filter_stats.reject_decode);
+    ESP_LOGI(TAG, "   Advert ring: %lu dropped, %lu batches (max %lu adverts)",
+             adv_ring.overflows, filter_stats.batches, filter_stats.batch_max);
+    uint32_t aws_adverts = filter_stats.known_hits + filter_stats.new_tools + filter_stats.reject_decode;
+    ESP_LOGI(TAG, "   AWS adverts: %lu known, %lu new tools, %lu repeats skipped decode (%lu%%)",
+             filter_stats.known_hits, filter_stats.new_tools, filter_stats.repeat_hits,
+             aws_adverts ? filter_stats.repeat_hits * 100 / aws_adverts : 0);
+    ESP_LOGI(TAG, "   Tools: %u tracked, %u paired, %u driving, %lu evicted",
+             count, paired, driving, evictions);
+#ifdef CONFIG_VACUUM_PROXIMITY_ENABLE
+    uint8_t near = 0;
+    int strongest = INT8_MIN;
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    const tool_registry_t *registry = &presence.registry;
+    for (uint8_t e = registry->lru_head; e != TOOL_NONE; e = registry->entries[e].lru_next) {
+        const proximity_t *p = &registry->entries[e].prox;
+        near += p->near;
+        if (proximity_rssi(p) > strongest) {
+            strongest = proximity_rssi(p);
+        }
+    }
+    uint32_t prox_rejects = registry->prox_rejects;
+    xSemaphoreGive(state_mutex);
+    ESP_LOGI(TAG, "   Proximity: %u tools inside %d/%d dBm, strongest %d dBm, %lu active adverts from outside",
+             near, registry->prox_cfg.enter_dbm, registry->prox_cfg.exit_dbm, strongest, prox_rejects);
+#endif
+#ifdef CONFIG_VACUUM_PRESTART_ENABLE
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    prestart_t ps = presence.prestart;
+    xSemaphoreGive(state_mutex);
+    ESP_LOGI(TAG, "   Pre-start: %lu cues, %lu hits, %lu misses, mean lead %lu ms",
+             ps.cues, ps.hits, ps.misses,
+             ps.hits ? (uint32_t)(ps.lead_us / ps.hits / 1000) : 0);
+#endif
+}
+
+// Persist the allow-list outside the mutex (NVS writes block)
+static esp_err_t save_pairings(void)
+{
+    uint8_t paired[TOOL_PAIRED_MAX][6];
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    uint8_t count = presence.registry.paired_count;
+    memcpy(paired, presence.registry.paired, sizeof(paired));
+    xSemaphoreGive(state_mutex);
+
+    return tool_store_save((const uint8_t (*)[6])paired, count);
+}
+
+esp_err_t bt_pair_active_tools(void)
+{
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    int added = tool_presence_pair_active(&presence, esp_timer_get_time());
+    uint8_t total = presence.registry.paired_count;
+    xSemaphoreGive(state_mutex);
+
+    if (added == 0) {
+        ESP_LOGW(TAG, "No running unpaired tools to pair (%u paired)", total);
+        return ESP_ERR_NOT_FOUND;
+    }
+    ESP_LOGI(TAG, "🔐 Paired %d running tools (%u paired)", added, total);
+    led_set_pattern(LED_PATTERN_DOUBLE_FLASH);
+    return save_pairings();
+}
+
+esp_err_t bt_unpair_tools(void)
+{
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    tool_presence_unpair_all(&presence, esp_timer_get_time());
+    xSemaphoreGive(state_mutex);
+
+    ESP_LOGI(TAG, "🔓 Pairings cleared - any AWS tool will drive the vacuum");
+    led_set_pattern(LED_PATTERN_DOUBLE_FLASH);
+    return save_pairings();
+}
+
+void bt_manager_get_filter_stats(bt_filter_stats_t *stats)
+{
+    *stats = filter_stats;
+    stats->ring_drops = adv_ring.overflows;
+    stats->timer_calls = presence.timer_calls;
+}
+
+void bt_get_tool_state(bool *detected, bool *powered)
+{
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    *detected = presence.tool_detected;
+    *powered = presence.tool_powered;
+    xSemaphoreGive(state_mutex);
+}
+
+uint8_t bt_get_driving_tools(uint8_t (*addrs)[6], uint8_t max)
+{
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    uint8_t count = tool_registry_driving_tools(&presence.registry, addrs, max);
+    xSemaphoreGive(state_mutex);
+    return count;
+}
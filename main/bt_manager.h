@@ -4,10 +4,8 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
 #include "esp_err.h"
-
-// External event bits (defined in main.c)
-#define TOOL_POWER_ON_BIT BIT0
-#define BT_CONNECTED_BIT BIT1
+#include "vacuum_sm.h"
+#include "tool_presence.h"     // TOOL_POWER_ON_BIT, BT_CONNECTED_BIT
 
 // BLE Service and Characteristic UUIDs for Makita vacuum control
 // #define MAKITA_SERVICE_UUID "6E400001-B5A3-F393-E0A9-E50E24DCCA9E"
@@ -19,6 +17,30 @@
 // #define AWS_TOOL_KEYWORD "TOOL_ACTIVATED"
 // #define POWER_ON_KEYWORD "POWER_ON"
 
+/**
+ * @brief Advert filter pipeline counters
+ *
+ * Stages 1-2 run on the NimBLE host task, which queues the adverts that pass
+ * for the advert consumer task, where stages 3-4 run. Every advert is counted
+ * in exactly one of the reject counters, ring_drops or known_hits/new_tools.
+ * Only the latter two are formatted and logged, and repeat_hits (a subset of
+ * known_hits) are not even decoded.
+ */
+typedef struct {
+    uint32_t adverts;           // BLE_GAP_EVENT_DISC events received
+    uint32_t reject_length;     // Stage 1: AD payload too short
+    uint32_t reject_mfg;        // Stage 2: no AWS-shaped manufacturer data
+    uint32_t reject_decode;     // Stage 3: AWS signature check failed
+    uint32_t known_hits;        // Stage 4: AWS advert from a tracked tool
+    uint32_t new_tools;         // Stage 4: tool added to the registry
+    uint32_t repeat_hits;       // Stage 3: same payload as the tool's last advert
+    uint32_t scan_rsp;          // Scan responses among the adverts (active scanning only)
+    uint32_t ring_drops;        // Passed stage 2 but the consumer's ring was full
+    uint32_t batches;           // Consumer wake-ups that processed adverts
+    uint32_t batch_max;         // Most adverts processed in one wake-up
+    uint32_t timer_calls;       // esp_timer start/stop calls (power-off, scan, pre-start)
+} bt_filter_stats_t;
+
 /**
  * @brief Initialize Bluetooth manager
  * @param event_group Event group handle for communication with main app
@@ -32,9 +54,62 @@ esp_err_t bt_manager_init(EventGroupHandle_t event_group);
  */
 esp_err_t bt_aws_tool_on(void);
 
+/**
+ * @brief Let the scan policy follow the vacuum state machine
+ *
+ * Call after every state machine event. Leaving IDLE starts a short
+ * high-duty burst; ACTIVE keeps full-duty tracking; IDLE drops to low-duty
+ * passive scanning. Changing profile restarts the GAP discovery.
+ *
+ * @param state Current vacuum state
+ */
+void bt_scan_follow_state(vacuum_state_t state);
+
 /**
  * @brief Print current AWS tool status to log
  */
 void bt_aws_print_status(void);
 
+/**
+ * @brief Pair every tool that is currently running and save the allow-list
+ *
+ * Once at least one tool is paired, only paired tools drive the vacuum.
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if no new tool was running
+ */
+esp_err_t bt_pair_active_tools(void);
+
+/**
+ * @brief Clear the allow-list so any AWS tool drives the vacuum again
+ * @return ESP_OK on success
+ */
+esp_err_t bt_unpair_tools(void);
+
+/**
+ * @brief Get a copy of the advert filter pipeline counters
+ * @param stats Destination
+ */
+void bt_manager_get_filter_stats(bt_filter_stats_t *stats);
+
+/**
+ * @brief Tool levels behind the edge events posted to the state machine
+ *
+ * Lets the state machine resynchronise after an event was lost.
+ *
+ * @param detected A tool that may drive the vacuum is in range
+ * @param powered Such a tool is running (or the manual hold is on)
+ */
+void bt_get_tool_state(bool *detected, bool *powered);
+
+/**
+ * @brief Addresses of the running tools that drive the vacuum
+ *
+ * Changes in their number are posted as VACUUM_EVENT_TOOLS_CHANGED.
+ *
+ * @param addrs Destination, most recently seen first
+ * @param max Addresses that fit in addrs
+ * @return Number of such tools, which may exceed max
+ */
+uint8_t bt_get_driving_tools(uint8_t (*addrs)[6], uint8_t max);
+
 #endif // BT_MANAGER_H
\ No newline at end of file
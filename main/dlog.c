@@ -0,0 +1,250 @@
+#include "dlog.h"
+#include <stdio.h>
+#include <stdatomic.h>
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "power_mgmt.h"
+
+#ifdef ESP_PLATFORM
+#define DLOG_CORES portNUM_PROCESSORS
+#else
+#define DLOG_CORES 1
+#endif
+
+#define DLOG_TASK_STACK      2560
+
+static const char *const dlog_formats[DLOG_MSG_COUNT] = {
+#define DLOG_MSG(id, fmt) [id] = fmt,
+#include "dlog_msgs.h"
+#undef DLOG_MSG
+};
+
+const char *dlog_format(uint16_t id)
+{
+    return id < DLOG_MSG_COUNT ? dlog_formats[id] : NULL;
+}
+
+#ifdef CONFIG_DEFERRED_LOG_ENABLE
+
+// Bounded multi-producer ring (one per core, so producers only race with
+// tasks and ISRs on their own CPU) with a single consumer, the drain task.
+// A slot's seq holds the lap base (position & ~mask) of the position it is
+// free for, and base + 1 once the record in it is complete, so the
+// zero-initialised rings are ready before dlog_init(). The first record
+// after a drain wakes the drain task, which otherwise sleeps indefinitely.
+#define DLOG_RING_SIZE CONFIG_DEFERRED_LOG_RECORDS
+#define DLOG_RING_MASK (DLOG_RING_SIZE - 1)
+
+_Static_assert((DLOG_RING_SIZE & (DLOG_RING_SIZE - 1)) == 0,
+               "CONFIG_DEFERRED_LOG_RECORDS must be a power of two");
+
+typedef struct {
+    atomic_uint seq;
+    dlog_rec_t rec;
+} dlog_slot_t;
+
+typedef struct {
+    atomic_uint head;       // Next position to reserve
+    unsigned tail;          // Next position to drain (consumer only)
+    atomic_uint written;
+    atomic_uint dropped;
+    atomic_bool pending;    // Records written since the drain task last looked
+    dlog_slot_t slots[DLOG_RING_SIZE];
+} dlog_ring_t;
+
+static dlog_ring_t rings[DLOG_CORES];
+
+#ifdef ESP_PLATFORM
+static TaskHandle_t dlog_task_handle;
+
+// Only the record that finds the ring drained pays for the notification;
+// before dlog_init() the flag stays set and the task's first pass drains
+static void IRAM_ATTR wake_drain(dlog_ring_t *r)
+{
+    if (atomic_exchange_explicit(&r->pending, true, memory_order_acq_rel) || !dlog_task_handle) {
+        return;
+    }
+    if (xPortInIsrContext()) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(dlog_task_handle, &woken);
+        if (woken) {
+            portYIELD_FROM_ISR();
+        }
+    } else {
+        xTaskNotifyGive(dlog_task_handle);
+    }
+}
+#endif
+
+void IRAM_ATTR dlog_write(dlog_id_t id, unsigned nargs, const uint32_t *args)
+{
+#ifdef ESP_PLATFORM
+    unsigned core = xPortGetCoreID();
+#else
+    unsigned core = 0;
+#endif
+    dlog_ring_t *r = &rings[core];
+    unsigned pos = atomic_load_explicit(&r->head, memory_order_relaxed);
+    dlog_slot_t *slot;
+
+    for (;;) {
+        slot = &r->slots[pos & DLOG_RING_MASK];
+        unsigned base = pos & ~DLOG_RING_MASK;
+        int diff = (int)(atomic_load_explicit(&slot->seq, memory_order_acquire) - base);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&r->head, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Full: the drain task is behind, keep the older records
+            atomic_fetch_add_explicit(&r->dropped, 1, memory_order_relaxed);
+            return;
+        } else {
+            pos = atomic_load_explicit(&r->head, memory_order_relaxed);
+        }
+    }
+
+    if (nargs > DLOG_MAX_ARGS) {
+        nargs = DLOG_MAX_ARGS;
+    }
+    slot->rec.timestamp_us = (uint32_t)esp_timer_get_time();
+    slot->rec.id = (uint16_t)id;
+    slot->rec.core = (uint8_t)core;
+    slot->rec.nargs = (uint8_t)nargs;
+    for (unsigned i = 0; i < nargs; i++) {
+        slot->rec.args[i] = args[i];
+    }
+    atomic_store_explicit(&slot->seq, (pos & ~DLOG_RING_MASK) + 1, memory_order_release);
+    atomic_fetch_add_explicit(&r->written, 1, memory_order_relaxed);
+#ifdef ESP_PLATFORM
+    wake_drain(r);
+#endif
+}
+
+size_t dlog_drain(void (*sink)(const dlog_rec_t *rec, void *ctx), void *ctx)
+{
+    size_t n = 0;
+
+    for (int c = 0; c < DLOG_CORES; c++) {
+        dlog_ring_t *r = &rings[c];
+        for (;;) {
+            dlog_slot_t *slot = &r->slots[r->tail & DLOG_RING_MASK];
+            unsigned base = r->tail & ~DLOG_RING_MASK;
+            if (atomic_load_explicit(&slot->seq, memory_order_acquire) != base + 1) {
+                break;      // Empty, or the record is still being written
+            }
+            dlog_rec_t rec = slot->rec;
+            atomic_store_explicit(&slot->seq, base + DLOG_RING_SIZE, memory_order_release);
+            r->tail++;
+            sink(&rec, ctx);
+            n++;
+        }
+    }
+    return n;
+}
+
+void dlog_get_stats(uint32_t *written, uint32_t *dropped)
+{
+    *written = 0;
+    *dropped = 0;
+    for (int c = 0; c < DLOG_CORES; c++) {
+        *written += atomic_load(&rings[c].written);
+        *dropped += atomic_load(&rings[c].dropped);
+    }
+}
+
+#ifdef ESP_PLATFORM
+
+#include "static_alloc.h"
+#include "metrics.h"
+
+STATIC_TASK_STORAGE(dlog, DLOG_TASK_STACK)
+
+static void print_record(const dlog_rec_t *rec, void *ctx)
+{
+#ifdef CONFIG_DEFERRED_LOG_TEXT
+    const char *fmt = dlog_format(rec->id);
+    printf("D (%lu) dlog: ", (unsigned long)(rec->timestamp_us / 1000));
+    if (fmt) {
+        printf(fmt, (unsigned)rec->args[0], (unsigned)rec->args[1],
+               (unsigned)rec->args[2], (unsigned)rec->args[3]);
+    } else {
+        printf("unknown message %u", rec->id);
+    }
+    printf("\n");
+#else
+    uint8_t buf[DLOG_MAX_REC_LEN];
+    size_t len = dlog_encode(rec, buf);
+    printf(DLOG_LINE_PREFIX);
+    for (size_t i = 0; i < len; i++) {
+        printf("%02x", buf[i]);
+    }
+    printf("\n");
+#endif
+}
+
+// Runs only when a record arrives; at this priority a burst is drained
+// once the producers are done rather than record by record
+static void dlog_task(void *arg)
+{
+    // Set here rather than by the create call, so it is in place before
+    // the first pass clears the flags
+    dlog_task_handle = xTaskGetCurrentTaskHandle();
+    while (1) {
+        pm_note_wake(PM_WAKE_DLOG);
+        // Clear before draining, so a record that lands behind the drain
+        // notifies again
+        for (int c = 0; c < DLOG_CORES; c++) {
+            atomic_store_explicit(&rings[c].pending, false, memory_order_release);
+        }
+        dlog_drain(print_record, NULL);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+esp_err_t dlog_init(void)
+{
+    if (STATIC_TASK_CREATE(dlog, dlog_task, "dlog", DLOG_TASK_STACK, NULL, tskIDLE_PRIORITY + 1,
+                           NULL, tskNO_AFFINITY) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    metrics_note_task("dlog", DLOG_TASK_STACK);
+    return ESP_OK;
+}
+
+#else
+
+esp_err_t dlog_init(void)
+{
+    return ESP_OK;
+}
+
+#endif // ESP_PLATFORM
+
+#else
+
+void dlog_write(dlog_id_t id, unsigned nargs, const uint32_t *args)
+{
+}
+
+size_t dlog_drain(void (*sink)(const dlog_rec_t *rec, void *ctx), void *ctx)
+{
+    return 0;
+}
+
+void dlog_get_stats(uint32_t *written, uint32_t *dropped)
+{
+    *written = 0;
+    *dropped = 0;
+}
+
+esp_err_t dlog_init(void)
+{
+    return ESP_OK;
+}
+
+#endif // CONFIG_DEFERRED_LOG_ENABLE
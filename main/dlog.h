@@ -0,0 +1,156 @@
+#ifndef DLOG_H
+#define DLOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Deferred binary logging for hot paths (NimBLE host task, timer callbacks,
+// ISRs). A call site stores a message ID, a timestamp and up to four raw
+// 32-bit arguments in a lock-free per-core ring; nothing is formatted. A
+// low-priority task drains the rings and prints each record either as text
+// or, by default, as one "DLOG <hex>" line that host/dlog_decode turns back
+// into text using the same message table (dlog_msgs.h).
+//
+// Wire format of a record, little-endian:
+//
+//   u32 timestamp_us   low 32 bits of esp_timer_get_time()
+//   u16 id             dlog_id_t
+//   u8  core           CPU that logged it
+//   u8  nargs          0..4
+//   u32 args[nargs]
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#else
+// Host builds always compile the rings so the tools can measure them
+#define CONFIG_DEFERRED_LOG_ENABLE 1
+#endif
+
+#ifndef CONFIG_DEFERRED_LOG_RECORDS
+#define CONFIG_DEFERRED_LOG_RECORDS 128
+#endif
+
+#define DLOG_MAX_ARGS       4
+#define DLOG_HDR_LEN        8
+#define DLOG_MAX_REC_LEN    (DLOG_HDR_LEN + 4 * DLOG_MAX_ARGS)
+#define DLOG_LINE_PREFIX    "DLOG "
+
+typedef enum {
+#define DLOG_MSG(id, fmt) id,
+#include "dlog_msgs.h"
+#undef DLOG_MSG
+    DLOG_MSG_COUNT
+} dlog_id_t;
+
+/**
+ * @brief One deferred log record
+ */
+typedef struct {
+    uint32_t timestamp_us;
+    uint16_t id;
+    uint8_t core;
+    uint8_t nargs;
+    uint32_t args[DLOG_MAX_ARGS];
+} dlog_rec_t;
+
+#ifdef CONFIG_DEFERRED_LOG_ENABLE
+/**
+ * @brief Log a message from the table without formatting it
+ *
+ * Usage: DLOG(DLOG_INPUT_EVENT, input, event). Safe from tasks and ISRs;
+ * never blocks. Compiles to nothing when CONFIG_DEFERRED_LOG_ENABLE is off.
+ */
+#define DLOG(id, ...) \
+    dlog_write((id), sizeof((uint32_t[]){0, ##__VA_ARGS__}) / sizeof(uint32_t) - 1, \
+               (const uint32_t[]){0, ##__VA_ARGS__} + 1)
+#else
+#define DLOG(id, ...) do { } while (0)
+#endif
+
+/**
+ * @brief Append a record to the current core's ring; drops it when full
+ * @param id Message ID
+ * @param nargs Number of arguments (extra ones are ignored)
+ * @param args Arguments
+ */
+void dlog_write(dlog_id_t id, unsigned nargs, const uint32_t *args);
+
+/**
+ * @brief Remove every complete record from the rings, oldest first per core
+ * @param sink Called for each record
+ * @param ctx Passed to sink
+ * @return Number of records drained
+ */
+size_t dlog_drain(void (*sink)(const dlog_rec_t *rec, void *ctx), void *ctx);
+
+/**
+ * @brief Records written and dropped (ring full) so far, over all cores
+ */
+void dlog_get_stats(uint32_t *written, uint32_t *dropped);
+
+/**
+ * @brief Format string of a message
+ * @return Format, or NULL for an unknown ID
+ */
+const char *dlog_format(uint16_t id);
+
+/**
+ * @brief Start the drain task (firmware only)
+ * @return ESP_OK on success
+ */
+esp_err_t dlog_init(void);
+
+/**
+ * @brief Serialize a record into the wire format
+ * @param rec Record
+ * @param buf Destination, at least DLOG_MAX_REC_LEN bytes
+ * @return Number of bytes written
+ */
+static inline size_t dlog_encode(const dlog_rec_t *rec, uint8_t *buf)
+{
+    uint8_t nargs = rec->nargs > DLOG_MAX_ARGS ? DLOG_MAX_ARGS : rec->nargs;
+    buf[0] = (uint8_t)rec->timestamp_us;
+    buf[1] = (uint8_t)(rec->timestamp_us >> 8);
+    buf[2] = (uint8_t)(rec->timestamp_us >> 16);
+    buf[3] = (uint8_t)(rec->timestamp_us >> 24);
+    buf[4] = (uint8_t)rec->id;
+    buf[5] = (uint8_t)(rec->id >> 8);
+    buf[6] = rec->core;
+    buf[7] = nargs;
+    for (int i = 0; i < nargs; i++) {
+        for (int b = 0; b < 4; b++) {
+            buf[DLOG_HDR_LEN + 4 * i + b] = (uint8_t)(rec->args[i] >> (8 * b));
+        }
+    }
+    return DLOG_HDR_LEN + 4 * nargs;
+}
+
+/**
+ * @brief Parse one record from the wire format
+ * @param buf Source bytes
+ * @param avail Number of bytes available in buf
+ * @param rec Destination record
+ * @return Number of bytes consumed, 0 if buf holds no complete record
+ */
+static inline size_t dlog_decode(const uint8_t *buf, size_t avail, dlog_rec_t *rec)
+{
+    if (avail < DLOG_HDR_LEN || buf[7] > DLOG_MAX_ARGS ||
+        avail < (size_t)DLOG_HDR_LEN + 4 * buf[7]) {
+        return 0;
+    }
+    rec->timestamp_us = (uint32_t)buf[0] | (uint32_t)buf[1] << 8 |
+                        (uint32_t)buf[2] << 16 | (uint32_t)buf[3] << 24;
+    rec->id = (uint16_t)(buf[4] | buf[5] << 8);
+    rec->core = buf[6];
+    rec->nargs = buf[7];
+    for (int i = 0; i < rec->nargs; i++) {
+        const uint8_t *p = &buf[DLOG_HDR_LEN + 4 * i];
+        rec->args[i] = (uint32_t)p[0] | (uint32_t)p[1] << 8 |
+                       (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+    }
+    return DLOG_HDR_LEN + 4 * rec->nargs;
+}
+
+#endif // DLOG_H
@@ -0,0 +1,16 @@
+// Deferred log message table, shared by the firmware and host/dlog_decode.
+//
+// DLOG_MSG(id, format): formats take at most four integer arguments
+// (%u, %d, %x with width flags); every argument is recorded as 32 bits.
+// Append new messages at the end so record IDs in old dumps stay valid.
+
+DLOG_MSG(DLOG_AWS_ADVERT,       "AWS tool %06x%06x, RSSI: %d dBm, data: %08x")
+DLOG_MSG(DLOG_LED_PATTERN,      "Setting LED %u pattern to: %u")
+// Retired with the edge-driven button debouncer, kept for old dumps
+DLOG_MSG(DLOG_BUTTON_CONFIRMED, "Button press confirmed")
+DLOG_MSG(DLOG_BUTTON_SPIKE,     "Button press rejected (spike)")
+DLOG_MSG(DLOG_BUTTON_VALID,     "Valid button press detected (duration: %u ms)")
+DLOG_MSG(DLOG_BUTTON_SHORT,     "Button press too short (duration: %u ms)")
+DLOG_MSG(DLOG_BUTTON_REPRESS,   "Button pressed again during release debounce")
+DLOG_MSG(DLOG_INPUT_EVENT,      "Input %u event %u")
+DLOG_MSG(DLOG_INPUT_STORM,      "Input storm: %u edges, interrupts masked for %u ms")
@@ -0,0 +1,263 @@
+#include "input.h"
+#include <string.h>
+#include "esp_attr.h"
+#include "dlog.h"
+
+void input_init(input_t *in, const input_cfg_t *cfg, uint8_t count, input_cb_t cb, void *ctx)
+{
+    memset(in, 0, sizeof(*in));
+    in->cfg = cfg;
+    in->count = count > INPUT_MAX ? INPUT_MAX : count;
+    in->cb = cb;
+    in->ctx = ctx;
+}
+
+static void emit(input_t *in, uint8_t i, input_event_t event, uint32_t now_ms)
+{
+    DLOG(DLOG_INPUT_EVENT, i, event);
+    in->cb(i, event, now_ms, in->ctx);
+}
+
+// Debounced edges and timeouts drive the gesture detector
+static void gesture_step(input_t *in, uint8_t i, bool changed, uint32_t now_ms)
+{
+    const input_cfg_t *cfg = &in->cfg[i];
+    input_state_t *s = &in->in[i];
+
+    if (changed && s->active) {
+        s->press_ms = now_ms;
+        s->long_sent = false;
+    } else if (changed) {
+        if (!s->long_sent) {
+            emit(in, i, INPUT_EVENT_SHORT, now_ms);
+        }
+    } else if (s->active) {
+        if (cfg->long_ms && !s->long_sent && now_ms - s->press_ms >= cfg->long_ms) {
+            s->long_sent = true;
+            emit(in, i, INPUT_EVENT_LONG, now_ms);
+        }
+    }
+}
+
+// Whether an input still needs sampling: bouncing or waiting for a long press
+static bool input_busy(const input_t *in, uint8_t i)
+{
+    const input_state_t *s = &in->in[i];
+    if (s->integrator != (s->active ? INPUT_INTEGRATOR_MAX : 0)) {
+        return true;
+    }
+    return s->active && in->cfg[i].long_ms && !s->long_sent;
+}
+
+bool input_sample(input_t *in, uint32_t active_mask, uint32_t now_ms)
+{
+    bool busy = false;
+
+    in->samples++;
+    if (in->quiet_samples < INPUT_INTEGRATOR_MAX) {
+        in->quiet_samples++;
+    }
+    for (uint8_t i = 0; i < in->count; i++) {
+        input_state_t *s = &in->in[i];
+        bool raw = (active_mask >> i) & 1;
+
+        if (raw != s->raw) {
+            s->raw = raw;
+            in->edges++;
+            in->burst_edges++;
+            in->quiet_samples = 0;
+        }
+
+        // Integrate towards the sampled level; only the rails change state
+        if (raw && s->integrator < INPUT_INTEGRATOR_MAX) {
+            s->integrator++;
+        } else if (!raw && s->integrator > 0) {
+            s->integrator--;
+        }
+
+        bool changed = false;
+        if (!s->active && s->integrator == INPUT_INTEGRATOR_MAX) {
+            s->active = true;
+            changed = true;
+        } else if (s->active && s->integrator == 0) {
+            s->active = false;
+            changed = true;
+        }
+        if (changed) {
+            in->changes++;
+            emit(in, i, s->active ? INPUT_EVENT_PRESS : INPUT_EVENT_RELEASE, now_ms);
+        }
+
+        gesture_step(in, i, changed, now_ms);
+        busy |= input_busy(in, i);
+    }
+
+    if (in->holdoff_until_ms) {
+        if ((int32_t)(now_ms - in->holdoff_until_ms) < 0) {
+            return true;
+        }
+        in->holdoff_until_ms = 0;
+    }
+    // Noise that never reaches a rail still keeps the burst going
+    if (busy || in->quiet_samples < INPUT_INTEGRATOR_MAX) {
+        return true;
+    }
+
+    // Burst over. A storm keeps interrupts masked for a while longer and the
+    // lines are polled instead.
+    if (in->burst_edges >= INPUT_STORM_EDGES) {
+        in->storms++;
+        DLOG(DLOG_INPUT_STORM, in->burst_edges, INPUT_STORM_HOLDOFF_MS);
+        in->holdoff_until_ms = (now_ms + INPUT_STORM_HOLDOFF_MS) | 1;
+        in->burst_edges = 0;
+        return true;
+    }
+    in->burst_edges = 0;
+    return false;
+}
+
+#ifdef ESP_PLATFORM
+
+#include "driver/gpio.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "power_mgmt.h"
+#include "reactor.h"
+
+static const char *TAG = "INPUT";
+
+#if defined(CONFIG_VACUUM_PM_ENABLE) && defined(CONFIG_FREERTOS_USE_TICKLESS_IDLE)
+// Edge interrupts cannot wake the chip from light sleep; the level
+// interrupts used here can once they are wakeup enabled
+#define INPUT_LEVEL_WAKE
+#endif
+
+static void sample_timer_cb(reactor_timer_t *timer, int64_t now_us);
+static void sample_start(void *ctx, uint32_t arg, int64_t timestamp_us);
+
+static input_t *hw_inputs = NULL;
+static reactor_timer_t sample_timer = REACTOR_TIMER_INIT(sample_timer_cb, NULL, 0);
+static reactor_latch_t sample_latch = REACTOR_LATCH_INIT(sample_start, NULL);
+
+static uint32_t read_active_mask(void)
+{
+    uint32_t mask = 0;
+    for (uint8_t i = 0; i < hw_inputs->count; i++) {
+        const input_cfg_t *cfg = &hw_inputs->cfg[i];
+        if (gpio_get_level(cfg->gpio) != cfg->active_low) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+}
+
+// Interrupt as soon as each line leaves its debounced level
+static void arm_interrupts(void)
+{
+    for (uint8_t i = 0; i < hw_inputs->count; i++) {
+        const input_cfg_t *cfg = &hw_inputs->cfg[i];
+        int level = hw_inputs->in[i].active != cfg->active_low;
+        gpio_int_type_t type = level ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL;
+#ifdef INPUT_LEVEL_WAKE
+        gpio_wakeup_enable(cfg->gpio, type);
+#else
+        gpio_set_intr_type(cfg->gpio, type);
+#endif
+        gpio_intr_enable(cfg->gpio);
+    }
+}
+
+// Sampling runs on the reactor. Each sample is scheduled from the last
+// deadline so the period does not stretch with reactor load, but never in
+// the past: samples taken back to back would defeat the integrator.
+static void sample_timer_cb(reactor_timer_t *timer, int64_t now_us)
+{
+    pm_note_wake(PM_WAKE_INPUT);
+    if (input_sample(hw_inputs, read_active_mask(), (uint32_t)(now_us / 1000))) {
+        int64_t next = timer->deadline_us + INPUT_SAMPLE_MS * 1000;
+        reactor_arm(timer, next > now_us ? next : now_us + INPUT_SAMPLE_MS * 1000);
+    } else {
+        arm_interrupts();
+    }
+}
+
+static void sample_start(void *ctx, uint32_t arg, int64_t timestamp_us)
+{
+    if (!reactor_timer_armed(&sample_timer)) {
+        reactor_arm(&sample_timer, timestamp_us + INPUT_SAMPLE_MS * 1000);
+    }
+}
+
+// At most one interrupt per input per burst: the line is masked until
+// sampling settles. Only sampling unmasks it again, so the request goes
+// through a latch, which a full reactor queue cannot lose.
+static void IRAM_ATTR input_isr(void *arg)
+{
+    gpio_intr_disable((gpio_num_t)(uintptr_t)arg);
+    hw_inputs->isr_count++;
+    pm_note_wake(PM_WAKE_INPUT);
+    reactor_latch_from_isr(&sample_latch, 1);
+}
+
+esp_err_t input_start(input_t *in)
+{
+    hw_inputs = in;
+    if (!reactor_register_latch(&sample_latch)) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "Failed to install GPIO ISR service: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    for (uint8_t i = 0; i < in->count; i++) {
+        const input_cfg_t *cfg = &in->cfg[i];
+        gpio_config_t io_conf = {
+            .pin_bit_mask = (1ULL << cfg->gpio),
+            .mode = GPIO_MODE_INPUT,
+            .pull_up_en = cfg->active_low ? GPIO_PULLUP_ENABLE : GPIO_PULLUP_DISABLE,
+            .pull_down_en = cfg->active_low ? GPIO_PULLDOWN_DISABLE : GPIO_PULLDOWN_ENABLE,
+            .intr_type = GPIO_INTR_DISABLE,
+        };
+        ret = gpio_config(&io_conf);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Input GPIO %d config failed: %s", cfg->gpio, esp_err_to_name(ret));
+            return ret;
+        }
+        gpio_isr_handler_add(cfg->gpio, input_isr, (void *)(uintptr_t)cfg->gpio);
+        ESP_LOGI(TAG, "Input %u on GPIO %d (long %u ms)", i, cfg->gpio, cfg->long_ms);
+    }
+
+    // Start from the current levels without reporting them as presses
+    uint32_t mask = read_active_mask();
+    for (uint8_t i = 0; i < in->count; i++) {
+        bool active = (mask >> i) & 1;
+        in->in[i].raw = active;
+        in->in[i].active = active;
+        in->in[i].integrator = active ? INPUT_INTEGRATOR_MAX : 0;
+        in->in[i].press_ms = now_ms;
+        in->in[i].long_sent = true;     // A line held at boot is not a long press
+    }
+
+#ifdef INPUT_LEVEL_WAKE
+    esp_sleep_enable_gpio_wakeup();
+#endif
+    arm_interrupts();
+
+    ESP_LOGI(TAG, "Input sampling: %d ms period, %d samples to settle",
+             INPUT_SAMPLE_MS, INPUT_INTEGRATOR_MAX);
+    return ESP_OK;
+}
+
+#else
+
+esp_err_t input_start(input_t *in)
+{
+    return ESP_OK;
+}
+
+#endif // ESP_PLATFORM
@@ -0,0 +1,99 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#define INPUT_MAX               8       // Inputs per subsystem
+#define INPUT_SAMPLE_MS         5       // Sampling period while any input is busy
+#define INPUT_INTEGRATOR_MAX    4       // Consistent samples to change state (20 ms)
+#define INPUT_STORM_EDGES       32      // Raw edges in one burst that count as a storm
+#define INPUT_STORM_HOLDOFF_MS  500     // Interrupts stay masked this long after a storm
+
+/**
+ * @brief Debounced input events
+ */
+typedef enum {
+    INPUT_EVENT_PRESS,      // Became active
+    INPUT_EVENT_RELEASE,    // Became inactive
+    INPUT_EVENT_SHORT,      // Released before long_ms
+    INPUT_EVENT_LONG,       // Held for long_ms
+} input_event_t;
+
+/**
+ * @brief One button or digital input
+ */
+typedef struct {
+    int gpio;
+    bool active_low;
+    uint16_t long_ms;       // Long press threshold, 0 = no long press
+} input_cfg_t;
+
+typedef struct {
+    uint8_t integrator;     // 0 = settled inactive, INPUT_INTEGRATOR_MAX = settled active
+    bool raw;               // Last sample
+    bool active;            // Debounced state
+    bool long_sent;
+    uint32_t press_ms;
+} input_state_t;
+
+typedef void (*input_cb_t)(uint8_t input, input_event_t event, uint32_t now_ms, void *ctx);
+
+/**
+ * @brief Sampling integrator with gesture detection for a set of inputs
+ *
+ * Interrupts only start a burst of periodic sampling: each input's interrupt
+ * is masked from its first edge until the burst ends, so ISR and timer load
+ * stay bounded however noisy the lines are. A debounced change needs
+ * INPUT_INTEGRATOR_MAX more agreeing samples than disagreeing ones; a burst
+ * ends once every input is settled and no line changed for that many
+ * samples. Not thread safe: interrupts only touch isr_count.
+ */
+typedef struct {
+    const input_cfg_t *cfg;
+    uint8_t count;
+    input_state_t in[INPUT_MAX];
+    input_cb_t cb;
+    void *ctx;
+    uint32_t burst_edges;       // Raw edges in the current burst
+    uint8_t quiet_samples;      // Samples since the last raw edge (saturating)
+    uint32_t holdoff_until_ms;  // Storm hold-off, 0 if none
+    // Statistics
+    volatile uint32_t isr_count;
+    uint32_t samples;
+    uint32_t edges;             // Raw edges seen while sampling
+    uint32_t changes;           // Debounced changes (edges - changes were rejected)
+    uint32_t storms;
+} input_t;
+
+/**
+ * @brief Reset the subsystem
+ * @param in Subsystem
+ * @param cfg Inputs (kept by reference)
+ * @param count Number of inputs, at most INPUT_MAX
+ * @param cb Event callback
+ * @param ctx Passed to cb
+ */
+void input_init(input_t *in, const input_cfg_t *cfg, uint8_t count, input_cb_t cb, void *ctx);
+
+/**
+ * @brief Feed one sample of every input
+ * @param in Subsystem
+ * @param active_mask Bit i set if input i reads active
+ * @param now_ms Sample time
+ * @return true while sampling must continue, false when every input is idle
+ */
+bool input_sample(input_t *in, uint32_t active_mask, uint32_t now_ms);
+
+/**
+ * @brief Configure the GPIOs, interrupts and sampling timer (ESP only)
+ *
+ * Call after reactor_create() and before reactor_start().
+ *
+ * @param in Initialised subsystem
+ * @return ESP_OK on success
+ */
+esp_err_t input_start(input_t *in);
+
+#endif // INPUT_H
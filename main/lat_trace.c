@@ -0,0 +1,100 @@
+#include "lat_trace.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "LAT_TRACE";
+
+static lat_hist_t stage_hist[LAT_STAGE_COUNT];
+
+static const char *const stage_names[LAT_STAGE_COUNT] = {
+    [LAT_STAGE_DEQUEUE] = "dequeue",
+    [LAT_STAGE_PARSE] = "parse",
+    [LAT_STAGE_POST] = "post",
+    [LAT_STAGE_PICKUP] = "pickup",
+    [LAT_STAGE_RELAY] = "relay",
+};
+
+static unsigned bucket_index(uint32_t us)
+{
+    if (us >= LAT_HIST_MAX_US) {
+        return LAT_HIST_BUCKETS - 1;
+    }
+    if (us < (1u << LAT_HIST_SUB_BITS)) {
+        return us;
+    }
+    unsigned msb = 31 - __builtin_clz(us);
+    unsigned sub = (us >> (msb - LAT_HIST_SUB_BITS)) & ((1u << LAT_HIST_SUB_BITS) - 1);
+    return ((msb - LAT_HIST_SUB_BITS + 1) << LAT_HIST_SUB_BITS) + sub;
+}
+
+static uint32_t bucket_midpoint(unsigned idx)
+{
+    if (idx < (1u << LAT_HIST_SUB_BITS)) {
+        return idx;
+    }
+    unsigned msb = (idx >> LAT_HIST_SUB_BITS) + LAT_HIST_SUB_BITS - 1;
+    unsigned sub = idx & ((1u << LAT_HIST_SUB_BITS) - 1);
+    uint32_t width = 1u << (msb - LAT_HIST_SUB_BITS);
+    uint32_t low = (1u << msb) + sub * width;
+    return low + width / 2;
+}
+
+void lat_hist_record(lat_hist_t *h, uint32_t us)
+{
+    h->buckets[bucket_index(us)]++;
+    h->count++;
+    if (us > h->max_us) {
+        h->max_us = us;
+    }
+}
+
+uint32_t lat_hist_percentile(const lat_hist_t *h, unsigned pct)
+{
+    if (h->count == 0) {
+        return 0;
+    }
+
+    // Rank of the requested sample, rounded up
+    uint64_t rank = ((uint64_t)h->count * pct + 99) / 100;
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < LAT_HIST_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            uint32_t mid = bucket_midpoint(i);
+            return mid < h->max_us ? mid : h->max_us;
+        }
+    }
+    return h->max_us;
+}
+
+void lat_trace_record(lat_stage_t stage, int64_t trigger_us)
+{
+    int64_t delta = esp_timer_get_time() - trigger_us;
+    lat_hist_record(&stage_hist[stage], delta < 0 ? 0 : (delta > UINT32_MAX ? UINT32_MAX : (uint32_t)delta));
+}
+
+const lat_hist_t *lat_trace_hist(lat_stage_t stage)
+{
+    return &stage_hist[stage];
+}
+
+const char *lat_trace_stage_name(lat_stage_t stage)
+{
+    return stage < LAT_STAGE_COUNT ? stage_names[stage] : "?";
+}
+
+void lat_trace_report(void)
+{
+    for (int i = 0; i < LAT_STAGE_COUNT; i++) {
+        const lat_hist_t *h = &stage_hist[i];
+        ESP_LOGI(TAG, "⏱️  %-6s n=%lu p50=%lu us p99=%lu us max=%lu us",
+                 stage_names[i], (unsigned long)h->count,
+                 (unsigned long)lat_hist_percentile(h, 50),
+                 (unsigned long)lat_hist_percentile(h, 99),
+                 (unsigned long)h->max_us);
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef LAT_TRACE_H
+#define LAT_TRACE_H
+
+#include <stdint.h>
+
+// Hot-path latency trace points. Every stage is measured from the trigger
+// timestamp (BLE_GAP_EVENT_DISC arrival, power-off timer or button), so the
+// stages are cumulative along the advert-to-relay path.
+typedef enum {
+    LAT_STAGE_DEQUEUE,  // Advert taken from the ring by the consumer task
+    LAT_STAGE_PARSE,    // Parse done in process_aws_advertisement()
+    LAT_STAGE_POST,     // Event posted to the state machine
+    LAT_STAGE_PICKUP,   // Event picked up by the reactor
+    LAT_STAGE_RELAY,    // Relay GPIO written
+    LAT_STAGE_COUNT
+} lat_stage_t;
+
+// Log-linear buckets: 4 sub-buckets per power of two (<= 25% error), values
+// above LAT_HIST_MAX_US land in the last bucket
+#define LAT_HIST_SUB_BITS   2
+#define LAT_HIST_MAX_US     (1u << 24)
+#define LAT_HIST_BUCKETS    ((24 - LAT_HIST_SUB_BITS + 1) << LAT_HIST_SUB_BITS)
+
+/**
+ * @brief Fixed-memory log-bucketed histogram of microsecond values
+ */
+typedef struct {
+    uint32_t buckets[LAT_HIST_BUCKETS];
+    uint32_t count;
+    uint32_t max_us;
+} lat_hist_t;
+
+/**
+ * @brief Add one value to a histogram
+ * @param h Histogram
+ * @param us Value in microseconds
+ */
+void lat_hist_record(lat_hist_t *h, uint32_t us);
+
+/**
+ * @brief Approximate percentile of a histogram
+ * @param h Histogram
+ * @param pct Percentile, 0-100
+ * @return Midpoint of the bucket holding the percentile, 0 if empty
+ */
+uint32_t lat_hist_percentile(const lat_hist_t *h, unsigned pct);
+
+/**
+ * @brief Record a trace point: now minus the trigger timestamp
+ *
+ * Each stage has one writer task, so no locking is done.
+ *
+ * @param stage Stage reached
+ * @param trigger_us esp_timer_get_time() at the trigger
+ */
+void lat_trace_record(lat_stage_t stage, int64_t trigger_us);
+
+/**
+ * @brief Get the histogram of a stage
+ * @param stage Stage
+ * @return Histogram
+ */
+const lat_hist_t *lat_trace_hist(lat_stage_t stage);
+
+/**
+ * @brief Name of a stage
+ * @param stage Stage
+ * @return Constant string
+ */
+const char *lat_trace_stage_name(lat_stage_t stage);
+
+/**
+ * @brief Log count, p50, p99 and max of every stage
+ */
+void lat_trace_report(void);
+
+#endif // LAT_TRACE_H
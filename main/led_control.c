@@ -1,131 +1,211 @@
 #include "led_control.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
-#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "soc/soc_caps.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
 #include "esp_log.h"
+#include "dlog.h"
+#include "power_mgmt.h"
+#include "reactor.h"
+#include <stdatomic.h>
 #include <stdbool.h>
 
 static const char *TAG = "LED_CONTROL";
 
-static gpio_num_t led_gpio = 23;  // Default LED GPIO
-static led_pattern_t current_pattern = LED_PATTERN_OFF;
-static bool led_state = false;
-static TaskHandle_t led_task_handle = NULL;
-static bool led_task_running = false;
+// Low-speed LEDC timers clocked from RC_FAST keep running in light sleep, so
+// a steady pattern costs no CPU wakeups at all
+#define LED_SPEED_MODE          LEDC_LOW_SPEED_MODE
+#define LED_CLK_HZ              8000000
+#define LED_MAX_RES_BITS        SOC_LEDC_TIMER_BIT_WIDTH
 
-// LED control task
-static void led_task(void *pvParameters)
+typedef struct {
+    int gpio;                       // -1 if not fitted
+    ledc_channel_t ledc_channel;
+    ledc_timer_t ledc_timer;
+    _Atomic uint32_t request;       // Latest requested pattern
+    _Atomic uint32_t steady;        // Pattern to return to after a one-shot
+    // Owned by the reactor task
+    led_pattern_t applied;
+    uint32_t peak_duty;             // BREATHE fade target
+    bool fading_up;
+    reactor_timer_t oneshot_end;    // Armed while a one-shot is playing
+} led_chan_t;
+
+static void led_oneshot_end(reactor_timer_t *timer, int64_t now_us);
+
+static led_chan_t channels[LED_CHANNEL_COUNT] = {
+    [LED_CHANNEL_STATUS] = { .gpio = -1, .ledc_channel = LEDC_CHANNEL_0, .ledc_timer = LEDC_TIMER_0,
+                             .oneshot_end = REACTOR_TIMER_INIT(led_oneshot_end, &channels[LED_CHANNEL_STATUS], 0) },
+    [LED_CHANNEL_AUX] = { .gpio = -1, .ledc_channel = LEDC_CHANNEL_1, .ledc_timer = LEDC_TIMER_1,
+                          .oneshot_end = REACTOR_TIMER_INIT(led_oneshot_end, &channels[LED_CHANNEL_AUX], 0) },
+};
+
+// One half of a breathe: the hardware ramps the duty, the CPU only turns it round
+static void led_fade(led_chan_t *ch)
 {
-    led_pattern_t pattern;
-    TickType_t delay;
-    bool blink_state = false;
-    int pulse_direction = 1;
-    int pulse_intensity = 0;
-    
-    while (led_task_running) {
-        pattern = current_pattern;
-        
-        switch (pattern) {
-            case LED_PATTERN_OFF:
-                gpio_set_level(led_gpio, 0);
-                led_state = false;
-                delay = pdMS_TO_TICKS(1000); // Check every second
-                break;
-                
-            case LED_PATTERN_ON:
-                gpio_set_level(led_gpio, 1);
-                led_state = true;
-                delay = pdMS_TO_TICKS(1000); // Check every second
-                break;
-                
-            case LED_PATTERN_SLOW_BLINK:
-                blink_state = !blink_state;
-                gpio_set_level(led_gpio, blink_state ? 1 : 0);
-                led_state = blink_state;
-                delay = pdMS_TO_TICKS(1000); // 1 second on, 1 second off
-                break;
-                
-            case LED_PATTERN_FAST_BLINK:
-                blink_state = !blink_state;
-                gpio_set_level(led_gpio, blink_state ? 1 : 0);
-                led_state = blink_state;
-                delay = pdMS_TO_TICKS(250); // 250ms on, 250ms off
-                break;
-                
-            case LED_PATTERN_PULSE:
-                // Simple pulse simulation with on/off
-                pulse_intensity += pulse_direction * 10;
-                if (pulse_intensity >= 100) {
-                    pulse_intensity = 100;
-                    pulse_direction = -1;
-                } else if (pulse_intensity <= 0) {
-                    pulse_intensity = 0;
-                    pulse_direction = 1;
-                }
-                
-                // Simple approximation: LED on if intensity > 50%
-                bool pulse_on = pulse_intensity > 50;
-                gpio_set_level(led_gpio, pulse_on ? 1 : 0);
-                led_state = pulse_on;
-                delay = pdMS_TO_TICKS(50); // Update every 50ms for smooth pulse
-                break;
-                
-            default:
-                delay = pdMS_TO_TICKS(1000);
-                break;
-        }
-        
-        vTaskDelay(delay);
+    const led_pattern_desc_t *desc = led_pattern_desc(ch->applied);
+    ledc_set_fade_time_and_start(LED_SPEED_MODE, ch->ledc_channel, ch->fading_up ? ch->peak_duty : 0,
+                                 desc->period_ms / 2, LEDC_FADE_NO_WAIT);
+}
+
+static void led_apply(led_chan_t *ch, led_pattern_t pattern)
+{
+    const led_pattern_desc_t *desc = led_pattern_desc(pattern);
+    led_timer_setting_t setting;
+
+    if (!led_pattern_timer(desc, LED_CLK_HZ, LED_MAX_RES_BITS, &setting)) {
+        ESP_LOGE(TAG, "LED pattern %d cannot be played from the LEDC clock", pattern);
+        return;
+    }
+
+    ledc_timer_set(LED_SPEED_MODE, ch->ledc_timer, setting.divider_q8, setting.res_bits, LEDC_SCLK);
+    // Restart the period so a blink begins with its lit part
+    ledc_timer_rst(LED_SPEED_MODE, ch->ledc_timer);
+
+    ch->applied = pattern;
+    ch->peak_duty = setting.duty;
+    if (desc->count) {
+        reactor_arm(&ch->oneshot_end, esp_timer_get_time() + (int64_t)desc->count * desc->period_ms * 1000);
+    } else {
+        reactor_cancel(&ch->oneshot_end);
+    }
+
+    if (desc->shape == LED_SHAPE_BREATHE) {
+        ch->fading_up = true;
+        led_fade(ch);
+    } else {
+        ledc_set_duty_and_update(LED_SPEED_MODE, ch->ledc_channel, setting.duty, 0);
+    }
+}
+
+// The LED work runs on the reactor: a pattern request, a breathe fade turning
+// round or a one-shot ending are the only things that wake the CPU for it
+
+static void led_request(void *ctx, uint32_t arg, int64_t timestamp_us)
+{
+    led_chan_t *ch = ctx;
+    pm_note_wake(PM_WAKE_LED);
+    led_pattern_t want = (led_pattern_t)atomic_load(&ch->request);
+    if (want != ch->applied || led_pattern_is_oneshot(want)) {
+        led_apply(ch, want);
+    }
+}
+
+static void led_fade_turn(void *ctx, uint32_t arg, int64_t timestamp_us)
+{
+    led_chan_t *ch = ctx;
+    pm_note_wake(PM_WAKE_LED);
+    if (led_pattern_desc(ch->applied)->shape == LED_SHAPE_BREATHE) {
+        ch->fading_up = !ch->fading_up;
+        led_fade(ch);
+    }
+}
+
+static void led_oneshot_end(reactor_timer_t *timer, int64_t now_us)
+{
+    led_chan_t *ch = timer->ctx;
+    pm_note_wake(PM_WAKE_LED);
+    // Hand the LED back to the steady pattern unless a newer request is already pending
+    uint32_t oneshot = ch->applied;
+    uint32_t steady = atomic_load(&ch->steady);
+    if (atomic_compare_exchange_strong(&ch->request, &oneshot, steady)) {
+        led_apply(ch, (led_pattern_t)steady);
     }
-    
-    // Clean up
-    led_task_handle = NULL;
-    vTaskDelete(NULL);
 }
 
-esp_err_t led_init(void)
+static IRAM_ATTR bool led_fade_end_isr(const ledc_cb_param_t *param, void *user_arg)
 {
-    ESP_LOGI(TAG, "Initializing LED control on GPIO %d", led_gpio);
-    
-    // Configure GPIO
-    gpio_config_t io_conf = {
-        .intr_type = GPIO_INTR_DISABLE,
-        .mode = GPIO_MODE_OUTPUT,
-        .pin_bit_mask = (1ULL << led_gpio),
-        .pull_down_en = 0,
-        .pull_up_en = 0,
-    };
-    
-    esp_err_t ret = gpio_config(&io_conf);
+    if (param->event == LEDC_FADE_END_EVT) {
+        reactor_post_from_isr(led_fade_turn, user_arg, 0, 0);
+    }
+    // reactor_post_from_isr() has already yielded if it had to
+    return false;
+}
+
+esp_err_t led_init(int status_gpio, int aux_gpio)
+{
+    channels[LED_CHANNEL_STATUS].gpio = status_gpio;
+    channels[LED_CHANNEL_AUX].gpio = aux_gpio;
+
+    // Keep the LEDC clock source powered through light sleep
+    esp_sleep_pd_config(ESP_PD_DOMAIN_RC_FAST, ESP_PD_OPTION_ON);
+
+    esp_err_t ret = ledc_fade_func_install(0);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "GPIO config failed: %s", esp_err_to_name(ret));
+        ESP_LOGE(TAG, "LEDC fade install failed: %s", esp_err_to_name(ret));
         return ret;
     }
-    
-    // Initialize LED as off
-    gpio_set_level(led_gpio, 0);
-    led_state = false;
-    
-    // Start LED control task
-    led_task_running = true;
-    BaseType_t task_created = xTaskCreate(led_task, "led_task", 2048, NULL, 3, &led_task_handle);
-    if (task_created != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create LED task");
-        led_task_running = false;
-        return ESP_FAIL;
+
+    for (int c = 0; c < LED_CHANNEL_COUNT; c++) {
+        led_chan_t *ch = &channels[c];
+        if (ch->gpio < 0) {
+            continue;
+        }
+        ESP_LOGI(TAG, "Initializing LED %d on GPIO %d", c, ch->gpio);
+
+        ledc_timer_config_t timer_conf = {
+            .speed_mode = LED_SPEED_MODE,
+            .duty_resolution = LEDC_TIMER_10_BIT,
+            .timer_num = ch->ledc_timer,
+            .freq_hz = 1000,
+            .clk_cfg = LEDC_USE_RC_FAST_CLK,
+        };
+        ret = ledc_timer_config(&timer_conf);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "LEDC timer config failed: %s", esp_err_to_name(ret));
+            return ret;
+        }
+
+        // Initialize LED as off
+        ledc_channel_config_t channel_conf = {
+            .gpio_num = ch->gpio,
+            .speed_mode = LED_SPEED_MODE,
+            .channel = ch->ledc_channel,
+            .intr_type = LEDC_INTR_DISABLE,
+            .timer_sel = ch->ledc_timer,
+            .duty = 0,
+            .hpoint = 0,
+        };
+        ret = ledc_channel_config(&channel_conf);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "LEDC channel config failed: %s", esp_err_to_name(ret));
+            return ret;
+        }
+
+        ledc_cbs_t callbacks = { .fade_cb = led_fade_end_isr };
+        ledc_cb_register(LED_SPEED_MODE, ch->ledc_channel, &callbacks, ch);
     }
-    
+
     ESP_LOGI(TAG, "LED control initialized successfully");
     return ESP_OK;
 }
 
-esp_err_t led_set_pattern(led_pattern_t pattern)
+esp_err_t led_channel_set_pattern(led_channel_t channel, led_pattern_t pattern)
 {
-    ESP_LOGI(TAG, "Setting LED pattern to: %d", pattern);
-    current_pattern = pattern;
+    if ((unsigned)channel >= LED_CHANNEL_COUNT || (unsigned)pattern >= LED_PATTERN_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    DLOG(DLOG_LED_PATTERN, channel, pattern);
+
+    led_chan_t *ch = &channels[channel];
+    bool oneshot = led_pattern_is_oneshot(pattern);
+    if (!oneshot) {
+        atomic_store(&ch->steady, pattern);
+    }
+    // Re-requesting the current steady pattern does not wake the reactor
+    uint32_t prev = atomic_exchange(&ch->request, pattern);
+    if ((prev != pattern || oneshot) && ch->gpio >= 0) {
+        reactor_post(led_request, ch, 0, esp_timer_get_time());
+    }
     return ESP_OK;
 }
 
+esp_err_t led_set_pattern(led_pattern_t pattern)
+{
+    return led_channel_set_pattern(LED_CHANNEL_STATUS, pattern);
+}
+
 esp_err_t led_on(void)
 {
     return led_set_pattern(LED_PATTERN_ON);
@@ -138,7 +218,7 @@ esp_err_t led_off(void)
 
 esp_err_t led_toggle(void)
 {
-    if (current_pattern == LED_PATTERN_ON) {
+    if (led_get_pattern() == LED_PATTERN_ON) {
         return led_set_pattern(LED_PATTERN_OFF);
     } else {
         return led_set_pattern(LED_PATTERN_ON);
@@ -147,5 +227,5 @@ esp_err_t led_toggle(void)
 
 led_pattern_t led_get_pattern(void)
 {
-    return current_pattern;
-}
\ No newline at end of file
+    return (led_pattern_t)atomic_load(&channels[LED_CHANNEL_STATUS].steady);
+}
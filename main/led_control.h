@@ -3,29 +3,50 @@
 
 #include "driver/gpio.h"
 #include "esp_err.h"
-
-// LED patterns
-typedef enum {
-    LED_PATTERN_OFF,
-    LED_PATTERN_ON,
-    LED_PATTERN_SLOW_BLINK,
-    LED_PATTERN_FAST_BLINK,
-    LED_PATTERN_PULSE
-} led_pattern_t;
+#include "led_pattern.h"
 
 // Default GPIO pin for LED (can be overridden in sdkconfig)
 #ifndef CONFIG_LED_GPIO
 #define CONFIG_LED_GPIO GPIO_NUM_2
 #endif
 
+// Auxiliary LED, -1 if not fitted
+#ifndef CONFIG_LED_AUX_GPIO
+#define CONFIG_LED_AUX_GPIO -1
+#endif
+
+/**
+ * @brief LED outputs, each on its own LEDC channel and timer
+ */
+typedef enum {
+    LED_CHANNEL_STATUS,     // Vacuum state
+    LED_CHANNEL_AUX,        // Automatic mode
+    LED_CHANNEL_COUNT
+} led_channel_t;
+
 /**
  * @brief Initialize LED control
+ * @param status_gpio Status LED GPIO
+ * @param aux_gpio Automatic-mode LED GPIO, -1 if not fitted
+ * @return ESP_OK on success
+ */
+esp_err_t led_init(int status_gpio, int aux_gpio);
+
+/**
+ * @brief Set the pattern of one LED
+ *
+ * Lock-free and callable from any task: the request is a single atomic word
+ * and the reactor is only woken when it changes. One-shot patterns play once
+ * and then return to the channel's steady pattern.
+ *
+ * @param channel LED
+ * @param pattern LED pattern to set
  * @return ESP_OK on success
  */
-esp_err_t led_init(void);
+esp_err_t led_channel_set_pattern(led_channel_t channel, led_pattern_t pattern);
 
 /**
- * @brief Set LED pattern
+ * @brief Set the status LED pattern
  * @param pattern LED pattern to set
  * @return ESP_OK on success
  */
@@ -50,8 +71,8 @@ esp_err_t led_off(void);
 esp_err_t led_toggle(void);
 
 /**
- * @brief Get current LED pattern
- * @return Current LED pattern
+ * @brief Get current status LED pattern
+ * @return Current steady LED pattern
  */
 led_pattern_t led_get_pattern(void);
 
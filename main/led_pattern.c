@@ -0,0 +1,49 @@
+#include "led_pattern.h"
+
+#define LEDC_DIVIDER_MIN_Q8 (1u << 8)       // Divider 1.0
+#define LEDC_DIVIDER_MAX_Q8 (1u << 18)      // 10-bit integer part
+#define LED_DIM_PERIOD_MS   1               // 1 kHz PWM for SOLID and BREATHE
+
+static const led_pattern_desc_t pattern_table[LED_PATTERN_COUNT] = {
+    [LED_PATTERN_OFF]          = { .shape = LED_SHAPE_SOLID, .level = 0 },
+    [LED_PATTERN_ON]           = { .shape = LED_SHAPE_SOLID, .level = 1000 },
+    // 1 second on, 1 second off
+    [LED_PATTERN_SLOW_BLINK]   = { .shape = LED_SHAPE_BLINK, .period_ms = 2000, .on_permille = 500 },
+    // 250ms on, 250ms off
+    [LED_PATTERN_FAST_BLINK]   = { .shape = LED_SHAPE_BLINK, .period_ms = 500, .on_permille = 500 },
+    [LED_PATTERN_PULSE]        = { .shape = LED_SHAPE_BREATHE, .level = 1000, .period_ms = 1000 },
+    // Two 100ms flashes
+    [LED_PATTERN_DOUBLE_FLASH] = { .shape = LED_SHAPE_BLINK, .period_ms = 200, .on_permille = 500,
+                                   .count = 2 },
+};
+
+const led_pattern_desc_t *led_pattern_desc(led_pattern_t pattern)
+{
+    return &pattern_table[(unsigned)pattern < LED_PATTERN_COUNT ? pattern : LED_PATTERN_OFF];
+}
+
+bool led_pattern_timer(const led_pattern_desc_t *desc, uint32_t clk_hz, uint32_t max_res_bits,
+                       led_timer_setting_t *out)
+{
+    bool blink = desc->shape == LED_SHAPE_BLINK;
+    uint32_t period_ms = blink ? desc->period_ms : LED_DIM_PERIOD_MS;
+    uint32_t on_permille = blink ? desc->on_permille : desc->level;
+
+    // PWM period = divider * 2^res / clk_hz, so divider = clk_hz * period / 2^res
+    uint64_t ticks_q8 = (uint64_t)clk_hz * period_ms * 256 / 1000;
+
+    for (uint32_t res = max_res_bits; res >= 1; res--) {
+        uint64_t divider_q8 = ticks_q8 >> res;
+        if (divider_q8 < LEDC_DIVIDER_MIN_Q8) {
+            continue;
+        }
+        if (divider_q8 >= LEDC_DIVIDER_MAX_Q8) {
+            return false;
+        }
+        out->divider_q8 = (uint32_t)divider_q8;
+        out->res_bits = res;
+        out->duty = (uint32_t)(((uint64_t)on_permille << res) / 1000);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,78 @@
+#ifndef LED_PATTERN_H
+#define LED_PATTERN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// LED patterns
+typedef enum {
+    LED_PATTERN_OFF,
+    LED_PATTERN_ON,
+    LED_PATTERN_SLOW_BLINK,
+    LED_PATTERN_FAST_BLINK,
+    LED_PATTERN_PULSE,
+    LED_PATTERN_DOUBLE_FLASH,   // One-shot acknowledgement
+    LED_PATTERN_COUNT
+} led_pattern_t;
+
+/**
+ * @brief How the LEDC peripheral plays a pattern
+ */
+typedef enum {
+    LED_SHAPE_SOLID,        // Constant PWM duty
+    LED_SHAPE_BLINK,        // Square wave: the LEDC timer itself runs at the blink rate
+    LED_SHAPE_BREATHE,      // Hardware fades up and down
+} led_shape_t;
+
+/**
+ * @brief Declarative pattern description
+ */
+typedef struct {
+    led_shape_t shape;
+    uint16_t level;         // SOLID/BREATHE peak brightness, permille
+    uint16_t period_ms;     // BLINK/BREATHE period
+    uint16_t on_permille;   // BLINK: lit part of the period
+    uint8_t count;          // Periods to play before returning to the steady pattern, 0 = steady
+} led_pattern_desc_t;
+
+/**
+ * @brief LEDC timer and duty setting that plays a pattern
+ */
+typedef struct {
+    uint32_t divider_q8;    // Clock divider, 10.8 fixed point
+    uint32_t res_bits;      // Duty resolution
+    uint32_t duty;          // Lit part (BLINK) or brightness (SOLID, BREATHE peak)
+} led_timer_setting_t;
+
+/**
+ * @brief Description of a pattern
+ * @param pattern Pattern
+ * @return Descriptor (OFF for unknown patterns)
+ */
+const led_pattern_desc_t *led_pattern_desc(led_pattern_t pattern);
+
+/**
+ * @brief Whether a pattern plays once and then gives the LED back
+ */
+static inline bool led_pattern_is_oneshot(led_pattern_t pattern)
+{
+    return led_pattern_desc(pattern)->count != 0;
+}
+
+/**
+ * @brief Compute the LEDC timer setting for a pattern
+ *
+ * BLINK runs the PWM at the blink period itself, so the square wave needs no
+ * CPU at all; SOLID and BREATHE dim with a 1 kHz PWM. Picks the finest duty
+ * resolution whose clock divider is still >= 1.
+ *
+ * @param desc Pattern
+ * @param clk_hz LEDC timer source clock
+ * @param max_res_bits Widest duty resolution the timer supports
+ * @param out Timer setting
+ * @return false if the period cannot be reached from this clock
+ */
+bool led_pattern_timer(const led_pattern_desc_t *desc, uint32_t clk_hz, uint32_t max_res_bits,
+                       led_timer_setting_t *out);
+
+#endif // LED_PATTERN_H
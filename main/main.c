@@ -4,172 +4,160 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
-#include "freertos/timers.h"
 #include "esp_system.h"
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "driver/gpio.h"
+#include "driver/uart.h"
+#include "driver/uart_vfs.h"
+#include "esp_timer.h"
 
 #include "led_control.h"
 #include "bt_manager.h"
+#include "adv_capture.h"
+#include "vacuum_sm.h"
+#include "vacuum_snapshot.h"
+#include "input.h"
+#include "lat_trace.h"
+#include "dlog.h"
+#include "power_mgmt.h"
+#include "metrics.h"
+#include "app_config.h"
+#include "boot_prof.h"
+#include "reactor.h"
+#include "static_alloc.h"
 
 static const char *TAG = "MAKITA_VACUUM";
 
-#define BUTTON_GPIO 4
-static gpio_num_t relay_gpio = 16;  // Default Relay GPIO
-#define DEVICE_NAME "Makita_Vacuum"
+#define BUTTON_LONG_PRESS_MS 2000
+
+// The reactor runs the state machine, so it sits above the NimBLE host and
+// esp_timer tasks: a posted event reaches the relay without waiting for them
+// to block
+#define REACTOR_TASK_PRIORITY (configMAX_PRIORITIES - 2)
+
+// Periodic housekeeping on the reactor. The slack lets it run early
+// alongside other work instead of waking the CPU on its own.
+#define STATUS_PERIOD_US    10000000
+#define STATUS_SLACK_US     1000000
+
+// Console commands and NVS writes block for milliseconds to seconds (an
+// advert capture dump is thousands of lines at 115200 baud), so they run on
+// a low-priority task of their own instead of the reactor. Its deepest path
+// is an NVS blob write that logs an error.
+#define CONSOLE_STACK       3072
+#define CONSOLE_PRIORITY    1
+#define CONSOLE_QUEUE_LEN   8
+
+// Commands from the firmware share the console's queue with the UART
+// driver's events, under a type the driver never uses
+#define CONSOLE_EVENT_COMMAND   UART_EVENT_MAX
+#define CONSOLE_CMD_SAVE_AUTO   0x100   // Store the power-on automatic mode
+
+// Console output goes through a driver ring buffer, so a status report on the
+// reactor costs formatting time rather than 115200 baud transmit time
+#define CONSOLE_RX_BUF      256
+#define CONSOLE_TX_BUF      2048
+
+// BLE bring-up runs on its own task while app_main sets up the rest. On
+// dual-core chips it goes to core 1 so the two really overlap. The task
+// ends after boot, so it stays on the heap even in the static build.
+#define BT_INIT_STACK 4096
+#if portNUM_PROCESSORS > 1
+#define BT_INIT_CORE 1
+#else
+#define BT_INIT_CORE tskNO_AFFINITY
+#endif
+
 
 // Event group for synchronization
 EventGroupHandle_t vacuum_event_group;
-#define TOOL_POWER_ON_BIT BIT0
-#define BT_CONNECTED_BIT BIT1
-#define AUTO_MODE_TOGGLE_BIT BIT2
-
-// Vacuum state
-typedef enum {
-    VACUUM_STATE_IDLE,
-    VACUUM_STATE_STANDBY,
-    VACUUM_STATE_ACTIVE
-} vacuum_state_t;
-
-static vacuum_state_t current_state = VACUUM_STATE_IDLE;
-
-// Automatic mode state (disabled on startup)
-static bool automatic_mode_enabled = false;
-
-// Enhanced button debouncing and spike filtering
-#define BUTTON_DEBOUNCE_MS 50          // Debounce time in ms
-#define BUTTON_SPIKE_FILTER_SAMPLES 3  // Number of consistent readings needed
-#define BUTTON_PRESS_MIN_TIME_MS 30    // Minimum press time to be valid
-#define BUTTON_RELEASE_MIN_TIME_MS 50  // Minimum release time between presses
-
-typedef enum {
-    BUTTON_STATE_IDLE,
-    BUTTON_STATE_PRESSED_DEBOUNCE,
-    BUTTON_STATE_PRESSED_CONFIRMED,
-    BUTTON_STATE_RELEASED_DEBOUNCE
-} button_state_t;
-
-static volatile button_state_t button_state = BUTTON_STATE_IDLE;
-static volatile uint32_t button_press_start_time = 0;
-static volatile uint32_t button_last_change_time = 0;
-static volatile uint8_t button_spike_filter_count = 0;
-static volatile bool button_expected_level = 1; // Expected GPIO level (1 = released, 0 = pressed)
-static TimerHandle_t button_debounce_timer = NULL;
-
-// Button debounce timer callback
-static void button_debounce_timer_callback(TimerHandle_t xTimer)
+
+static uint32_t vacuum_events_lost = 0;
+static vacuum_sm_t vacuum_sm;           // Owned by the reactor task
+static vacuum_snapshot_latch_t vacuum_snapshot;   // What everyone else reads
+static input_t inputs;
+static TaskHandle_t app_main_task = NULL;
+static QueueHandle_t console_queue = NULL;
+static bool bt_ready = false;           // bt_manager_init() succeeded; set before the reactor starts
+
+static void vacuum_sm_resync(void *ctx, uint32_t lost, int64_t now_us);
+static reactor_latch_t vacuum_lost = REACTOR_LATCH_INIT(vacuum_sm_resync, NULL);
+static void status_report(reactor_timer_t *timer, int64_t now_us);
+static reactor_timer_t status_timer = REACTOR_TIMER_INIT(status_report, NULL, STATUS_SLACK_US);
+
+STATIC_EVENT_GROUP_STORAGE(vacuum)
+STATIC_TASK_STORAGE(console, CONSOLE_STACK)
+#ifndef CONFIG_ESP_CONSOLE_UART
+STATIC_QUEUE_STORAGE(console, CONSOLE_QUEUE_LEN, sizeof(uart_event_t))
+#endif
+
+// GPIO filled in from the configuration at boot
+static input_cfg_t input_cfgs[] = {
+    { .gpio = -1, .active_low = true, .long_ms = BUTTON_LONG_PRESS_MS },
+};
+
+// Called on the console task only
+static void run_command(uint32_t cmd)
 {
-    uint32_t current_time = xTaskGetTickCount() * portTICK_PERIOD_MS;
-    int current_level = gpio_get_level(BUTTON_GPIO);
-    
-    switch (button_state) {
-        case BUTTON_STATE_PRESSED_DEBOUNCE:
-            // Check if button is still pressed after debounce period
-            if (current_level == 0) {
-                // Confirm button press
-                button_state = BUTTON_STATE_PRESSED_CONFIRMED;
-                button_press_start_time = current_time;
-                ESP_LOGD(TAG, "Button press confirmed");
-            } else {
-                // False trigger, return to idle
-                button_state = BUTTON_STATE_IDLE;
-                button_expected_level = 1;
-                ESP_LOGD(TAG, "Button press rejected (spike)");
+    vacuum_snapshot_t snap;
+
+    switch (cmd) {
+        case 'c':
+            adv_capture_dump();
+            break;
+        case 'p':
+            if (bt_ready) {
+                bt_pair_active_tools();
             }
             break;
-            
-        case BUTTON_STATE_RELEASED_DEBOUNCE:
-            // Check if button is still released after debounce period
-            if (current_level == 1) {
-                // Confirm button release - check if press was long enough
-                uint32_t press_duration = current_time - button_press_start_time;
-                
-                if (press_duration >= BUTTON_PRESS_MIN_TIME_MS) {
-                    // Valid button press detected - trigger automatic mode toggle
-                    xEventGroupSetBits(vacuum_event_group, AUTO_MODE_TOGGLE_BIT);
-                    ESP_LOGI(TAG, "Valid button press detected (duration: %lu ms)", press_duration);
-                } else {
-                    ESP_LOGD(TAG, "Button press too short (duration: %lu ms)", press_duration);
-                }
-                
-                button_state = BUTTON_STATE_IDLE;
-                button_expected_level = 1;
-            } else {
-                // Button pressed again quickly, return to pressed state
-                button_state = BUTTON_STATE_PRESSED_CONFIRMED;
-                ESP_LOGD(TAG, "Button pressed again during release debounce");
+        case 'u':
+            if (bt_ready) {
+                bt_unpair_tools();
             }
             break;
-            
+        case 'm':
+            metrics_dump();
+            break;
+        case 'b':
+            boot_prof_report();
+            break;
+        case CONSOLE_CMD_SAVE_AUTO:
+            // Only writes on a change
+            vacuum_state_get(&snap);
+            app_config_set_auto_mode(snap.auto_mode);
+            break;
         default:
-            button_state = BUTTON_STATE_IDLE;
-            button_expected_level = 1;
             break;
     }
 }
 
-// Enhanced button interrupt handler with spike filtering
-static void IRAM_ATTR button_isr_handler(void* arg)
+// Hand a command to the console task; never blocks the caller
+static bool post_command(uint32_t cmd)
 {
-    uint32_t current_time = xTaskGetTickCountFromISR() * portTICK_PERIOD_MS;
-    int current_level = gpio_get_level(BUTTON_GPIO);
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-    
-    // Ignore interrupts if they happen too frequently (hardware spike protection)
-    if (current_time - button_last_change_time < 5) { // 5ms minimum between interrupts
-        return;
-    }
-    
-    button_last_change_time = current_time;
-    
-    // Spike filter: only proceed if we get the expected level change
-    if (current_level == button_expected_level) {
-        // This is not the expected transition, likely a spike
-        return;
-    }
-    
-    // Process state machine
-    switch (button_state) {
-        case BUTTON_STATE_IDLE:
-            if (current_level == 0) { // Button pressed
-                button_state = BUTTON_STATE_PRESSED_DEBOUNCE;
-                button_expected_level = 0;
-                button_spike_filter_count = 0;
-                
-                // Start debounce timer
-                xTimerStartFromISR(button_debounce_timer, &xHigherPriorityTaskWoken);
-            }
+    uart_event_t ev = { .type = CONSOLE_EVENT_COMMAND, .size = cmd };
+
+    return console_queue && xQueueSend(console_queue, &ev, 0) == pdTRUE;
+}
+
+// Button gestures: short toggles automatic mode, reported on release, and
+// long pairs the running tools. Clearing the pairings re-admits every tool in
+// range, so it is left to the console rather than an accidental double tap.
+static void input_event(uint8_t input, input_event_t event, uint32_t now_ms, void *ctx)
+{
+    switch (event) {
+        case INPUT_EVENT_SHORT:
+            vacuum_sm_post(VACUUM_EVENT_AUTO_TOGGLE, esp_timer_get_time());
             break;
-            
-        case BUTTON_STATE_PRESSED_CONFIRMED:
-            if (current_level == 1) { // Button released
-                // Check minimum press time
-                if (current_time - button_press_start_time >= BUTTON_PRESS_MIN_TIME_MS) {
-                    button_state = BUTTON_STATE_RELEASED_DEBOUNCE;
-                    button_expected_level = 1;
-                    
-                    // Start debounce timer for release
-                    xTimerStartFromISR(button_debounce_timer, &xHigherPriorityTaskWoken);
-                } else {
-                    // Press was too short, probably a spike
-                    button_state = BUTTON_STATE_IDLE;
-                    button_expected_level = 1;
-                }
-            }
+        case INPUT_EVENT_LONG:
+            post_command('p');
             break;
-            
         default:
-            // Shouldn't happen in ISR during debounce states
             break;
     }
-    
-    if (xHigherPriorityTaskWoken) {
-        portYIELD_FROM_ISR();
-    }
 }
 
-static void relay_init(void)
+static void relay_init(gpio_num_t relay_gpio, uint32_t level)
 {  
     ESP_LOGI(TAG, "Initializing Relay GPIO %d", relay_gpio);
 
@@ -188,234 +176,354 @@ static void relay_init(void)
         // return ret;
     }
 
-    gpio_set_level(relay_gpio, 0);
+    gpio_set_level(relay_gpio, level);
 }
 
-// Initialize pushbutton GPIO with enhanced debouncing
-static void button_init(void)
+static void publish_state(int64_t timestamp_us);
+
+static void vacuum_sm_event(void *ctx, uint32_t type, int64_t timestamp_us)
 {
-    // Create debounce timer first
-    button_debounce_timer = xTimerCreate(
-        "button_debounce",                    // Timer name
-        pdMS_TO_TICKS(BUTTON_DEBOUNCE_MS),   // Timer period
-        pdFALSE,                             // Auto-reload (pdFALSE = one-shot)
-        NULL,                                // Timer ID
-        button_debounce_timer_callback       // Callback function
-    );
-    
-    if (button_debounce_timer == NULL) {
-        ESP_LOGE(TAG, "Failed to create button debounce timer");
-        return;
-    }
-    
-    // Configure GPIO with enhanced settings for better noise immunity
-    gpio_config_t io_conf = {
-        .pin_bit_mask = (1ULL << BUTTON_GPIO),
-        .mode = GPIO_MODE_INPUT,
-        .pull_up_en = GPIO_PULLUP_ENABLE,    // Enable internal pull-up
-        .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .intr_type = GPIO_INTR_ANYEDGE       // Trigger on both edges for better state tracking
+    vacuum_event_t ev = {
+        .type = (vacuum_event_type_t)type,
+        .timestamp_us = timestamp_us
     };
-    
-    esp_err_t ret = gpio_config(&io_conf);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Button GPIO config failed: %s", esp_err_to_name(ret));
-        return;
-    }
-    
-    // Set GPIO input hysteresis for better noise immunity (if supported)
-    gpio_set_drive_capability(BUTTON_GPIO, GPIO_DRIVE_CAP_0); // Minimum drive for input
-    
-    // Install ISR service if not already installed
-    ret = gpio_install_isr_service(0);
-    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
-        ESP_LOGE(TAG, "Failed to install GPIO ISR service: %s", esp_err_to_name(ret));
-        return;
+
+    pm_note_wake(PM_WAKE_SM_EVENT);
+    // Switch the relay at full clock speed
+    power_mgmt_lock();
+    lat_trace_record(LAT_STAGE_PICKUP, ev.timestamp_us);
+    vacuum_sm_handle_event(&vacuum_sm, &ev);
+    if (bt_ready) {
+        bt_scan_follow_state(vacuum_sm.state);
     }
-    
-    // Initialize button state
-    button_state = BUTTON_STATE_IDLE;
-    button_expected_level = gpio_get_level(BUTTON_GPIO);
-    button_last_change_time = xTaskGetTickCount() * portTICK_PERIOD_MS;
-    
-    // Add ISR handler for the button
-    gpio_isr_handler_add(BUTTON_GPIO, button_isr_handler, NULL);
-    
-    ESP_LOGI(TAG, "Enhanced button initialized on GPIO %d with debouncing and spike filtering", BUTTON_GPIO);
-    ESP_LOGI(TAG, "Button config: debounce=%dms, min_press=%dms, spike_filter=%d samples", 
-             BUTTON_DEBOUNCE_MS, BUTTON_PRESS_MIN_TIME_MS, BUTTON_SPIKE_FILTER_SAMPLES);
+    publish_state(ev.timestamp_us);
+    power_mgmt_unlock();
 }
 
-static void vacuum_state_machine_task(void *pvParameters)
+// Events that found the queue full, run once it has drained. Tool events
+// are edges of levels the BLE manager still holds, so the current levels are
+// applied rather than the lost edges; anything else is replayed once.
+static void vacuum_sm_resync(void *ctx, uint32_t lost, int64_t now_us)
 {
-    EventBits_t bits;
-    
-    while (1) {
-        // Wait for events with a timeout
-        bits = xEventGroupWaitBits(vacuum_event_group,
-                                   TOOL_POWER_ON_BIT | BT_CONNECTED_BIT | AUTO_MODE_TOGGLE_BIT,
-                                   pdFALSE,  // Don't clear bits on exit
-                                   pdFALSE,  // Wait for any bit
-                                   pdMS_TO_TICKS(1000));
-
-        // Check for automatic mode toggle
-        if (bits & AUTO_MODE_TOGGLE_BIT) {
-            automatic_mode_enabled = !automatic_mode_enabled;
-            xEventGroupClearBits(vacuum_event_group, AUTO_MODE_TOGGLE_BIT);
-            
-            ESP_LOGI(TAG, "🔘 Automatic mode %s", 
-                     automatic_mode_enabled ? "ENABLED" : "DISABLED");
-            
-            // Visual feedback: brief LED flash pattern
-            if (automatic_mode_enabled) {
-                gpio_set_level(relay_gpio, 1);
-
-                // Flash LED quickly 3 times to indicate auto mode enabled
-                led_set_pattern(LED_PATTERN_FAST_BLINK);
-                vTaskDelay(pdMS_TO_TICKS(2000));
-            } else {
-                gpio_set_level(relay_gpio, 0); // Deactivate relay
-                // Single long flash to indicate auto mode disabled
-                led_set_pattern(LED_PATTERN_FAST_BLINK);
-                vTaskDelay(pdMS_TO_TICKS(2000));
-            }
-            
-            // Restore appropriate LED pattern based on current state
-            // switch (current_state) {
-            //     case VACUUM_STATE_IDLE:
-            //         led_set_pattern(LED_PATTERN_PULSE);
-            //         break;
-            //     case VACUUM_STATE_STANDBY:
-            //         led_set_pattern(LED_PATTERN_SLOW_BLINK);
-            //         break;
-            //     case VACUUM_STATE_ACTIVE:
-            //         led_set_pattern(LED_PATTERN_ON);
-            //         break;
-            // }
+    const uint32_t presence = 1u << VACUUM_EVENT_TOOL_DETECTED | 1u << VACUUM_EVENT_TOOL_LOST;
+    const uint32_t power = 1u << VACUUM_EVENT_TOOL_POWER_ON | 1u << VACUUM_EVENT_TOOL_POWER_OFF;
+    bool detected = false, powered = false;
+
+    if (bt_ready) {
+        bt_get_tool_state(&detected, &powered);
+    }
+    if (lost & presence) {
+        vacuum_sm_event(NULL, detected ? VACUUM_EVENT_TOOL_DETECTED : VACUUM_EVENT_TOOL_LOST, now_us);
+    }
+    if (lost & power) {
+        vacuum_sm_event(NULL, powered ? VACUUM_EVENT_TOOL_POWER_ON : VACUUM_EVENT_TOOL_POWER_OFF, now_us);
+    }
+    lost &= ~(presence | power);
+    for (uint32_t type = 0; lost; type++, lost >>= 1) {
+        if (lost & 1) {
+            vacuum_sm_event(NULL, type, now_us);
         }
+    }
+}
 
-        switch (current_state) {
-            case VACUUM_STATE_IDLE:
-                if (bits & BT_CONNECTED_BIT) {
-                    ESP_LOGI(TAG, "Bluetooth connected - entering STANDBY mode");
-                    current_state = VACUUM_STATE_STANDBY;
-                    led_set_pattern(LED_PATTERN_SLOW_BLINK);
-                }
+void vacuum_sm_post(vacuum_event_type_t type, int64_t timestamp_us)
+{
+    // Never block the poster (NimBLE host, esp_timer task or the reactor
+    // itself). A full queue must not lose an edge for good: the event is
+    // latched and resynchronised once the queue has drained.
+    if (!reactor_post(vacuum_sm_event, NULL, type, timestamp_us)) {
+        vacuum_events_lost++;
+        reactor_latch(&vacuum_lost, 1u << type);
+    }
+}
+
+void vacuum_state_get(vacuum_snapshot_t *out)
+{
+    vacuum_snapshot_read(&vacuum_snapshot, out);
+}
+
+// Called on the reactor task, the snapshot's only writer
+static void publish_state(int64_t timestamp_us)
+{
+    static int8_t auto_posted = -1;
+    vacuum_snapshot_t snap = {
+        .state = vacuum_sm.state,
+        .auto_mode = vacuum_sm.auto_mode,
+        .tool_detected = vacuum_sm.tool_detected,
+        .tool_power = vacuum_sm.tool_power,
+        .prestarted = vacuum_sm.prestarted,
+        .relay_level = vacuum_sm.relay_level,
+        .transition_us = vacuum_sm.transition_us,
+        .published_us = timestamp_us,
+    };
+    snap.tools_active = bt_ready ? bt_get_driving_tools(snap.tools, VACUUM_SNAPSHOT_TOOLS) : 0;
+    vacuum_snapshot_publish(&vacuum_snapshot, &snap);
+    app_config_note_live(snap.state, snap.auto_mode);
+
+    // Keep the power-on automatic mode in step; retried on the next publish
+    // if the console queue was full
+    if (auto_posted != snap.auto_mode && post_command(CONSOLE_CMD_SAVE_AUTO)) {
+        auto_posted = snap.auto_mode;
+    }
+}
+
+// Controller init, PHY calibration and NimBLE host start, then back to
+// app_main with the result as the notification value
+static void bt_init_task(void *pvParameters)
+{
+    ESP_LOGI(TAG, "Initializing Bluetooth...");
+    esp_err_t ret = bt_manager_init(vacuum_event_group);
+    boot_prof_mark(BOOT_MS_BT_READY, esp_timer_get_time());
+    xTaskNotify(app_main_task, (uint32_t)ret, eSetValueWithOverwrite);
+    vTaskDelete(NULL);
+}
+
+// Sleeps on its queue until a command is posted or the UART receives
+static void console_task(void *arg)
+{
+    uart_event_t ev;
+
+    for (;;) {
+        if (xQueueReceive(console_queue, &ev, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        pm_note_wake(PM_WAKE_CONSOLE);
+        switch ((int)ev.type) {
+            case CONSOLE_EVENT_COMMAND:
+                run_command((uint32_t)ev.size);
                 break;
-                
-            case VACUUM_STATE_STANDBY:
-                if (!(bits & BT_CONNECTED_BIT)) {
-                    ESP_LOGI(TAG, "Bluetooth disconnected - returning to IDLE");
-                    current_state = VACUUM_STATE_IDLE;
-                    led_set_pattern(LED_PATTERN_OFF);
-                } else if (bits & TOOL_POWER_ON_BIT) {
-                    if (automatic_mode_enabled) {
-                        ESP_LOGI(TAG, "Tool power detected - ACTIVATING vacuum!");
-                        current_state = VACUUM_STATE_ACTIVE;
-                        led_set_pattern(LED_PATTERN_ON);
-                        
-                        // Simulate vacuum activation
-                        ESP_LOGI(TAG, "🌪️  VACUUM CLEANER ACTIVATED! 🌪️");
-                        gpio_set_level(relay_gpio, 0);
-                        
-                        // Clear the power on bit after activation
-                        // xEventGroupClearBits(vacuum_event_group, TOOL_POWER_ON_BIT);
-
-                        // Auto-deactivate after 10 seconds (simulate tool power off)
-                        // vTaskDelay(pdMS_TO_TICKS(10000));
-                        // ESP_LOGI(TAG, "Tool power timeout - deactivating vacuum");
-                        // current_state = VACUUM_STATE_STANDBY;
-                        // led_set_pattern(LED_PATTERN_SLOW_BLINK);
-                    } else {
-                        ESP_LOGI(TAG, "Tool power detected but automatic mode is DISABLED - ignoring");
-                        // Clear the power on bit since we're ignoring it
-                        // xEventGroupClearBits(vacuum_event_group, TOOL_POWER_ON_BIT);
-                    }
+#ifdef CONFIG_ESP_CONSOLE_UART
+            case UART_DATA: {
+                uint8_t c;
+                while (uart_read_bytes(CONFIG_ESP_CONSOLE_UART_NUM, &c, 1, 0) == 1) {
+                    run_command(c);
                 }
                 break;
-                
-            case VACUUM_STATE_ACTIVE:
-                if (!(bits & BT_CONNECTED_BIT)) {
-                    ESP_LOGI(TAG, "Bluetooth disconnected during operation - emergency stop!");
-                    current_state = VACUUM_STATE_IDLE;
-                    led_set_pattern(LED_PATTERN_OFF);
-                } else if (bits & TOOL_POWER_ON_BIT) {
-                    // Reset timer if we get another power signal
-                    // xEventGroupClearBits(vacuum_event_group, TOOL_POWER_ON_BIT);
-                }
-                else {
-                    ESP_LOGI(TAG, "Tool power OFF detected - returning to STANDBY");
-                    current_state = VACUUM_STATE_STANDBY;
-                    led_set_pattern(LED_PATTERN_SLOW_BLINK);
-                    gpio_set_level(relay_gpio, 1); // Deactivate relay for indication
-
-                    // Simulate vacuum deactivation
-                    ESP_LOGI(TAG, "🛑 VACUUM CLEANER DEACTIVATED! 🛑");
-                }
+            }
+            case UART_FIFO_OVF:
+            case UART_BUFFER_FULL:
+                // The driver stops receiving until the backlog is dropped
+                uart_flush_input(CONFIG_ESP_CONSOLE_UART_NUM);
+                break;
+#endif
+            default:
                 break;
         }
-        
-        vTaskDelay(pdMS_TO_TICKS(100));
     }
 }
 
-static void print_status_task(void *pvParameters)
+static void status_state(void)
+{
+    static bool boot_reported = false;
+    vacuum_snapshot_t snap;
+
+    // The boot profile is complete once a tool has been detected
+    if (!boot_reported && boot_prof_get(BOOT_MS_FIRST_DETECTION)) {
+        boot_prof_report();
+        boot_reported = true;
+    }
+    vacuum_state_get(&snap);
+    ESP_LOGI(TAG, "Status - State: %s, BT: %s, Auto Mode: %s, Relay: %u, Tools running: %u",
+             vacuum_state_name(snap.state),
+             snap.tool_detected ? "Connected" : "Disconnected",
+             snap.auto_mode ? "ENABLED" : "DISABLED", snap.relay_level, snap.tools_active);
+    ESP_LOGI(TAG, "State snapshot - version %lu, last transition %lld ms ago, read retries: %lu",
+             snap.version, (long long)(esp_timer_get_time() - snap.transition_us) / 1000,
+             (uint32_t)atomic_load(&vacuum_snapshot.retries));
+}
+
+static void status_counters(void)
+{
+    ESP_LOGI(TAG, "Relay latency - last: %lld us, max: %lld us, over budget: %lu/%lu, events lost to a full queue (resynced): %lu",
+             (long long)vacuum_sm.latency_last_us, (long long)vacuum_sm.latency_max_us,
+             vacuum_sm.latency_budget_misses, vacuum_sm.relay_writes, vacuum_events_lost);
+    uint32_t dlog_written, dlog_dropped;
+    dlog_get_stats(&dlog_written, &dlog_dropped);
+    ESP_LOGI(TAG, "Deferred log - records: %lu, dropped: %lu", dlog_written, dlog_dropped);
+    ESP_LOGI(TAG, "Inputs - ISRs: %lu, samples: %lu, edges: %lu, rejected: %lu, storms: %lu",
+             inputs.isr_count, inputs.samples, inputs.edges,
+             inputs.edges - inputs.changes, inputs.storms);
+}
+
+static void status_ble(void)
+{
+    if (bt_ready) {
+        bt_aws_print_status();
+    } else {
+        ESP_LOGW(TAG, "Bluetooth unavailable - tools are not detected");
+    }
+}
+
+// The report runs one section per timer callback, so events that arrive
+// meanwhile are handled between sections rather than after the whole report
+static void (*const status_sections[])(void) = {
+    status_state,
+    status_counters,
+    lat_trace_report,
+    status_ble,
+    power_mgmt_print_status,
+    reactor_print_status,
+    metrics_print_stacks,
+};
+
+static void status_report(reactor_timer_t *timer, int64_t now_us)
+{
+    static uint8_t section = 0;
+    static int64_t started_us;
+
+    if (section == 0) {
+        pm_note_wake(PM_WAKE_STATUS);
+        started_us = now_us;
+    }
+    status_sections[section++]();
+    if (section < sizeof(status_sections) / sizeof(status_sections[0])) {
+        reactor_arm(timer, now_us);
+    } else {
+        section = 0;
+        reactor_arm(timer, started_us + STATUS_PERIOD_US);
+    }
+}
+
+// The console task's queue: the UART driver's event queue, or a plain one
+// when the console is not on a UART
+static void console_init(void)
 {
-    while (1) {
-        ESP_LOGI(TAG, "Status - State: %s, BT: %s, Auto Mode: %s", 
-                 current_state == VACUUM_STATE_IDLE ? "IDLE" :
-                 current_state == VACUUM_STATE_STANDBY ? "STANDBY" : "ACTIVE",
-                 (xEventGroupGetBits(vacuum_event_group) & BT_CONNECTED_BIT) ? "Connected" : "Disconnected",
-                 automatic_mode_enabled ? "ENABLED" : "DISABLED");
-
-        vTaskDelay(pdMS_TO_TICKS(10000)); // Print status every 10 seconds
+#ifdef CONFIG_ESP_CONSOLE_UART
+    esp_err_t ret = uart_driver_install(CONFIG_ESP_CONSOLE_UART_NUM, CONSOLE_RX_BUF, CONSOLE_TX_BUF,
+                                        CONSOLE_QUEUE_LEN, &console_queue, 0);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Console UART driver install failed: %s", esp_err_to_name(ret));
+        console_queue = NULL;
+        return;
     }
+    uart_vfs_dev_use_driver(CONFIG_ESP_CONSOLE_UART_NUM);
+#else
+    console_queue = STATIC_QUEUE_CREATE(console, CONSOLE_QUEUE_LEN, sizeof(uart_event_t));
+#endif
 }
 
 void app_main(void)
 {
+    boot_prof_mark(BOOT_MS_APP_MAIN, esp_timer_get_time());
     ESP_LOGI(TAG, "🔧 Makita Vacuum Cleaner Starting... 🔧");
+    app_main_task = xTaskGetCurrentTaskHandle();
     
-    // Initialize NVS
+    // Initialize NVS (the BLE PHY calibration data lives there too)
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
         ESP_ERROR_CHECK(nvs_flash_erase());
         ret = nvs_flash_init();
     }
     ESP_ERROR_CHECK(ret);
+    boot_prof_mark(BOOT_MS_NVS, esp_timer_get_time());
+
+    // Configuration and, after a warm restart, the state before the reset
+    app_live_t live;
+    int64_t config_start_us = esp_timer_get_time();
+    bool warm = app_config_init(&live);
+    const app_config_t *cfg = app_config();
+    boot_prof_mark(BOOT_MS_CONFIG, esp_timer_get_time());
+    ESP_LOGI(TAG, "%s boot: configuration loaded in %lld us", warm ? "Warm" : "Cold",
+             (long long)(esp_timer_get_time() - config_start_us));
+
+    // DFS and automatic light sleep
+    if (power_mgmt_init() != ESP_OK) {
+        ESP_LOGE(TAG, "Power management unavailable - running at full speed");
+    }
+
+    // Buffered console before the first long log bursts
+    console_init();
+
+    // Drain hot-path trace records in the background
+    if (dlog_init() != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start deferred log task");
+    }
     
     // Create event group
-    vacuum_event_group = xEventGroupCreate();
+    vacuum_event_group = STATIC_EVENT_GROUP_CREATE(vacuum);
     if (vacuum_event_group == NULL) {
         ESP_LOGE(TAG, "Failed to create event group");
         return;
     }
+
+    // One queue for state machine events, LED requests, input interrupts
+    // and commands
+    if (reactor_create() != ESP_OK) {
+        return;
+    }
+    reactor_register_latch(&vacuum_lost);
+
+    // Start the BLE controller and host first, they take longest. Events
+    // they post wait in the queue until the reactor starts.
+    boot_prof_mark(BOOT_MS_BT_START, esp_timer_get_time());
+    if (xTaskCreatePinnedToCore(bt_init_task, "bt_init", BT_INIT_STACK, NULL,
+                                uxTaskPriorityGet(NULL) + 1, NULL, BT_INIT_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create BLE init task");
+        return;
+    }
     
     // Initialize LED control
     ESP_LOGI(TAG, "Initializing LED control...");
-    led_init();
+    led_init(cfg->led_gpio, cfg->led_aux_gpio);
     led_set_pattern(LED_PATTERN_FAST_BLINK);
+    boot_prof_mark(BOOT_MS_LED, esp_timer_get_time());
     
-    // Initialize pushbutton for automatic mode toggle
+    // Initialize pushbutton for automatic mode toggle and pairing
     ESP_LOGI(TAG, "Initializing pushbutton control...");
-    button_init();
+    input_cfgs[0].gpio = cfg->button_gpio;
+    input_init(&inputs, input_cfgs, sizeof(input_cfgs) / sizeof(input_cfgs[0]), input_event, NULL);
+    if (input_start(&inputs) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start input subsystem");
+    }
+    boot_prof_mark(BOOT_MS_INPUT, esp_timer_get_time());
     
-    relay_init();
+    // Automatic mode holds the relay at 1 until a tool runs, so start there
+    relay_init(cfg->relay_gpio, live.auto_mode ? 1 : 0);
+    vacuum_sm_init(&vacuum_sm, cfg->relay_gpio);
+    vacuum_sm_restore(&vacuum_sm, live.auto_mode);
+    vacuum_snapshot_init(&vacuum_snapshot);
+    boot_prof_mark(BOOT_MS_RELAY, esp_timer_get_time());
     
-    // Initialize Bluetooth
-    ESP_LOGI(TAG, "Initializing Bluetooth...");
-    bt_manager_init(vacuum_event_group);
+    // Publishing needs the BLE manager's registry. Without it the vacuum
+    // still runs on the button alone.
+    uint32_t bt_ret;
+    xTaskNotifyWait(0, UINT32_MAX, &bt_ret, portMAX_DELAY);
+    bt_ready = (esp_err_t)bt_ret == ESP_OK;
+    if (!bt_ready) {
+        ESP_LOGE(TAG, "Bluetooth init failed: %s - button control only", esp_err_to_name((esp_err_t)bt_ret));
+    }
+    publish_state(esp_timer_get_time());
+    if (bt_ready && live.state != VACUUM_STATE_IDLE) {
+        // A tool was around before the reset: rediscover it at high duty
+        bt_scan_follow_state((vacuum_state_t)live.state);
+    }
     
-    // Start tasks
-    xTaskCreate(vacuum_state_machine_task, "vacuum_sm", 4096, NULL, 5, NULL);
-    xTaskCreate(print_status_task, "status", 2048, NULL, 3, NULL);
+    // Everything from here on runs on the reactor, or on the console task
+    // if it may block
+    if (console_queue == NULL) {
+        ESP_LOGE(TAG, "No console queue - console commands, button pairing and saving automatic mode are off");
+    } else if (STATIC_TASK_CREATE(console, console_task, "console", CONSOLE_STACK, NULL,
+                                  CONSOLE_PRIORITY, NULL, tskNO_AFFINITY) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create console task");
+    } else {
+        metrics_note_task("console", CONSOLE_STACK);
+    }
+    reactor_arm(&status_timer, esp_timer_get_time());
+    if (reactor_start(REACTOR_TASK_PRIORITY) != ESP_OK) {
+        return;
+    }
+    boot_prof_mark(BOOT_MS_TASKS, esp_timer_get_time());
     
     ESP_LOGI(TAG, "✅ Makita Vacuum Cleaner Ready!");
-    ESP_LOGI(TAG, "📱 Automatic mode: DISABLED (press button on GPIO%d to toggle)", BUTTON_GPIO);
+    ESP_LOGI(TAG, "📛 Device name: %s", cfg->device_name);
+    ESP_LOGI(TAG, "📱 Automatic mode: %s (press button on GPIO%d to toggle)",
+             live.auto_mode ? "ENABLED" : "DISABLED", cfg->button_gpio);
     ESP_LOGI(TAG, "🔗 Waiting for Bluetooth connection...");
+#ifdef CONFIG_ADV_CAPTURE_ENABLE
+    ESP_LOGI(TAG, "📼 Send 'c' on the console to dump the advertisement capture");
+#endif
+    ESP_LOGI(TAG, "📈 Send 'm' on the console for a METRICS frame (decode with host/metrics_decode), 'b' for the boot profile");
+    ESP_LOGI(TAG, "🔐 Send 'p' (or hold the button) to pair the running tools, 'u' to clear pairings");
     
-    // Main loop - could be used for additional monitoring
-    while (1) {
-        vTaskDelay(pdMS_TO_TICKS(1000));
-    }
-}
\ No newline at end of file
+    // Returning frees the main task's stack
+}
@@ -0,0 +1,294 @@
+#include "metrics.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+
+static uint16_t crc16(const uint8_t *p, size_t len)
+{
+    uint16_t crc = 0xffff;
+
+    while (len--) {
+        crc ^= (uint16_t)*p++ << 8;
+        for (int b = 0; b < 8; b++) {
+            crc = crc & 0x8000 ? (uint16_t)(crc << 1 ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static uint8_t *put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static uint8_t *put_u32(uint8_t *p, uint32_t v)
+{
+    for (int b = 0; b < 4; b++) {
+        p[b] = (uint8_t)(v >> (8 * b));
+    }
+    return p + 4;
+}
+
+static uint16_t get_u16(const uint8_t **p)
+{
+    uint16_t v = (uint16_t)((*p)[0] | (*p)[1] << 8);
+    *p += 2;
+    return v;
+}
+
+static uint32_t get_u32(const uint8_t **p)
+{
+    const uint8_t *q = *p;
+    *p += 4;
+    return (uint32_t)q[0] | (uint32_t)q[1] << 8 | (uint32_t)q[2] << 16 | (uint32_t)q[3] << 24;
+}
+
+size_t metrics_encode(const metrics_t *m, uint8_t *buf)
+{
+    uint8_t ntasks = m->ntasks > METRICS_MAX_TASKS ? METRICS_MAX_TASKS : m->ntasks;
+    size_t len = METRICS_HDR_LEN + ntasks * METRICS_TASK_LEN + 2;
+    uint8_t *p = buf;
+
+    *p++ = METRICS_VERSION;
+    *p++ = ntasks;
+    p = put_u16(p, (uint16_t)len);
+    p = put_u32(p, m->uptime_ms);
+    p = put_u32(p, m->runtime_total);
+    p = put_u32(p, m->heap_free);
+    p = put_u32(p, m->heap_min_free);
+    p = put_u32(p, m->internal_free);
+    p = put_u32(p, m->internal_min_free);
+    p = put_u32(p, m->internal_largest);
+    p = put_u32(p, m->adverts);
+    p = put_u32(p, m->reject_length);
+    p = put_u32(p, m->reject_mfg);
+    p = put_u32(p, m->reject_decode);
+    p = put_u32(p, m->ring_drops);
+    p = put_u32(p, m->timer_calls);
+    for (int i = 0; i < ntasks; i++) {
+        const metrics_task_t *t = &m->tasks[i];
+        strncpy((char *)p, t->name, METRICS_NAME_LEN);
+        p += METRICS_NAME_LEN;
+        p = put_u32(p, t->runtime);
+        p = put_u16(p, t->stack_hwm);
+        *p++ = t->priority;
+        *p++ = 0;
+    }
+    put_u16(p, crc16(buf, len - 2));
+    return len;
+}
+
+size_t metrics_decode(const uint8_t *buf, size_t avail, metrics_t *m)
+{
+    const uint8_t *p = buf;
+
+    if (avail < METRICS_HDR_LEN + 2 || buf[0] != METRICS_VERSION || buf[1] > METRICS_MAX_TASKS) {
+        return 0;
+    }
+    size_t len = (size_t)(buf[2] | buf[3] << 8);
+    if (len != METRICS_HDR_LEN + (size_t)buf[1] * METRICS_TASK_LEN + 2 || avail < len ||
+        crc16(buf, len - 2) != (uint16_t)(buf[len - 2] | buf[len - 1] << 8)) {
+        return 0;
+    }
+
+    memset(m, 0, sizeof(*m));
+    m->ntasks = buf[1];
+    p += 4;
+    m->uptime_ms = get_u32(&p);
+    m->runtime_total = get_u32(&p);
+    m->heap_free = get_u32(&p);
+    m->heap_min_free = get_u32(&p);
+    m->internal_free = get_u32(&p);
+    m->internal_min_free = get_u32(&p);
+    m->internal_largest = get_u32(&p);
+    m->adverts = get_u32(&p);
+    m->reject_length = get_u32(&p);
+    m->reject_mfg = get_u32(&p);
+    m->reject_decode = get_u32(&p);
+    m->ring_drops = get_u32(&p);
+    m->timer_calls = get_u32(&p);
+    for (int i = 0; i < m->ntasks; i++) {
+        metrics_task_t *t = &m->tasks[i];
+        memcpy(t->name, p, METRICS_NAME_LEN);
+        p += METRICS_NAME_LEN;
+        t->runtime = get_u32(&p);
+        t->stack_hwm = get_u16(&p);
+        t->priority = p[0];
+        p += 2;
+    }
+    return len;
+}
+
+#ifdef ESP_PLATFORM
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "bt_manager.h"
+
+static const char *TAG = "METRICS";
+
+// Task stacks before the reactor: vacuum_sm, status and led_task, plus
+// app_main, which looped for good. The IDF tasks (NimBLE host, esp_timer,
+// FreeRTOS timers) ran then and now, so neither side counts them.
+#define METRICS_REPLACED_STACK  (4096 + 2048 + 2048 + CONFIG_ESP_MAIN_TASK_STACK_SIZE)
+#define METRICS_NOTED_MAX       8
+
+typedef struct {
+    const char *_Atomic name;
+    uint32_t stack_bytes;
+} noted_task_t;
+
+static noted_task_t noted[METRICS_NOTED_MAX];
+static atomic_uint noted_count;
+
+#ifndef configRUN_TIME_COUNTER_TYPE
+#define configRUN_TIME_COUNTER_TYPE uint32_t
+#endif
+
+#if configUSE_TRACE_FACILITY
+// Room for every task this firmware and the IDF start, so
+// uxTaskGetSystemState() does not give up on a full array
+#define METRICS_STATUS_SLOTS    (METRICS_MAX_TASKS + 8)
+static TaskStatus_t task_status[METRICS_STATUS_SLOTS];
+#else
+// Without the trace facility only stack marks of the tasks we size are
+// known: the noted ones and these IDF tasks
+static const char *const idf_tasks[] = {
+    "nimble_host",
+};
+#endif
+
+static metrics_t sample;
+static uint8_t frame[METRICS_MAX_LEN];
+
+static void collect_tasks(metrics_t *m)
+{
+#if configUSE_TRACE_FACILITY
+    configRUN_TIME_COUNTER_TYPE total = 0;
+    UBaseType_t n = uxTaskGetSystemState(task_status, METRICS_STATUS_SLOTS, &total);
+
+    m->runtime_total = (uint32_t)total;
+    for (UBaseType_t i = 0; i < n && m->ntasks < METRICS_MAX_TASKS; i++) {
+        metrics_task_t *t = &m->tasks[m->ntasks++];
+        strncpy(t->name, task_status[i].pcTaskName, METRICS_NAME_LEN);
+        t->runtime = (uint32_t)task_status[i].ulRunTimeCounter;
+        t->stack_hwm = task_status[i].usStackHighWaterMark > UINT16_MAX ?
+                       UINT16_MAX : (uint16_t)task_status[i].usStackHighWaterMark;
+        t->priority = (uint8_t)task_status[i].uxCurrentPriority;
+    }
+#else
+    unsigned count = noted_tasks();
+    size_t idf_count = sizeof(idf_tasks) / sizeof(idf_tasks[0]);
+    for (size_t i = 0; i < count + idf_count && m->ntasks < METRICS_MAX_TASKS; i++) {
+        const char *name = i < count ? atomic_load(&noted[i].name) : idf_tasks[i - count];
+        TaskHandle_t h = name ? xTaskGetHandle(name) : NULL;
+        if (h == NULL) {
+            continue;
+        }
+        metrics_task_t *t = &m->tasks[m->ntasks++];
+        strncpy(t->name, name, METRICS_NAME_LEN);
+        UBaseType_t hwm = uxTaskGetStackHighWaterMark(h);
+        t->stack_hwm = hwm > UINT16_MAX ? UINT16_MAX : (uint16_t)hwm;
+        t->priority = (uint8_t)uxTaskPriorityGet(h);
+    }
+#endif
+}
+
+void metrics_collect(metrics_t *m)
+{
+    bt_filter_stats_t stats;
+
+    memset(m, 0, sizeof(*m));
+    m->uptime_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    m->heap_free = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    m->heap_min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    m->internal_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    m->internal_min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+    m->internal_largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+
+    bt_manager_get_filter_stats(&stats);
+    m->adverts = stats.adverts;
+    m->reject_length = stats.reject_length;
+    m->reject_mfg = stats.reject_mfg;
+    m->reject_decode = stats.reject_decode;
+    m->ring_drops = stats.ring_drops;
+    m->timer_calls = stats.timer_calls;
+
+    collect_tasks(m);
+}
+
+// Console only: the static buffers are not shared between callers
+void metrics_dump(void)
+{
+    metrics_collect(&sample);
+    size_t len = metrics_encode(&sample, frame);
+    printf(METRICS_LINE_PREFIX);
+    for (size_t i = 0; i < len; i++) {
+        printf("%02x", frame[i]);
+    }
+    printf("\n");
+}
+
+void metrics_note_task(const char *name, uint32_t stack_bytes)
+{
+    // The BLE init task notes its tasks while app_main notes the others;
+    // readers skip a slot until its name is set
+    unsigned i = atomic_fetch_add(&noted_count, 1);
+    if (i < METRICS_NOTED_MAX) {
+        noted[i].stack_bytes = stack_bytes;
+        atomic_store(&noted[i].name, name);
+    }
+}
+
+static unsigned noted_tasks(void)
+{
+    unsigned count = atomic_load(&noted_count);
+    return count < METRICS_NOTED_MAX ? count : METRICS_NOTED_MAX;
+}
+
+void metrics_print_stacks(void)
+{
+    unsigned count = noted_tasks();
+    uint32_t total = 0, unused = 0;
+
+    for (unsigned i = 0; i < count; i++) {
+        const char *name = atomic_load(&noted[i].name);
+        TaskHandle_t h = name ? xTaskGetHandle(name) : NULL;
+        if (h == NULL) {
+            continue;   // Ended, and its stack with it
+        }
+        UBaseType_t hwm = uxTaskGetStackHighWaterMark(h);
+        ESP_LOGI(TAG, "Stack %-12s %5lu B (%u B never used)", name,
+                 noted[i].stack_bytes, (unsigned)hwm);
+        total += noted[i].stack_bytes;
+        unused += hwm;
+    }
+    ESP_LOGI(TAG, "Task stacks - %lu B (%lu B never used), %d B before the reactor: %ld B saved",
+             total, unused, METRICS_REPLACED_STACK, (long)METRICS_REPLACED_STACK - (long)total);
+}
+
+#else
+
+void metrics_collect(metrics_t *m)
+{
+    memset(m, 0, sizeof(*m));
+}
+
+void metrics_dump(void)
+{
+}
+
+void metrics_note_task(const char *name, uint32_t stack_bytes)
+{
+}
+
+void metrics_print_stacks(void)
+{
+}
+
+#endif // ESP_PLATFORM
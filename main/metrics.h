@@ -0,0 +1,118 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Runtime metrics in fixed memory: per-task CPU time and stack high-water
+// mark, heap watermarks and the advert pipeline counters. Sent 'm', the
+// console prints one "METRICS <hex>" line holding a versioned binary frame;
+// host/metrics_decode turns it into a report, with CPU shares and rates over
+// the interval since the previous frame in the same log.
+//
+// Wire format, little-endian:
+//
+//   u8  version            METRICS_VERSION
+//   u8  ntasks             0..METRICS_MAX_TASKS
+//   u16 len                Whole frame, CRC included
+//   u32 uptime_ms
+//   u32 runtime_total      FreeRTOS run-time counter (wraps)
+//   u32 heap_free, heap_min_free, internal_free, internal_min_free, internal_largest
+//   u32 adverts, reject_length, reject_mfg, reject_decode, ring_drops, timer_calls
+//   ntasks times:
+//     char name[METRICS_NAME_LEN]    NUL padded, not terminated when full
+//     u32 runtime                    Task's share of the run-time counter (wraps)
+//     u16 stack_hwm                  Least free stack seen, bytes
+//     u8  priority
+//     u8  reserved
+//   u16 crc                CRC-16/CCITT-FALSE of everything before it
+
+#define METRICS_VERSION     1
+#define METRICS_MAX_TASKS   16
+#define METRICS_NAME_LEN    12
+#define METRICS_HDR_LEN     56
+#define METRICS_TASK_LEN    (METRICS_NAME_LEN + 8)
+#define METRICS_MAX_LEN     (METRICS_HDR_LEN + METRICS_MAX_TASKS * METRICS_TASK_LEN + 2)
+#define METRICS_LINE_PREFIX "METRICS "
+
+/**
+ * @brief One task's CPU time and stack use
+ */
+typedef struct {
+    char name[METRICS_NAME_LEN + 1];
+    uint32_t runtime;
+    uint16_t stack_hwm;
+    uint8_t priority;
+} metrics_task_t;
+
+/**
+ * @brief One metrics sample
+ */
+typedef struct {
+    uint32_t uptime_ms;
+    uint32_t runtime_total;
+    uint32_t heap_free;             // 8-bit capable heap, bytes
+    uint32_t heap_min_free;         // Its low-water mark since boot
+    uint32_t internal_free;         // Internal RAM only
+    uint32_t internal_min_free;
+    uint32_t internal_largest;      // Largest free internal block
+    uint32_t adverts;               // Advert pipeline counters, see bt_filter_stats_t
+    uint32_t reject_length;
+    uint32_t reject_mfg;
+    uint32_t reject_decode;
+    uint32_t ring_drops;
+    uint32_t timer_calls;           // esp_timer start/stop calls of the BLE manager
+    uint8_t ntasks;
+    metrics_task_t tasks[METRICS_MAX_TASKS];
+} metrics_t;
+
+/**
+ * @brief Sample every metric (firmware only; zeroes m on the host)
+ *
+ * Tasks beyond METRICS_MAX_TASKS are left out. Without
+ * CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS the run times read 0.
+ *
+ * @param m Destination
+ */
+void metrics_collect(metrics_t *m);
+
+/**
+ * @brief Serialize a sample into the wire format
+ * @param m Sample
+ * @param buf Destination, at least METRICS_MAX_LEN bytes
+ * @return Number of bytes written
+ */
+size_t metrics_encode(const metrics_t *m, uint8_t *buf);
+
+/**
+ * @brief Parse a frame
+ * @param buf Source bytes
+ * @param avail Number of bytes available in buf
+ * @param m Destination
+ * @return Frame length, 0 if buf holds no valid frame (version, length or CRC)
+ */
+size_t metrics_decode(const uint8_t *buf, size_t avail, metrics_t *m);
+
+/**
+ * @brief Collect a sample and print it as one METRICS line (firmware only)
+ */
+void metrics_dump(void);
+
+/**
+ * @brief Record a task the firmware created, for the stack report (firmware only)
+ *
+ * Call once per task, after creating it. Without the trace facility these
+ * are also the tasks in the METRICS frame.
+ *
+ * @param name Task name, as given at creation
+ * @param stack_bytes Stack size, as given at creation
+ */
+void metrics_note_task(const char *name, uint32_t stack_bytes);
+
+/**
+ * @brief Log each recorded task's stack and its unused part, and their total
+ * against the stacks of the tasks the reactor replaced (firmware only)
+ */
+void metrics_print_stacks(void);
+
+#endif // METRICS_H
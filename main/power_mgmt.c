@@ -0,0 +1,143 @@
+#include "power_mgmt.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "driver/uart.h"
+
+static const char *TAG = "POWER_MGMT";
+
+#define UART_WAKEUP_EDGES 3     // RX edges that wake the console UART
+
+atomic_uint pm_wake_counts[PM_WAKE_COUNT];
+
+static const char *const wake_names[PM_WAKE_COUNT] = {
+    [PM_WAKE_CONSOLE] = "console",
+    [PM_WAKE_STATUS] = "status",
+    [PM_WAKE_SM_EVENT] = "sm",
+    [PM_WAKE_INPUT] = "input",
+    [PM_WAKE_LED] = "led",
+    [PM_WAKE_DLOG] = "dlog",
+    [PM_WAKE_POWER_TIMER] = "power timer",
+    [PM_WAKE_SCAN_TIMER] = "scan timer",
+    [PM_WAKE_ADVERT] = "advert",
+    [PM_WAKE_ADV_CONSUMER] = "adv batch",
+    [PM_WAKE_PRESTART_TIMER] = "prestart",
+};
+
+#ifdef CONFIG_VACUUM_PM_ENABLE
+static esp_pm_lock_handle_t rt_lock = NULL;
+#endif
+
+#ifdef CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+static volatile uint32_t light_sleeps = 0;
+static volatile uint32_t light_sleep_us = 0;    // Wraps; only differences are used
+
+// Runs on the idle task with interrupts disabled, right after waking
+static IRAM_ATTR esp_err_t light_sleep_exit_cb(int64_t sleep_time_us, void *arg)
+{
+    light_sleeps++;
+    light_sleep_us += (uint32_t)sleep_time_us;
+    return ESP_OK;
+}
+#endif
+
+esp_err_t power_mgmt_init(void)
+{
+#ifdef CONFIG_VACUUM_PM_ENABLE
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = CONFIG_VACUUM_PM_MIN_FREQ_MHZ,
+#ifdef CONFIG_FREERTOS_USE_TICKLESS_IDLE
+        .light_sleep_enable = true,
+#endif
+    };
+    esp_err_t ret = esp_pm_configure(&pm_config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "PM configure failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "vacuum_rt", &rt_lock);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "PM lock create failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+#ifdef CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    // The first characters typed into a sleeping console only wake it up
+    uart_set_wakeup_threshold(CONFIG_ESP_CONSOLE_UART_NUM, UART_WAKEUP_EDGES);
+    esp_sleep_enable_uart_wakeup(CONFIG_ESP_CONSOLE_UART_NUM);
+#endif
+
+#ifdef CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+    esp_pm_sleep_cbs_register_config_t cbs = { .exit_cb = light_sleep_exit_cb };
+    esp_pm_light_sleep_register_cbs(&cbs);
+#endif
+
+    ESP_LOGI(TAG, "🔋 Power management: %d-%d MHz, light sleep %s",
+             CONFIG_VACUUM_PM_MIN_FREQ_MHZ, CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+             pm_config.light_sleep_enable ? "ENABLED" : "DISABLED");
+#else
+    ESP_LOGI(TAG, "Power management disabled - CPU fixed at %d MHz", CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+#endif
+    return ESP_OK;
+}
+
+void power_mgmt_lock(void)
+{
+#ifdef CONFIG_VACUUM_PM_ENABLE
+    esp_pm_lock_acquire(rt_lock);
+#endif
+}
+
+void power_mgmt_unlock(void)
+{
+#ifdef CONFIG_VACUUM_PM_ENABLE
+    esp_pm_lock_release(rt_lock);
+#endif
+}
+
+void power_mgmt_print_status(void)
+{
+    static uint32_t last_counts[PM_WAKE_COUNT];
+    static int64_t last_status_us = 0;
+
+    int64_t now = esp_timer_get_time();
+    int64_t elapsed_us = now - last_status_us;
+    uint32_t total = 0;
+
+    ESP_LOGI(TAG, "⏰ Wakeups since last report (per 10 s):");
+    for (int i = 0; i < PM_WAKE_COUNT; i++) {
+        uint32_t count = atomic_load_explicit(&pm_wake_counts[i], memory_order_relaxed);
+        uint32_t delta = count - last_counts[i];
+        last_counts[i] = count;
+        total += delta;
+        if (delta) {
+            ESP_LOGI(TAG, "   %-12s %6lu (%lu)", wake_names[i], delta,
+                     elapsed_us > 0 ? (uint32_t)((uint64_t)delta * 10000000 / elapsed_us) : 0);
+        }
+    }
+    ESP_LOGI(TAG, "   %-12s %6lu", "total", total);
+
+#ifdef CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+    static uint32_t last_sleeps = 0;
+    static uint32_t last_sleep_us = 0;
+
+    uint32_t sleeps = light_sleeps;
+    uint32_t slept_us = light_sleep_us;
+    uint32_t asleep_permille = elapsed_us > 0 ?
+        (uint32_t)((uint64_t)(slept_us - last_sleep_us) * 1000 / elapsed_us) : 0;
+    // Average current from light sleep residency and the configured per-mode draw
+    uint32_t avg_ua = (asleep_permille * CONFIG_VACUUM_PM_SLEEP_CURRENT_UA +
+                       (1000 - asleep_permille) * CONFIG_VACUUM_PM_AWAKE_CURRENT_UA) / 1000;
+    ESP_LOGI(TAG, "   Light sleep: %lu entries, %lu.%lu%% of the time, est. %lu.%02lu mA",
+             sleeps - last_sleeps, asleep_permille / 10, asleep_permille % 10,
+             avg_ua / 1000, avg_ua % 1000 / 10);
+    last_sleeps = sleeps;
+    last_sleep_us = slept_us;
+#endif
+
+    last_status_us = now;
+}
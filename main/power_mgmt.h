@@ -0,0 +1,58 @@
+#ifndef POWER_MGMT_H
+#define POWER_MGMT_H
+
+#include <stdatomic.h>
+#include "esp_err.h"
+
+/**
+ * @brief Reasons the CPU leaves idle, counted to find avoidable wakeups
+ */
+typedef enum {
+    PM_WAKE_CONSOLE,        // Console command or UART input
+    PM_WAKE_STATUS,         // Status report
+    PM_WAKE_SM_EVENT,       // State machine event
+    PM_WAKE_INPUT,          // Input interrupt or sampling
+    PM_WAKE_LED,            // LED pattern change, fade turn or one-shot end
+    PM_WAKE_DLOG,           // Deferred log drain
+    PM_WAKE_POWER_TIMER,    // Tool power-off deadline
+    PM_WAKE_SCAN_TIMER,     // Scan burst / tool lost deadline
+    PM_WAKE_ADVERT,         // NimBLE host advertising report
+    PM_WAKE_ADV_CONSUMER,   // Advert consumer batch
+    PM_WAKE_PRESTART_TIMER, // Pre-start window end
+    PM_WAKE_COUNT
+} pm_wake_src_t;
+
+extern atomic_uint pm_wake_counts[PM_WAKE_COUNT];
+
+/**
+ * @brief Count one wakeup (task or ISR context)
+ */
+static inline void pm_note_wake(pm_wake_src_t src)
+{
+    atomic_fetch_add_explicit(&pm_wake_counts[src], 1, memory_order_relaxed);
+}
+
+/**
+ * @brief Configure dynamic frequency scaling and automatic light sleep
+ * @return ESP_OK on success (also when power management is disabled)
+ */
+esp_err_t power_mgmt_init(void);
+
+/**
+ * @brief Hold the maximum CPU frequency and keep the chip awake
+ *
+ * For latency-critical work such as switching the relay. Calls nest.
+ */
+void power_mgmt_lock(void);
+
+/**
+ * @brief Release power_mgmt_lock()
+ */
+void power_mgmt_unlock(void);
+
+/**
+ * @brief Log wakeups per source, light sleep residency and estimated current
+ */
+void power_mgmt_print_status(void);
+
+#endif // POWER_MGMT_H
@@ -0,0 +1,49 @@
+#include "prestart.h"
+#include <string.h>
+
+void prestart_init(prestart_t *p)
+{
+    memset(p, 0, sizeof(*p));
+}
+
+bool prestart_is_cue(bool was_active, bool payload_changed, int8_t prev_rssi, int8_t rssi,
+                     int rssi_jump_db)
+{
+    // A tool that has just stopped is not about to start
+    if (was_active) {
+        return false;
+    }
+    return payload_changed || rssi - prev_rssi >= rssi_jump_db;
+}
+
+bool prestart_cue(prestart_t *p, int64_t now_us, int64_t window_us)
+{
+    p->cues++;
+    p->armed_until_us = now_us + window_us;
+    if (p->armed_at_us) {
+        return false;
+    }
+    p->armed_at_us = now_us;
+    return true;
+}
+
+bool prestart_hit(prestart_t *p, int64_t now_us)
+{
+    if (!p->armed_at_us) {
+        return false;
+    }
+    p->hits++;
+    p->lead_us += now_us - p->armed_at_us;
+    p->armed_at_us = 0;
+    return true;
+}
+
+bool prestart_expire(prestart_t *p, int64_t now_us)
+{
+    if (!p->armed_at_us || now_us < p->armed_until_us) {
+        return false;
+    }
+    p->misses++;
+    p->armed_at_us = 0;
+    return true;
+}
@@ -0,0 +1,76 @@
+#ifndef PRESTART_H
+#define PRESTART_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef CONFIG_VACUUM_PRESTART_WINDOW_MS
+#define CONFIG_VACUUM_PRESTART_WINDOW_MS 3000
+#endif
+#ifndef CONFIG_VACUUM_PRESTART_RSSI_JUMP_DB
+#define CONFIG_VACUUM_PRESTART_RSSI_JUMP_DB 10
+#endif
+
+#define PRESTART_WINDOW_US ((int64_t)CONFIG_VACUUM_PRESTART_WINDOW_MS * 1000)
+
+/**
+ * @brief Speculative pre-start: a cue from an idle tool arms a window in
+ * which its active advert is expected
+ */
+typedef struct {
+    int64_t armed_at_us;        // Cue that opened the window, 0 if not armed
+    int64_t armed_until_us;     // Window end, extended by further cues
+    uint32_t cues;              // Cues seen (including ones that only extended a window)
+    uint32_t hits;              // Windows closed by an active advert
+    uint32_t misses;            // Windows that ran out
+    int64_t lead_us;            // Sum over hits of cue-to-active time
+} prestart_t;
+
+/**
+ * @brief Reset the predictor
+ * @param p Predictor
+ */
+void prestart_init(prestart_t *p);
+
+/**
+ * @brief Whether an idle advert from a tool that may drive the vacuum hints at imminent use
+ *
+ * Cues are a changed idle payload (battery inserted, tool woken) and a
+ * sudden RSSI rise (tool picked up and brought closer).
+ *
+ * @param was_active The tool's previous advert reported running
+ * @param payload_changed The payload differs from the tool's previous advert
+ * @param prev_rssi RSSI of the previous advert
+ * @param rssi RSSI of this advert
+ * @param rssi_jump_db RSSI rise that counts as a cue
+ * @return true for a cue
+ */
+bool prestart_is_cue(bool was_active, bool payload_changed, int8_t prev_rssi, int8_t rssi,
+                     int rssi_jump_db);
+
+/**
+ * @brief Record a cue
+ * @param p Predictor
+ * @param now_us Cue time
+ * @param window_us How long to wait for the active advert
+ * @return true if this opened a new window, false if it extended one
+ */
+bool prestart_cue(prestart_t *p, int64_t now_us, int64_t window_us);
+
+/**
+ * @brief Record an active advert (tool power on)
+ * @param p Predictor
+ * @param now_us Advert time
+ * @return true if a window was open (hit)
+ */
+bool prestart_hit(prestart_t *p, int64_t now_us);
+
+/**
+ * @brief Close the window if it has run out
+ * @param p Predictor
+ * @param now_us Current time
+ * @return true if the window ran out now (miss)
+ */
+bool prestart_expire(prestart_t *p, int64_t now_us);
+
+#endif // PRESTART_H
@@ -0,0 +1,55 @@
+#include "proximity.h"
+#include <string.h>
+
+// Variance ceiling: after a long silence the next advert replaces the
+// estimate, and the Q16 gain arithmetic below cannot overflow
+#define PROXIMITY_VAR_MAX_Q8    ((uint32_t)10000 << PROXIMITY_Q)
+
+// With exit at or above enter the gate flips on almost every advert
+_Static_assert(CONFIG_VACUUM_PROXIMITY_EXIT_DBM < CONFIG_VACUUM_PROXIMITY_ENTER_DBM,
+               "VACUUM_PROXIMITY_EXIT_DBM must be below VACUUM_PROXIMITY_ENTER_DBM");
+
+void proximity_cfg_default(proximity_cfg_t *cfg)
+{
+    cfg->enter_dbm = CONFIG_VACUUM_PROXIMITY_ENTER_DBM;
+    cfg->exit_dbm = CONFIG_VACUUM_PROXIMITY_EXIT_DBM;
+    cfg->noise_q8 = (uint32_t)CONFIG_VACUUM_PROXIMITY_NOISE_DB2 << PROXIMITY_Q;
+    cfg->drift_q8 = (uint32_t)CONFIG_VACUUM_PROXIMITY_DRIFT_DB2_S << PROXIMITY_Q;
+}
+
+void proximity_reset(proximity_t *p)
+{
+    memset(p, 0, sizeof(*p));
+}
+
+bool proximity_update(proximity_t *p, const proximity_cfg_t *cfg, int8_t rssi, int64_t now_us)
+{
+    int32_t z_q8 = (int32_t)rssi * PROXIMITY_ONE;
+
+    if (p->var_q8 == 0) {
+        p->rssi_q8 = z_q8;
+        p->var_q8 = cfg->noise_q8 ? cfg->noise_q8 : 1;
+    } else {
+        // Predict: the tool may have moved since the last advert
+        uint64_t dt_ms = now_us > p->updated_us ? (uint64_t)(now_us - p->updated_us) / 1000 : 0;
+        uint64_t var = p->var_q8 + (uint64_t)cfg->drift_q8 * dt_ms / 1000;
+        if (var > PROXIMITY_VAR_MAX_Q8) {
+            var = PROXIMITY_VAR_MAX_Q8;
+        }
+
+        // Correct: gain var / (var + noise) in Q16
+        uint32_t gain_q16 = (uint32_t)((var << 16) / (var + cfg->noise_q8));
+        p->rssi_q8 += (int32_t)(((int64_t)(z_q8 - p->rssi_q8) * gain_q16) >> 16);
+        var = (var * (65536 - gain_q16)) >> 16;
+        p->var_q8 = var ? (uint32_t)var : 1;
+    }
+    p->updated_us = now_us;
+
+    // Hysteresis: a tool on the edge of the radius does not flap in and out
+    if (!p->near && p->rssi_q8 >= (int32_t)cfg->enter_dbm * PROXIMITY_ONE) {
+        p->near = true;
+    } else if (p->near && p->rssi_q8 < (int32_t)cfg->exit_dbm * PROXIMITY_ONE) {
+        p->near = false;
+    }
+    return p->near;
+}
@@ -0,0 +1,79 @@
+#ifndef PROXIMITY_H
+#define PROXIMITY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef CONFIG_VACUUM_PROXIMITY_ENTER_DBM
+#define CONFIG_VACUUM_PROXIMITY_ENTER_DBM -70
+#endif
+#ifndef CONFIG_VACUUM_PROXIMITY_EXIT_DBM
+#define CONFIG_VACUUM_PROXIMITY_EXIT_DBM -78
+#endif
+#ifndef CONFIG_VACUUM_PROXIMITY_NOISE_DB2
+#define CONFIG_VACUUM_PROXIMITY_NOISE_DB2 25
+#endif
+#ifndef CONFIG_VACUUM_PROXIMITY_DRIFT_DB2_S
+#define CONFIG_VACUUM_PROXIMITY_DRIFT_DB2_S 4
+#endif
+
+#define PROXIMITY_Q                 8       // Fractional bits of RSSI and variance
+#define PROXIMITY_ONE               (1 << PROXIMITY_Q)
+
+/**
+ * @brief Working-radius gate parameters
+ */
+typedef struct {
+    int8_t enter_dbm;           // Filtered RSSI at or above this is inside the radius
+    int8_t exit_dbm;            // ... and stays inside until it drops below this
+    uint32_t noise_q8;          // Measurement noise variance, dB^2 (Q8)
+    uint32_t drift_q8;          // RSSI drift variance per second, dB^2/s (Q8)
+} proximity_cfg_t;
+
+/**
+ * @brief Per-tool RSSI estimate and gate state
+ *
+ * A one-dimensional Kalman filter in fixed point: the estimate's variance
+ * grows with the time since the last advert (the tool may have moved) and
+ * shrinks with every advert. A new tool or one silent for a while follows
+ * its first adverts almost directly; a tool advertising steadily settles to
+ * an average over several adverts. Integer arithmetic only.
+ */
+typedef struct {
+    int32_t rssi_q8;            // Estimated RSSI, dBm (Q8)
+    uint32_t var_q8;            // Its variance, dB^2 (Q8); 0 before the first advert
+    int64_t updated_us;
+    bool near;                  // Inside the working radius
+} proximity_t;
+
+/**
+ * @brief Gate parameters from the CONFIG_VACUUM_PROXIMITY_* options
+ * @param cfg Destination
+ */
+void proximity_cfg_default(proximity_cfg_t *cfg);
+
+/**
+ * @brief Forget the estimate
+ * @param p Estimate
+ */
+void proximity_reset(proximity_t *p);
+
+/**
+ * @brief Fold one advert's RSSI into the estimate and re-evaluate the gate
+ * @param p Estimate
+ * @param cfg Gate parameters
+ * @param rssi Advert RSSI, dBm
+ * @param now_us Advert time
+ * @return Whether the tool is inside the working radius
+ */
+bool proximity_update(proximity_t *p, const proximity_cfg_t *cfg, int8_t rssi, int64_t now_us);
+
+/**
+ * @brief Estimated RSSI rounded to whole dBm
+ */
+static inline int proximity_rssi(const proximity_t *p)
+{
+    return (p->rssi_q8 + PROXIMITY_ONE / 2) >> PROXIMITY_Q;
+}
+
+#endif // PROXIMITY_H
@@ -0,0 +1,362 @@
+#include "reactor.h"
+#include <stddef.h>
+#include <string.h>
+#include "esp_attr.h"
+
+void reactor_init(reactor_t *r)
+{
+    memset(r, 0, sizeof(*r));
+}
+
+static void heap_place(reactor_t *r, reactor_timer_t *t, uint16_t slot)
+{
+    r->heap[slot] = t;
+    t->slot = (int16_t)slot;
+}
+
+static void sift_up(reactor_t *r, uint16_t slot)
+{
+    reactor_timer_t *t = r->heap[slot];
+    while (slot > 0) {
+        uint16_t parent = (slot - 1) / 2;
+        if (r->heap[parent]->deadline_us <= t->deadline_us) {
+            break;
+        }
+        heap_place(r, r->heap[parent], slot);
+        slot = parent;
+    }
+    heap_place(r, t, slot);
+}
+
+static void sift_down(reactor_t *r, uint16_t slot)
+{
+    reactor_timer_t *t = r->heap[slot];
+    for (;;) {
+        uint16_t child = 2 * slot + 1;
+        if (child >= r->count) {
+            break;
+        }
+        if (child + 1 < r->count && r->heap[child + 1]->deadline_us < r->heap[child]->deadline_us) {
+            child++;
+        }
+        if (t->deadline_us <= r->heap[child]->deadline_us) {
+            break;
+        }
+        heap_place(r, r->heap[child], slot);
+        slot = child;
+    }
+    heap_place(r, t, slot);
+}
+
+// Fill the hole with the last entry and restore the order around it
+static void heap_remove(reactor_t *r, reactor_timer_t *t)
+{
+    uint16_t slot = (uint16_t)t->slot;
+    reactor_timer_t *last = r->heap[--r->count];
+
+    t->slot = -1;
+    if (last == t) {
+        return;
+    }
+    heap_place(r, last, slot);
+    if (slot > 0 && r->heap[(slot - 1) / 2]->deadline_us > last->deadline_us) {
+        sift_up(r, slot);
+    } else {
+        sift_down(r, slot);
+    }
+}
+
+bool reactor_timer_arm(reactor_t *r, reactor_timer_t *t, int64_t deadline_us)
+{
+    if (reactor_timer_armed(t)) {
+        heap_remove(r, t);
+    } else if (r->count >= REACTOR_TIMERS_MAX) {
+        return false;
+    }
+    t->deadline_us = deadline_us;
+    r->heap[r->count] = t;
+    sift_up(r, r->count++);
+    if (r->count > r->stats.heap_max) {
+        r->stats.heap_max = r->count;
+    }
+    return true;
+}
+
+void reactor_timer_cancel(reactor_t *r, reactor_timer_t *t)
+{
+    if (reactor_timer_armed(t)) {
+        heap_remove(r, t);
+    }
+}
+
+int64_t reactor_next_deadline(const reactor_t *r)
+{
+    return r->count ? r->heap[0]->deadline_us : INT64_MAX;
+}
+
+bool reactor_run_timer(reactor_t *r, int64_t now_us)
+{
+    reactor_timer_t *t = NULL;
+
+    if (r->count && r->heap[0]->deadline_us <= now_us) {
+        t = r->heap[0];
+        if (now_us - t->deadline_us > r->stats.late_max_us) {
+            r->stats.late_max_us = now_us - t->deadline_us;
+        }
+    } else {
+        // Nothing due: take one that may run early rather than wake up again for it
+        for (uint16_t i = 0; i < r->count; i++) {
+            if (r->heap[i]->deadline_us - r->heap[i]->slack_us <= now_us) {
+                t = r->heap[i];
+                r->stats.coalesced++;
+                break;
+            }
+        }
+    }
+    if (t == NULL) {
+        return false;
+    }
+
+    heap_remove(r, t);
+    r->stats.timers++;
+    t->cb(t, now_us);
+    return true;
+}
+
+void reactor_dispatch(reactor_t *r, const reactor_msg_t *msg)
+{
+    r->stats.messages++;
+    msg->fn(msg->ctx, msg->arg, msg->timestamp_us);
+}
+
+bool reactor_latch_add(reactor_t *r, reactor_latch_t *l)
+{
+    if (r->latch_count >= REACTOR_LATCHES_MAX) {
+        return false;
+    }
+    r->latches[r->latch_count++] = l;
+    return true;
+}
+
+bool IRAM_ATTR reactor_latch_set(reactor_t *r, reactor_latch_t *l, uint32_t bits)
+{
+    uint32_t pending = atomic_fetch_or(&l->bits, bits);
+    atomic_store(&r->latched, true);
+    return pending == 0;
+}
+
+void reactor_run_latches(reactor_t *r, int64_t now_us)
+{
+    // Cleared first: a post racing with the loop below sets it again
+    if (!atomic_exchange(&r->latched, false)) {
+        return;
+    }
+    for (uint8_t i = 0; i < r->latch_count; i++) {
+        reactor_latch_t *l = r->latches[i];
+        uint32_t bits = atomic_exchange(&l->bits, 0);
+        if (bits) {
+            r->stats.latch_runs++;
+            l->fn(l->ctx, bits, now_us);
+        }
+    }
+}
+
+#ifdef ESP_PLATFORM
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include "static_alloc.h"
+#include "metrics.h"
+
+static const char *TAG = "REACTOR";
+
+// Sized for the deepest callback: a state machine event that logs, or a
+// status report section
+#define REACTOR_STACK           4096
+
+static reactor_t reactor;
+static QueueHandle_t queue = NULL;
+STATIC_TASK_STORAGE(reactor, REACTOR_STACK)
+STATIC_QUEUE_STORAGE(reactor, REACTOR_QUEUE_LEN, sizeof(reactor_msg_t))
+
+// Rounded up, so waking on a tick never finds the timer still pending
+static TickType_t ticks_until(int64_t deadline_us)
+{
+    if (deadline_us == INT64_MAX) {
+        return portMAX_DELAY;
+    }
+    int64_t left_us = deadline_us - esp_timer_get_time();
+    if (left_us <= 0) {
+        return 0;
+    }
+    int64_t tick_us = (int64_t)portTICK_PERIOD_MS * 1000;
+    int64_t ticks = (left_us + tick_us - 1) / tick_us;
+    return ticks < portMAX_DELAY ? (TickType_t)ticks : portMAX_DELAY - 1;
+}
+
+// Latches are picked up after every drain, so one whose wake-up post found
+// the queue full still runs once the messages ahead of it are done
+static void drain_queue(void)
+{
+    reactor_msg_t msg;
+    while (xQueueReceive(queue, &msg, 0) == pdTRUE) {
+        reactor_dispatch(&reactor, &msg);
+    }
+    reactor_run_latches(&reactor, esp_timer_get_time());
+}
+
+// Only wakes the reactor; drain_queue() runs the latch
+static void latch_wake(void *ctx, uint32_t arg, int64_t timestamp_us)
+{
+}
+
+static void reactor_task(void *arg)
+{
+    reactor_msg_t msg;
+
+    for (;;) {
+        BaseType_t got = xQueueReceive(queue, &msg, ticks_until(reactor_next_deadline(&reactor)));
+        reactor.stats.wakeups++;
+        if (got == pdTRUE) {
+            UBaseType_t waiting = uxQueueMessagesWaiting(queue) + 1;
+            if (waiting > reactor.stats.queue_max) {
+                reactor.stats.queue_max = (uint16_t)waiting;
+            }
+            reactor_dispatch(&reactor, &msg);
+            drain_queue();
+        }
+
+        // Messages posted by a callback, or during one, go before the next timer
+        while (reactor_run_timer(&reactor, esp_timer_get_time())) {
+            drain_queue();
+        }
+    }
+}
+
+esp_err_t reactor_create(void)
+{
+    reactor_init(&reactor);
+    queue = STATIC_QUEUE_CREATE(reactor, REACTOR_QUEUE_LEN, sizeof(reactor_msg_t));
+    if (queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create reactor queue");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t reactor_start(uint32_t priority)
+{
+    if (STATIC_TASK_CREATE(reactor, reactor_task, "reactor", REACTOR_STACK, NULL, priority,
+                           NULL, tskNO_AFFINITY) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create reactor task");
+        return ESP_ERR_NO_MEM;
+    }
+    metrics_note_task("reactor", REACTOR_STACK);
+    return ESP_OK;
+}
+
+bool reactor_post(reactor_fn_t fn, void *ctx, uint32_t arg, int64_t timestamp_us)
+{
+    reactor_msg_t msg = { .fn = fn, .ctx = ctx, .arg = arg, .timestamp_us = timestamp_us };
+
+    if (queue == NULL || xQueueSend(queue, &msg, 0) != pdTRUE) {
+        reactor.stats.dropped++;
+        return false;
+    }
+    return true;
+}
+
+bool IRAM_ATTR reactor_post_from_isr(reactor_fn_t fn, void *ctx, uint32_t arg, int64_t timestamp_us)
+{
+    reactor_msg_t msg = { .fn = fn, .ctx = ctx, .arg = arg, .timestamp_us = timestamp_us };
+    BaseType_t woken = pdFALSE;
+
+    if (queue == NULL || xQueueSendFromISR(queue, &msg, &woken) != pdTRUE) {
+        reactor.stats.dropped++;
+        return false;
+    }
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+    return true;
+}
+
+bool reactor_register_latch(reactor_latch_t *l)
+{
+    if (!reactor_latch_add(&reactor, l)) {
+        ESP_LOGE(TAG, "Too many latches (%d)", REACTOR_LATCHES_MAX);
+        return false;
+    }
+    return true;
+}
+
+void reactor_latch(reactor_latch_t *l, uint32_t bits)
+{
+    // A failed post means the queue is full, and so the reactor is awake anyway
+    if (reactor_latch_set(&reactor, l, bits)) {
+        reactor_post(latch_wake, NULL, 0, 0);
+    }
+}
+
+void IRAM_ATTR reactor_latch_from_isr(reactor_latch_t *l, uint32_t bits)
+{
+    if (reactor_latch_set(&reactor, l, bits)) {
+        reactor_post_from_isr(latch_wake, NULL, 0, 0);
+    }
+}
+
+bool reactor_arm(reactor_timer_t *t, int64_t deadline_us)
+{
+    if (!reactor_timer_arm(&reactor, t, deadline_us)) {
+        ESP_LOGE(TAG, "Timer heap full (%d timers)", REACTOR_TIMERS_MAX);
+        return false;
+    }
+    return true;
+}
+
+void reactor_cancel(reactor_timer_t *t)
+{
+    reactor_timer_cancel(&reactor, t);
+}
+
+void reactor_print_status(void)
+{
+    static reactor_stats_t last;
+    static int64_t last_us;
+    reactor_stats_t now = reactor.stats;
+    int64_t now_us = esp_timer_get_time();
+    int64_t span_ms = last_us ? (now_us - last_us) / 1000 : now_us / 1000;
+
+    if (span_ms <= 0) {
+        span_ms = 1;
+    }
+    uint32_t centi_per_s = (uint32_t)((uint64_t)(now.wakeups - last.wakeups) * 100000 / span_ms);
+
+    ESP_LOGI(TAG, "Reactor - %lu.%02lu wakeups/s, %lu msgs, %lu timers (%lu coalesced), %lu latches, "
+             "dropped: %lu, queue max %u/%d, heap max %u/%d, late max %lld us",
+             centi_per_s / 100, centi_per_s % 100,
+             now.messages - last.messages, now.timers - last.timers, now.coalesced - last.coalesced,
+             now.latch_runs - last.latch_runs, now.dropped, now.queue_max, REACTOR_QUEUE_LEN, now.heap_max, REACTOR_TIMERS_MAX,
+             (long long)now.late_max_us);
+    last = now;
+    last_us = now_us;
+}
+
+#else
+
+esp_err_t reactor_create(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t reactor_start(uint32_t priority)
+{
+    return ESP_OK;
+}
+
+#endif // ESP_PLATFORM
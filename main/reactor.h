@@ -0,0 +1,241 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "esp_err.h"
+
+// Single-task event loop for the firmware's housekeeping: state machine
+// events, LED pattern changes, button sampling and the periodic status
+// report all run as short callbacks on one task instead of one mostly idle
+// task each. Callbacks must not block. Work arrives two ways:
+//
+//   messages  posted from any task or ISR into one queue (reactor_post)
+//   timers    armed on the reactor task in a deadline min-heap
+//
+// The task blocks on the queue with a timeout that ends at the earliest
+// deadline, so it only wakes when there is something to do. Queued messages
+// are always served before due timers and between timer callbacks, which
+// keeps a state machine event from waiting behind a long timer chain.
+//
+// A message posted to a full queue is lost. Work that must not be lost goes
+// through a latch instead (reactor_latch), which takes at most one queue slot
+// and is picked up after the queue drains even when that post fails.
+//
+// The heap and dispatch core below is portable; the task, queue and the
+// reactor_* calls without a reactor_t argument exist on the firmware only.
+
+#define REACTOR_TIMERS_MAX      16      // Timers armed at once
+#define REACTOR_QUEUE_LEN       24      // Messages waiting at once
+#define REACTOR_LATCHES_MAX     4       // Latches registered at once
+
+typedef struct reactor_timer reactor_timer_t;
+
+/**
+ * @brief Timer callback, run on the reactor task; may re-arm its timer
+ * @param timer The timer that fired (already disarmed)
+ * @param now_us Time the reactor woke up for it
+ */
+typedef void (*reactor_timer_cb_t)(reactor_timer_t *timer, int64_t now_us);
+
+/**
+ * @brief One-shot timer owned by the reactor task
+ *
+ * Slack lets a timer fire up to slack_us early when the reactor is awake for
+ * something else anyway, so unrelated periodic work shares wakeups.
+ */
+struct reactor_timer {
+    int64_t deadline_us;
+    uint32_t slack_us;
+    reactor_timer_cb_t cb;
+    void *ctx;
+    int16_t slot;               // Heap index, -1 while not armed
+};
+
+#define REACTOR_TIMER_INIT(cb_, ctx_, slack_) \
+    { .deadline_us = 0, .slack_us = (slack_), .cb = (cb_), .ctx = (ctx_), .slot = -1 }
+
+/**
+ * @brief Message callback, run on the reactor task
+ * @param ctx, arg, timestamp_us As posted
+ */
+typedef void (*reactor_fn_t)(void *ctx, uint32_t arg, int64_t timestamp_us);
+
+/**
+ * @brief Work item passed through the queue
+ */
+typedef struct {
+    reactor_fn_t fn;
+    void *ctx;
+    uint32_t arg;
+    int64_t timestamp_us;       // Usually when the trigger happened
+} reactor_msg_t;
+
+/**
+ * @brief Work that survives a full queue
+ *
+ * Posting a latch ORs bits into it. The reactor runs its callback once with
+ * every bit posted since the last run as arg and the time it picked the
+ * latch up as timestamp_us, so callers that need the trigger time keep it
+ * themselves.
+ */
+typedef struct {
+    reactor_fn_t fn;
+    void *ctx;
+    atomic_uint bits;           // Posted since the last run
+} reactor_latch_t;
+
+#define REACTOR_LATCH_INIT(fn_, ctx_) { .fn = (fn_), .ctx = (ctx_), .bits = 0 }
+
+/**
+ * @brief Built-in counters
+ */
+typedef struct {
+    uint32_t wakeups;           // Times the task woke up (context switches in)
+    uint32_t messages;          // Messages dispatched
+    uint32_t timers;            // Timer callbacks run
+    uint32_t coalesced;         // ... of which ran early inside their slack
+    uint32_t dropped;           // Posts lost to a full queue
+    uint32_t latch_runs;        // Latch callbacks run
+    uint16_t queue_max;         // Most messages seen waiting at one wakeup
+    uint16_t heap_max;          // Most timers armed at once
+    int64_t late_max_us;        // Worst timer lateness
+} reactor_stats_t;
+
+/**
+ * @brief Deadline heap and counters
+ */
+typedef struct {
+    reactor_timer_t *heap[REACTOR_TIMERS_MAX];
+    uint16_t count;
+    reactor_latch_t *latches[REACTOR_LATCHES_MAX];
+    uint8_t latch_count;
+    atomic_bool latched;        // Some latch has bits posted
+    reactor_stats_t stats;
+} reactor_t;
+
+/**
+ * @brief Reset a reactor with no timers armed
+ */
+void reactor_init(reactor_t *r);
+
+/**
+ * @brief Arm or re-arm a timer
+ * @param r Reactor
+ * @param t Timer; moved if already armed
+ * @param deadline_us Absolute time it is due
+ * @return false if REACTOR_TIMERS_MAX timers are already armed
+ */
+bool reactor_timer_arm(reactor_t *r, reactor_timer_t *t, int64_t deadline_us);
+
+/**
+ * @brief Disarm a timer; harmless if it is not armed
+ */
+void reactor_timer_cancel(reactor_t *r, reactor_timer_t *t);
+
+/**
+ * @brief Whether a timer is armed
+ */
+static inline bool reactor_timer_armed(const reactor_timer_t *t)
+{
+    return t->slot >= 0;
+}
+
+/**
+ * @brief Time the reactor has to wake up by
+ * @return Earliest deadline, INT64_MAX with no timer armed
+ */
+int64_t reactor_next_deadline(const reactor_t *r);
+
+/**
+ * @brief Run the earliest timer that is due at now_us, or inside its slack
+ * @return true if one ran; call again until false
+ */
+bool reactor_run_timer(reactor_t *r, int64_t now_us);
+
+/**
+ * @brief Run a message's callback and count it
+ */
+void reactor_dispatch(reactor_t *r, const reactor_msg_t *msg);
+
+/**
+ * @brief Register a latch; before the reactor runs
+ * @return false if REACTOR_LATCHES_MAX latches are already registered
+ */
+bool reactor_latch_add(reactor_t *r, reactor_latch_t *l);
+
+/**
+ * @brief Post bits to a registered latch; safe from any task or ISR
+ * @return true if the latch had nothing pending, so the reactor must be woken
+ */
+bool reactor_latch_set(reactor_t *r, reactor_latch_t *l, uint32_t bits);
+
+/**
+ * @brief Run the callbacks of latches with bits posted
+ * @param r Reactor
+ * @param now_us Passed to the callbacks
+ */
+void reactor_run_latches(reactor_t *r, int64_t now_us);
+
+/**
+ * @brief Create the queue (firmware only)
+ *
+ * Messages posted before this are lost, messages posted after it wait for
+ * reactor_start(), so it comes before anything that posts.
+ *
+ * @return ESP_OK on success
+ */
+esp_err_t reactor_create(void);
+
+/**
+ * @brief Create the reactor task once everything it calls into is set up
+ * @param priority Task priority
+ * @return ESP_OK on success
+ */
+esp_err_t reactor_start(uint32_t priority);
+
+/**
+ * @brief Queue a callback for the reactor task; never blocks
+ * @return false if the queue is full or not created yet
+ */
+bool reactor_post(reactor_fn_t fn, void *ctx, uint32_t arg, int64_t timestamp_us);
+
+/**
+ * @brief reactor_post() for ISRs; yields to the reactor if it is higher priority
+ */
+bool reactor_post_from_isr(reactor_fn_t fn, void *ctx, uint32_t arg, int64_t timestamp_us);
+
+/**
+ * @brief Register a latch with the firmware reactor, between reactor_create() and reactor_start()
+ * @return false if too many latches are registered
+ */
+bool reactor_register_latch(reactor_latch_t *l);
+
+/**
+ * @brief Post bits to a latch of the firmware reactor; never blocks, never lost
+ */
+void reactor_latch(reactor_latch_t *l, uint32_t bits);
+
+/**
+ * @brief reactor_latch() for ISRs
+ */
+void reactor_latch_from_isr(reactor_latch_t *l, uint32_t bits);
+
+/**
+ * @brief Arm a timer on the firmware reactor (reactor task, or before reactor_start())
+ * @return false if the heap is full
+ */
+bool reactor_arm(reactor_timer_t *t, int64_t deadline_us);
+
+/**
+ * @brief Disarm a timer on the firmware reactor (reactor task, or before reactor_start())
+ */
+void reactor_cancel(reactor_timer_t *t);
+
+/**
+ * @brief Log wakeups and work per second since the last call, and stack use
+ */
+void reactor_print_status(void);
+
+#endif // REACTOR_H
@@ -0,0 +1,64 @@
+#include "scan_policy.h"
+
+// Interval/window in 0.625 ms units
+static const scan_params_t profile_params[SCAN_PROFILE_COUNT] = {
+    [SCAN_PROFILE_IDLE]    = { .itvl = 0xA0, .window = 0x10, .passive = 1 },  // 100 ms / 10 ms (10%)
+    [SCAN_PROFILE_STANDBY] = { .itvl = 0x30, .window = 0x20, .passive = 1 },  // 30 ms / 20 ms (67%)
+    [SCAN_PROFILE_BURST]   = { .itvl = 0x20, .window = 0x20, .passive = 1 },  // 20 ms / 20 ms (100%)
+    [SCAN_PROFILE_TRACK]   = { .itvl = 0x20, .window = 0x20, .passive = 1 },  // 20 ms / 20 ms (100%)
+};
+
+static const char *const profile_names[SCAN_PROFILE_COUNT] = {
+    [SCAN_PROFILE_IDLE] = "IDLE",
+    [SCAN_PROFILE_STANDBY] = "STANDBY",
+    [SCAN_PROFILE_BURST] = "BURST",
+    [SCAN_PROFILE_TRACK] = "TRACK",
+};
+
+void scan_policy_init(scan_policy_t *p)
+{
+    *p = (scan_policy_t){
+        .state = VACUUM_STATE_IDLE,
+        .profile = SCAN_PROFILE_IDLE,
+    };
+}
+
+void scan_policy_set_state(scan_policy_t *p, vacuum_state_t state, int64_t now_us)
+{
+    if (p->state == VACUUM_STATE_IDLE && state != VACUUM_STATE_IDLE) {
+        p->burst_until_us = now_us + SCAN_BURST_US;
+    } else if (state == VACUUM_STATE_IDLE) {
+        p->burst_until_us = 0;
+    }
+    p->state = state;
+}
+
+scan_profile_t scan_policy_select(const scan_policy_t *p, int64_t now_us)
+{
+    switch (p->state) {
+        case VACUUM_STATE_ACTIVE:
+            return SCAN_PROFILE_TRACK;
+        case VACUUM_STATE_STANDBY:
+            return now_us < p->burst_until_us ? SCAN_PROFILE_BURST : SCAN_PROFILE_STANDBY;
+        default:
+            return SCAN_PROFILE_IDLE;
+    }
+}
+
+int64_t scan_policy_next_deadline(const scan_policy_t *p, int64_t now_us)
+{
+    if (p->state == VACUUM_STATE_STANDBY && now_us < p->burst_until_us) {
+        return p->burst_until_us;
+    }
+    return INT64_MAX;
+}
+
+const scan_params_t *scan_profile_params(scan_profile_t profile)
+{
+    return &profile_params[profile < SCAN_PROFILE_COUNT ? profile : SCAN_PROFILE_IDLE];
+}
+
+const char *scan_profile_name(scan_profile_t profile)
+{
+    return profile < SCAN_PROFILE_COUNT ? profile_names[profile] : "?";
+}
@@ -0,0 +1,82 @@
+#ifndef SCAN_POLICY_H
+#define SCAN_POLICY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "vacuum_sm.h"
+
+#define SCAN_BURST_US       5000000     // High-duty scanning after a tool appears
+#define SCAN_TOOL_LOST_US   30000000    // No advert from a tool for this long: tool lost
+
+/**
+ * @brief Scan profiles, from lowest to highest radio load
+ */
+typedef enum {
+    SCAN_PROFILE_IDLE,      // No tool around: low-duty passive scanning
+    SCAN_PROFILE_STANDBY,   // Tool in range but idle
+    SCAN_PROFILE_BURST,     // A tool just appeared: learn its state quickly
+    SCAN_PROFILE_TRACK,     // Vacuum running: never miss the power-off
+    SCAN_PROFILE_COUNT
+} scan_profile_t;
+
+/**
+ * @brief GAP discovery parameters of a profile (interval/window in 0.625 ms units)
+ */
+typedef struct {
+    uint16_t itvl;
+    uint16_t window;
+    uint8_t passive;            // AWS state is in the advert itself, scan responses are unused
+    uint8_t filter_duplicates;  // Off: liveness needs every advert
+} scan_params_t;
+
+/**
+ * @brief Scan profile selection, driven by the vacuum state machine
+ */
+typedef struct {
+    vacuum_state_t state;       // Last vacuum state seen
+    int64_t burst_until_us;     // BURST profile until this time
+    scan_profile_t profile;     // Profile currently applied to the controller
+    uint32_t switches;          // Profile changes applied
+} scan_policy_t;
+
+/**
+ * @brief Start in the IDLE profile
+ * @param p Policy
+ */
+void scan_policy_init(scan_policy_t *p);
+
+/**
+ * @brief Feed a vacuum state; leaving IDLE starts a burst
+ * @param p Policy
+ * @param state Current vacuum state
+ * @param now_us Current time
+ */
+void scan_policy_set_state(scan_policy_t *p, vacuum_state_t state, int64_t now_us);
+
+/**
+ * @brief Profile the controller should be running now
+ * @param p Policy
+ * @param now_us Current time
+ * @return Wanted profile
+ */
+scan_profile_t scan_policy_select(const scan_policy_t *p, int64_t now_us);
+
+/**
+ * @brief When the selected profile may next change without a new input
+ * @param p Policy
+ * @param now_us Current time
+ * @return Deadline in us, INT64_MAX if none
+ */
+int64_t scan_policy_next_deadline(const scan_policy_t *p, int64_t now_us);
+
+/**
+ * @brief GAP parameters of a profile
+ */
+const scan_params_t *scan_profile_params(scan_profile_t profile);
+
+/**
+ * @brief Profile name for logging
+ */
+const char *scan_profile_name(scan_profile_t profile);
+
+#endif // SCAN_POLICY_H
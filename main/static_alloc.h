@@ -0,0 +1,94 @@
+#ifndef STATIC_ALLOC_H
+#define STATIC_ALLOC_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+#include "freertos/event_groups.h"
+
+// Storage for the firmware's FreeRTOS objects. With
+// CONFIG_VACUUM_STATIC_ALLOC every long-lived task, queue, timer, mutex and
+// event group is placed in .bss with its size fixed at build time. That
+// leaves it out of the heap and makes it show up in the link map, and so in
+// the RAM budget report (tools/ram_budget.py). Without it the *_STORAGE
+// macros expand to nothing and the *_CREATE macros to the usual
+// heap-allocating calls.
+//
+//   STATIC_TASK_STORAGE(dlog, DLOG_TASK_STACK)          at file scope
+//   STATIC_TASK_CREATE(dlog, dlog_task, "dlog", DLOG_TASK_STACK, NULL, 1,
+//                      &handle, tskNO_AFFINITY)         returns pdPASS
+
+#ifdef CONFIG_VACUUM_STATIC_ALLOC
+
+// ESP-IDF stack sizes are in bytes and StackType_t is a byte
+#define STATIC_TASK_STORAGE(id, stack_bytes) \
+    static StackType_t id##_stack[stack_bytes]; \
+    static StaticTask_t id##_tcb;
+
+static inline BaseType_t static_task_create(TaskFunction_t fn, const char *name, uint32_t stack_bytes,
+                                            void *arg, UBaseType_t prio, TaskHandle_t *handle,
+                                            BaseType_t core, StackType_t *stack, StaticTask_t *tcb)
+{
+    TaskHandle_t h = xTaskCreateStaticPinnedToCore(fn, name, stack_bytes, arg, prio, stack, tcb, core);
+    if (handle) {
+        *handle = h;
+    }
+    return h ? pdPASS : pdFAIL;
+}
+
+#define STATIC_TASK_CREATE(id, fn, name, stack_bytes, arg, prio, handle, core) \
+    static_task_create((fn), (name), sizeof(id##_stack), (arg), (prio), (handle), (core), \
+                       id##_stack, &id##_tcb)
+
+#define STATIC_QUEUE_STORAGE(id, len, item_size) \
+    static uint8_t id##_items[(len) * (item_size)]; \
+    static StaticQueue_t id##_queue;
+
+#define STATIC_QUEUE_CREATE(id, len, item_size) \
+    xQueueCreateStatic((len), (item_size), id##_items, &id##_queue)
+
+#define STATIC_EVENT_GROUP_STORAGE(id) \
+    static StaticEventGroup_t id##_group;
+
+#define STATIC_EVENT_GROUP_CREATE(id) \
+    xEventGroupCreateStatic(&id##_group)
+
+#define STATIC_MUTEX_STORAGE(id) \
+    static StaticSemaphore_t id##_mutex;
+
+#define STATIC_MUTEX_CREATE(id) \
+    xSemaphoreCreateMutexStatic(&id##_mutex)
+
+#define STATIC_TIMER_STORAGE(id) \
+    static StaticTimer_t id##_timer;
+
+#define STATIC_TIMER_CREATE(id, name, period, reload, timer_id, cb) \
+    xTimerCreateStatic((name), (period), (reload), (timer_id), (cb), &id##_timer)
+
+#else
+
+#define STATIC_TASK_STORAGE(id, stack_bytes)
+#define STATIC_TASK_CREATE(id, fn, name, stack_bytes, arg, prio, handle, core) \
+    xTaskCreatePinnedToCore((fn), (name), (stack_bytes), (arg), (prio), (handle), (core))
+
+#define STATIC_QUEUE_STORAGE(id, len, item_size)
+#define STATIC_QUEUE_CREATE(id, len, item_size) \
+    xQueueCreate((len), (item_size))
+
+#define STATIC_EVENT_GROUP_STORAGE(id)
+#define STATIC_EVENT_GROUP_CREATE(id) \
+    xEventGroupCreate()
+
+#define STATIC_MUTEX_STORAGE(id)
+#define STATIC_MUTEX_CREATE(id) \
+    xSemaphoreCreateMutex()
+
+#define STATIC_TIMER_STORAGE(id)
+#define STATIC_TIMER_CREATE(id, name, period, reload, timer_id, cb) \
+    xTimerCreate((name), (period), (reload), (timer_id), (cb))
+
+#endif // CONFIG_VACUUM_STATIC_ALLOC
+
+#endif // STATIC_ALLOC_H
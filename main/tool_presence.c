@@ -0,0 +1,291 @@
+#include "tool_presence.h"
+#include <string.h>
+#include "lat_trace.h"
+#include "boot_prof.h"
+#include "esp_log.h"
+
+static const char *TAG = "TOOL_PRESENCE";
+
+void tool_presence_cfg_default(tool_presence_cfg_t *cfg)
+{
+    *cfg = (tool_presence_cfg_t){
+        .power_off_delay_us = AWS_POWER_OFF_DELAY_US,
+        .prestart_rssi_jump_db = CONFIG_VACUUM_PRESTART_RSSI_JUMP_DB,
+        .prestart_window_us = PRESTART_WINDOW_US,
+#ifdef CONFIG_VACUUM_PRESTART_SPINUP
+        .prestart_spinup = true,
+#endif
+    };
+}
+
+void tool_presence_init(tool_presence_t *p, const tool_presence_cfg_t *cfg,
+                        const tool_presence_timers_t *timers)
+{
+    *p = (tool_presence_t){ .cfg = *cfg, .timers = *timers };
+    tool_registry_init(&p->registry);
+    scan_policy_init(&p->scan);
+    prestart_init(&p->prestart);
+}
+
+static void set_bits(tool_presence_t *p, EventBits_t bits, bool set)
+{
+    if (p->cfg.events) {
+        if (set) {
+            xEventGroupSetBits(p->cfg.events, bits);
+        } else {
+            xEventGroupClearBits(p->cfg.events, bits);
+        }
+    }
+}
+
+static void schedule_scan_timer(tool_presence_t *p, int64_t now)
+{
+    int64_t next = scan_policy_next_deadline(&p->scan, now);
+    // A powered tool is never lost: the manual hold can outlast
+    // SCAN_TOOL_LOST_US, and the power-off path reschedules the check
+    if (p->tool_detected && !p->tool_powered && p->last_candidate_us + SCAN_TOOL_LOST_US < next) {
+        next = p->last_candidate_us + SCAN_TOOL_LOST_US;
+    }
+    if (next == INT64_MAX || (p->scan_timer_armed && p->scan_timer_at_us <= next)) {
+        // Nothing due, or the pending expiry comes first and reschedules
+        return;
+    }
+
+    if (p->scan_timer_armed) {
+        p->timer_calls++;
+        esp_timer_stop(p->timers.scan);
+    }
+    p->timer_calls++;
+    p->scan_timer_armed = true;
+    p->scan_timer_at_us = next;
+    esp_timer_start_once(p->timers.scan, next > now ? (uint64_t)(next - now) : 1);
+}
+
+// Switch to the profile the policy wants now
+static void apply_scan_policy(tool_presence_t *p, int64_t now)
+{
+    scan_profile_t profile = scan_policy_select(&p->scan, now);
+    if (profile != p->scan.profile) {
+        scan_profile_t from = p->scan.profile;
+        ESP_LOGI(TAG, "📡 Scan profile %s -> %s", scan_profile_name(from), scan_profile_name(profile));
+        p->scan.profile = profile;
+        p->scan.switches++;
+        if (p->cfg.scan_profile_cb) {
+            p->cfg.scan_profile_cb(from, profile, p->cfg.ctx);
+        }
+    }
+    schedule_scan_timer(p, now);
+}
+
+// Adverts only move the per-tool deadlines forward; the one-shot timer is
+// armed when none is pending and, when it fires while a tool is still
+// running, re-armed for the earliest remaining deadline
+static void arm_power_off_timer(tool_presence_t *p, uint64_t timeout_us)
+{
+    if (!p->power_off_armed) {
+        p->power_off_armed = true;
+        p->timer_calls++;
+        esp_timer_start_once(p->timers.power_off, timeout_us);
+    }
+}
+
+// After anything that may change the number of driving tools, so the
+// published state snapshot follows it
+static void note_driving_tools(tool_presence_t *p, int64_t now)
+{
+    if (p->registry.driving != p->driving_posted) {
+        p->driving_posted = p->registry.driving;
+        vacuum_sm_post(VACUUM_EVENT_TOOLS_CHANGED, now);
+    }
+}
+
+static void set_detected(tool_presence_t *p, int64_t now)
+{
+    if (!p->tool_detected) {
+        p->tool_detected = true;
+        set_bits(p, BT_CONNECTED_BIT, true);
+        vacuum_sm_post(VACUUM_EVENT_TOOL_DETECTED, now);
+        schedule_scan_timer(p, now);
+    }
+}
+
+static void prestart_hold(tool_presence_t *p, bool hold)
+{
+    if (p->cfg.prestart_hold_cb) {
+        p->cfg.prestart_hold_cb(hold, p->cfg.ctx);
+    }
+}
+
+// A new window holds the platform awake (and spins the vacuum up if
+// configured) until the tool starts or the window runs out
+static void prestart_begin(tool_presence_t *p, int64_t now)
+{
+    if (!prestart_cue(&p->prestart, now, p->cfg.prestart_window_us)) {
+        return;     // Window extended, the timer re-arms itself
+    }
+    prestart_hold(p, true);
+    if (p->cfg.prestart_spinup) {
+        vacuum_sm_post(VACUUM_EVENT_PRESTART, now);
+    }
+    if (!p->prestart_timer_armed) {
+        p->prestart_timer_armed = true;
+        p->timer_calls++;
+        esp_timer_start_once(p->timers.prestart, p->cfg.prestart_window_us);
+    }
+}
+
+tool_presence_seen_t tool_presence_process(tool_presence_t *p, const uint8_t *addr, int8_t rssi,
+                                           const uint8_t *data, uint8_t len, int64_t rx_us)
+{
+    tool_presence_seen_t seen = { 0 };
+    uint32_t hash = aws_adv_hash(data, len);
+
+    // Stage 3: a repeat keeps the tool's decoded state. The hash only
+    // rejects quickly; the bytes decide, so a collision cannot hide an
+    // idle -> active change.
+    tool_entry_t *tool = tool_registry_lookup(&p->registry, addr);
+    seen.known = tool != NULL;
+    seen.repeat = seen.known && tool->payload_len == len && tool->payload_hash == hash &&
+                  memcmp(tool->payload, data, len) == 0;
+    if (seen.repeat) {
+        seen.adv.active = tool->payload_active;
+    } else if (!aws_adv_decode(data, len, &seen.adv)) {
+        lat_trace_record(LAT_STAGE_PARSE, rx_us);
+        return seen;
+    }
+    lat_trace_record(LAT_STAGE_PARSE, rx_us);
+    seen.aws = true;
+    bool active = seen.adv.active;
+
+    // The tool's previous advert, for pre-start cues
+    int8_t prev_rssi = seen.known ? tool->rssi : rssi;
+    bool was_active = seen.known && tool->payload_active;
+
+    // Stage 4: an advert only moves the tool's deadline; the power-off
+    // timer is touched only when none is pending
+    tool = tool_registry_seen(&p->registry, addr, rssi, active, rx_us, p->cfg.power_off_delay_us);
+    tool->payload_hash = hash;
+    tool->payload_len = len <= TOOL_PAYLOAD_MAX ? len : 0;     // Longer ones are always decoded
+    tool->payload_active = active;
+    memcpy(tool->payload, data, tool->payload_len);
+    seen.may_drive = tool_registry_may_drive(&p->registry, tool);
+    note_driving_tools(p, rx_us);
+
+    // Unpaired tools are tracked but never drive the vacuum
+    if (!seen.may_drive) {
+        return seen;
+    }
+    p->last_candidate_us = rx_us;
+    if (!p->tool_detected) {
+        set_detected(p, rx_us);
+        boot_prof_mark(BOOT_MS_FIRST_DETECTION, rx_us);
+    }
+
+    if (p->timers.prestart && seen.known && !active && !p->tool_powered &&
+        prestart_is_cue(was_active, !seen.repeat, prev_rssi, rssi, p->cfg.prestart_rssi_jump_db)) {
+        prestart_begin(p, rx_us);
+    }
+
+    if (active) {
+        if (!p->tool_powered) {
+            if (p->timers.prestart && prestart_hit(&p->prestart, rx_us)) {
+                prestart_hold(p, false);
+            }
+            p->tool_powered = true;
+            set_bits(p, TOOL_POWER_ON_BIT, true);
+            vacuum_sm_post(VACUUM_EVENT_TOOL_POWER_ON, rx_us);
+            lat_trace_record(LAT_STAGE_POST, rx_us);
+        }
+        arm_power_off_timer(p, p->cfg.power_off_delay_us);
+    }
+    return seen;
+}
+
+void tool_presence_power_off_expired(tool_presence_t *p, int64_t now_us)
+{
+    p->power_off_armed = false;
+    tool_registry_expire(&p->registry, now_us);
+    note_driving_tools(p, now_us);
+    int64_t next = tool_registry_next_deadline(&p->registry);
+    if (p->manual_until_us > now_us && p->manual_until_us < next) {
+        next = p->manual_until_us;
+    }
+
+    if (next != INT64_MAX) {
+        // A tool is still running - wait for the earliest deadline instead
+        arm_power_off_timer(p, (uint64_t)(next - now_us));
+    } else if (p->tool_powered) {
+        ESP_LOGI(TAG, "⏰ AWS tool power-off delay expired - deactivating vacuum");
+        set_bits(p, TOOL_POWER_ON_BIT, false);
+        p->tool_powered = false;
+        vacuum_sm_post(VACUUM_EVENT_TOOL_POWER_OFF, now_us);
+        schedule_scan_timer(p, now_us);
+    }
+}
+
+void tool_presence_scan_expired(tool_presence_t *p, int64_t now_us)
+{
+    p->scan_timer_armed = false;
+    if (p->tool_detected && !p->tool_powered && now_us - p->last_candidate_us >= SCAN_TOOL_LOST_US) {
+        ESP_LOGI(TAG, "📴 No AWS tool seen for %d s - tool lost", SCAN_TOOL_LOST_US / 1000000);
+        p->tool_detected = false;
+        set_bits(p, BT_CONNECTED_BIT, false);
+        vacuum_sm_post(VACUUM_EVENT_TOOL_LOST, now_us);
+    }
+    apply_scan_policy(p, now_us);
+}
+
+void tool_presence_prestart_expired(tool_presence_t *p, int64_t now_us)
+{
+    p->prestart_timer_armed = false;
+    if (prestart_expire(&p->prestart, now_us)) {
+        prestart_hold(p, false);
+        if (p->cfg.prestart_spinup) {
+            vacuum_sm_post(VACUUM_EVENT_PRESTART_CANCEL, now_us);
+        }
+    } else if (p->prestart.armed_at_us) {
+        // Later cues moved the end of the window
+        p->prestart_timer_armed = true;
+        p->timer_calls++;
+        esp_timer_start_once(p->timers.prestart, p->prestart.armed_until_us - now_us);
+    }
+}
+
+void tool_presence_manual_on(tool_presence_t *p, int64_t now_us, int64_t hold_us)
+{
+    set_bits(p, TOOL_POWER_ON_BIT | BT_CONNECTED_BIT, true);
+    p->last_candidate_us = now_us;
+    set_detected(p, now_us);
+    if (!p->tool_powered) {
+        p->tool_powered = true;
+        vacuum_sm_post(VACUUM_EVENT_TOOL_POWER_ON, now_us);
+    }
+
+    // Held like an active advert; an earlier pending expiry re-arms for it
+    p->manual_until_us = now_us + hold_us;
+    arm_power_off_timer(p, hold_us);
+}
+
+void tool_presence_follow_state(tool_presence_t *p, vacuum_state_t state, int64_t now_us)
+{
+    if (state != p->scan.state) {
+        scan_policy_set_state(&p->scan, state, now_us);
+        apply_scan_policy(p, now_us);
+    }
+}
+
+int tool_presence_pair_active(tool_presence_t *p, int64_t now_us)
+{
+    // Tools that stopped since the last timer expiry are not running any more
+    tool_registry_expire(&p->registry, now_us);
+    int added = tool_registry_pair_active(&p->registry);
+    note_driving_tools(p, now_us);
+    return added;
+}
+
+void tool_presence_unpair_all(tool_presence_t *p, int64_t now_us)
+{
+    tool_registry_expire(&p->registry, now_us);
+    tool_registry_unpair_all(&p->registry);
+    note_driving_tools(p, now_us);
+}
@@ -0,0 +1,173 @@
+#ifndef TOOL_PRESENCE_H
+#define TOOL_PRESENCE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "esp_timer.h"
+#include "vacuum_sm.h"
+#include "tool_registry.h"
+#include "scan_policy.h"
+#include "prestart.h"
+#include "aws_adv.h"
+
+// Event group bits mirroring the levels posted to the state machine
+#define TOOL_POWER_ON_BIT BIT0
+#define BT_CONNECTED_BIT BIT1
+
+/**
+ * @brief Presence tracker parameters and platform hooks
+ */
+typedef struct {
+    int64_t power_off_delay_us;     // Run-on after a tool's last active advert
+    int prestart_rssi_jump_db;      // RSSI rise that counts as a pre-start cue
+    int64_t prestart_window_us;     // How long a cue waits for the active advert
+    bool prestart_spinup;           // Post VACUUM_EVENT_PRESTART for a new window
+    EventGroupHandle_t events;      // Gets TOOL_POWER_ON_BIT/BT_CONNECTED_BIT, or NULL
+
+    /**
+     * @brief The scan policy switched profile; restart discovery with it (or NULL)
+     */
+    void (*scan_profile_cb)(scan_profile_t from, scan_profile_t to, void *ctx);
+
+    /**
+     * @brief A pre-start window opened (true) or closed (false) (or NULL)
+     */
+    void (*prestart_hold_cb)(bool hold, void *ctx);
+    void *ctx;
+} tool_presence_cfg_t;
+
+/**
+ * @brief The one-shot esp_timers the tracker drives
+ *
+ * Created by the platform, whose callbacks take the caller's lock and call
+ * the matching tool_presence_*_expired().
+ */
+typedef struct {
+    esp_timer_handle_t power_off;
+    esp_timer_handle_t scan;
+    esp_timer_handle_t prestart;    // NULL: no pre-start
+} tool_presence_timers_t;
+
+/**
+ * @brief What an advert did, for the caller's counters and log
+ */
+typedef struct {
+    bool aws;                       // AWS advert; false: rejected by the decode
+    bool known;                     // The tool was already tracked
+    bool repeat;                    // Same payload as its last advert, not decoded
+    bool may_drive;                 // Paired (or no tool is) and inside the radius
+    aws_adv_t adv;                  // Decoded advert; only .active is set for a repeat
+} tool_presence_seen_t;
+
+/**
+ * @brief AWS tool presence and power state behind the state machine's tool events
+ *
+ * The BLE manager's logic from the decoded advert to the posted events: the
+ * tool registry, tool detected/lost and power on/off edges, the per-tool
+ * power-off deadlines behind one lazily re-armed timer, the manual hold, the
+ * scan profile and its timer, and the pre-start predictor. Only the timers,
+ * the radio and the locking are the platform's. Not thread safe: callers
+ * serialize every call, the timer callbacks' included.
+ */
+typedef struct {
+    tool_registry_t registry;
+    scan_policy_t scan;
+    prestart_t prestart;
+    tool_presence_cfg_t cfg;
+    tool_presence_timers_t timers;
+
+    bool tool_detected;             // Level of TOOL_DETECTED/TOOL_LOST
+    bool tool_powered;              // Level of TOOL_POWER_ON/TOOL_POWER_OFF
+    bool power_off_armed;
+    bool scan_timer_armed;
+    bool prestart_timer_armed;
+    int64_t scan_timer_at_us;
+    int64_t last_candidate_us;      // Last advert from a tool that may drive
+    int64_t manual_until_us;        // tool_presence_manual_on() hold
+    uint8_t driving_posted;         // registry.driving last reported to the state machine
+    uint32_t timer_calls;           // esp_timer start/stop calls (power-off, scan, pre-start)
+} tool_presence_t;
+
+/**
+ * @brief Default parameters: AWS_POWER_OFF_DELAY_US and the pre-start options, no hooks
+ * @param cfg Parameters
+ */
+void tool_presence_cfg_default(tool_presence_cfg_t *cfg);
+
+/**
+ * @brief Reset the tracker with an empty registry and the scan policy in IDLE
+ * @param p Tracker
+ * @param cfg Parameters (copied)
+ * @param timers Timers the tracker starts and stops
+ */
+void tool_presence_init(tool_presence_t *p, const tool_presence_cfg_t *cfg,
+                        const tool_presence_timers_t *timers);
+
+/**
+ * @brief Stages 3-4 of the advert pipeline for an advert that passed aws_adv_prefilter()
+ *
+ * A tool repeating its last payload keeps its decoded state; anything else
+ * (new tool, idle <-> active) gets the full decode. AWS adverts then update
+ * the registry and post the edge events, stamped with the advert's arrival.
+ * The one path from a received advert to the state machine, for the BLE
+ * manager and the host tools alike.
+ *
+ * @param p Tracker
+ * @param addr BLE address
+ * @param rssi Advert RSSI
+ * @param data Raw AD bytes
+ * @param len Number of AD bytes
+ * @param rx_us Advert arrival
+ * @return What the advert did
+ */
+tool_presence_seen_t tool_presence_process(tool_presence_t *p, const uint8_t *addr, int8_t rssi,
+                                           const uint8_t *data, uint8_t len, int64_t rx_us);
+
+/**
+ * @brief Power-off timer expiry
+ *
+ * Re-arms for the earliest remaining deadline while a tool is still running,
+ * otherwise posts TOOL_POWER_OFF.
+ */
+void tool_presence_power_off_expired(tool_presence_t *p, int64_t now_us);
+
+/**
+ * @brief Scan timer expiry: end of a burst, or the tool-lost check
+ */
+void tool_presence_scan_expired(tool_presence_t *p, int64_t now_us);
+
+/**
+ * @brief Pre-start timer expiry: close the window unless cues extended it
+ */
+void tool_presence_prestart_expired(tool_presence_t *p, int64_t now_us);
+
+/**
+ * @brief Act as if a tool were running for hold_us
+ * @param p Tracker
+ * @param now_us Current time
+ * @param hold_us How long the manual power-on holds
+ */
+void tool_presence_manual_on(tool_presence_t *p, int64_t now_us, int64_t hold_us);
+
+/**
+ * @brief Let the scan policy follow the vacuum state machine
+ * @param p Tracker
+ * @param state Current vacuum state
+ * @param now_us Current time
+ */
+void tool_presence_follow_state(tool_presence_t *p, vacuum_state_t state, int64_t now_us);
+
+/**
+ * @brief Pair every tool that is running now
+ * @return Number of tools newly paired
+ */
+int tool_presence_pair_active(tool_presence_t *p, int64_t now_us);
+
+/**
+ * @brief Clear the allow-list
+ */
+void tool_presence_unpair_all(tool_presence_t *p, int64_t now_us);
+
+#endif // TOOL_PRESENCE_H
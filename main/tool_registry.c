@@ -0,0 +1,278 @@
+#include "tool_registry.h"
+#include <string.h>
+
+static uint32_t addr_hash(const uint8_t *addr)
+{
+    uint32_t x = (uint32_t)addr[0] | (uint32_t)addr[1] << 8 |
+                 (uint32_t)addr[2] << 16 | (uint32_t)addr[3] << 24;
+    x ^= ((uint32_t)addr[4] | (uint32_t)addr[5] << 8) * 0x85EBCA6Bu;
+    x *= 0x9E3779B1u;
+    return x >> (32 - TOOL_REGISTRY_INDEX_BITS);
+}
+
+// Index slot holding addr, or the empty slot where it would be inserted
+static unsigned index_probe(const tool_registry_t *reg, const uint8_t *addr, bool *found)
+{
+    unsigned slot = addr_hash(addr);
+    for (;;) {
+        uint8_t e = reg->index[slot];
+        if (e == TOOL_NONE) {
+            *found = false;
+            return slot;
+        }
+        if (memcmp(reg->entries[e].addr, addr, 6) == 0) {
+            *found = true;
+            return slot;
+        }
+        slot = (slot + 1) & (TOOL_REGISTRY_INDEX_SIZE - 1);
+    }
+}
+
+// Linear-probing delete with backward shift, so no tombstones are needed
+static void index_remove(tool_registry_t *reg, unsigned slot)
+{
+    unsigned hole = slot;
+    unsigned next = (slot + 1) & (TOOL_REGISTRY_INDEX_SIZE - 1);
+
+    while (reg->index[next] != TOOL_NONE) {
+        unsigned home = addr_hash(reg->entries[reg->index[next]].addr);
+        // Move the entry into the hole unless its home lies cyclically in (hole, next]
+        bool stays = (hole <= next) ? (home > hole && home <= next)
+                                    : (home > hole || home <= next);
+        if (!stays) {
+            reg->index[hole] = reg->index[next];
+            hole = next;
+        }
+        next = (next + 1) & (TOOL_REGISTRY_INDEX_SIZE - 1);
+    }
+    reg->index[hole] = TOOL_NONE;
+}
+
+static void lru_unlink(tool_registry_t *reg, uint8_t e)
+{
+    tool_entry_t *t = &reg->entries[e];
+    if (t->lru_prev != TOOL_NONE) {
+        reg->entries[t->lru_prev].lru_next = t->lru_next;
+    } else {
+        reg->lru_head = t->lru_next;
+    }
+    if (t->lru_next != TOOL_NONE) {
+        reg->entries[t->lru_next].lru_prev = t->lru_prev;
+    } else {
+        reg->lru_tail = t->lru_prev;
+    }
+}
+
+static void lru_push_front(tool_registry_t *reg, uint8_t e)
+{
+    tool_entry_t *t = &reg->entries[e];
+    t->lru_prev = TOOL_NONE;
+    t->lru_next = reg->lru_head;
+    if (reg->lru_head != TOOL_NONE) {
+        reg->entries[reg->lru_head].lru_prev = e;
+    } else {
+        reg->lru_tail = e;
+    }
+    reg->lru_head = e;
+}
+
+static bool addr_is_paired(const tool_registry_t *reg, const uint8_t *addr)
+{
+    for (int i = 0; i < reg->paired_count; i++) {
+        if (memcmp(reg->paired[i], addr, 6) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool allowed(const tool_registry_t *reg, const tool_entry_t *tool)
+{
+    return reg->paired_count == 0 || tool->paired;
+}
+
+bool tool_registry_may_drive(const tool_registry_t *reg, const tool_entry_t *tool)
+{
+    return allowed(reg, tool) && (!reg->prox_gate || tool->prox.near);
+}
+
+static void recount_driving(tool_registry_t *reg)
+{
+    reg->driving = 0;
+    for (uint8_t e = reg->lru_head; e != TOOL_NONE; e = reg->entries[e].lru_next) {
+        if (reg->entries[e].active && tool_registry_may_drive(reg, &reg->entries[e])) {
+            reg->driving++;
+        }
+    }
+}
+
+static void set_active(tool_registry_t *reg, tool_entry_t *t, bool active)
+{
+    if (t->active == active) {
+        return;
+    }
+    t->active = active;
+    if (tool_registry_may_drive(reg, t)) {
+        if (active) {
+            reg->driving++;
+        } else {
+            reg->driving--;
+        }
+    }
+}
+
+void tool_registry_init(tool_registry_t *reg)
+{
+    memset(reg, 0, sizeof(*reg));
+    memset(reg->index, TOOL_NONE, sizeof(reg->index));
+    reg->lru_head = TOOL_NONE;
+    reg->lru_tail = TOOL_NONE;
+    proximity_cfg_default(&reg->prox_cfg);
+}
+
+void tool_registry_set_proximity(tool_registry_t *reg, const proximity_cfg_t *cfg)
+{
+    reg->prox_gate = cfg != NULL;
+    if (cfg) {
+        reg->prox_cfg = *cfg;
+    }
+    recount_driving(reg);
+}
+
+tool_entry_t *tool_registry_lookup(tool_registry_t *reg, const uint8_t *addr)
+{
+    bool found;
+    unsigned slot = index_probe(reg, addr, &found);
+    return found ? &reg->entries[reg->index[slot]] : NULL;
+}
+
+tool_entry_t *tool_registry_seen(tool_registry_t *reg, const uint8_t *addr, int8_t rssi,
+                                 bool active, int64_t now_us, int64_t active_hold_us)
+{
+    bool found;
+    unsigned slot = index_probe(reg, addr, &found);
+    uint8_t e;
+
+    if (found) {
+        e = reg->index[slot];
+        lru_unlink(reg, e);
+    } else {
+        if (reg->count < TOOL_REGISTRY_CAPACITY) {
+            e = reg->count++;
+        } else {
+            // Evict the least recently seen tool and reuse its entry
+            e = reg->lru_tail;
+            set_active(reg, &reg->entries[e], false);
+            lru_unlink(reg, e);
+            bool evict_found;
+            index_remove(reg, index_probe(reg, reg->entries[e].addr, &evict_found));
+            reg->evictions++;
+            slot = index_probe(reg, addr, &found);
+        }
+        tool_entry_t *t = &reg->entries[e];
+        memset(t, 0, sizeof(*t));
+        memcpy(t->addr, addr, 6);
+        t->paired = addr_is_paired(reg, addr);
+        reg->index[slot] = e;
+    }
+
+    lru_push_front(reg, e);
+
+    tool_entry_t *t = &reg->entries[e];
+    t->rssi = rssi;
+    t->last_seen_us = now_us;
+
+    // Crossing the radius changes whether an already active tool drives
+    bool could_drive = tool_registry_may_drive(reg, t);
+    proximity_update(&t->prox, &reg->prox_cfg, rssi, now_us);
+    bool can_drive = tool_registry_may_drive(reg, t);
+    if (t->active && can_drive != could_drive) {
+        if (can_drive) {
+            reg->driving++;
+        } else {
+            reg->driving--;
+        }
+    }
+    if (active && !can_drive && allowed(reg, t)) {
+        reg->prox_rejects++;
+    }
+
+    if (active) {
+        t->active_until_us = now_us + active_hold_us;
+        set_active(reg, t, true);
+    }
+    return t;
+}
+
+void tool_registry_expire(tool_registry_t *reg, int64_t now_us)
+{
+    for (uint8_t e = reg->lru_head; e != TOOL_NONE; e = reg->entries[e].lru_next) {
+        tool_entry_t *t = &reg->entries[e];
+        if (t->active && now_us >= t->active_until_us) {
+            set_active(reg, t, false);
+        }
+    }
+}
+
+int64_t tool_registry_next_deadline(const tool_registry_t *reg)
+{
+    int64_t next = INT64_MAX;
+    for (uint8_t e = reg->lru_head; e != TOOL_NONE; e = reg->entries[e].lru_next) {
+        const tool_entry_t *t = &reg->entries[e];
+        if (t->active && tool_registry_may_drive(reg, t) && t->active_until_us < next) {
+            next = t->active_until_us;
+        }
+    }
+    return next;
+}
+
+uint8_t tool_registry_driving_tools(const tool_registry_t *reg, uint8_t (*addrs)[6], uint8_t max)
+{
+    uint8_t n = 0;
+    for (uint8_t e = reg->lru_head; e != TOOL_NONE && n < max; e = reg->entries[e].lru_next) {
+        const tool_entry_t *t = &reg->entries[e];
+        if (t->active && tool_registry_may_drive(reg, t)) {
+            memcpy(addrs[n++], t->addr, 6);
+        }
+    }
+    return reg->driving;
+}
+
+bool tool_registry_pair(tool_registry_t *reg, const uint8_t *addr)
+{
+    if (addr_is_paired(reg, addr)) {
+        return true;
+    }
+    if (reg->paired_count >= TOOL_PAIRED_MAX) {
+        return false;
+    }
+    memcpy(reg->paired[reg->paired_count++], addr, 6);
+
+    tool_entry_t *t = tool_registry_lookup(reg, addr);
+    if (t) {
+        t->paired = true;
+    }
+    recount_driving(reg);
+    return true;
+}
+
+int tool_registry_pair_active(tool_registry_t *reg)
+{
+    int added = 0;
+    for (uint8_t e = reg->lru_head; e != TOOL_NONE; e = reg->entries[e].lru_next) {
+        tool_entry_t *t = &reg->entries[e];
+        if (t->active && !t->paired && tool_registry_pair(reg, t->addr)) {
+            added++;
+        }
+    }
+    return added;
+}
+
+void tool_registry_unpair_all(tool_registry_t *reg)
+{
+    reg->paired_count = 0;
+    for (uint8_t e = reg->lru_head; e != TOOL_NONE; e = reg->entries[e].lru_next) {
+        reg->entries[e].paired = false;
+    }
+    recount_driving(reg);
+}
@@ -0,0 +1,150 @@
+#ifndef TOOL_REGISTRY_H
+#define TOOL_REGISTRY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "proximity.h"
+
+#define TOOL_REGISTRY_CAPACITY      32      // Tools tracked at once
+#define TOOL_REGISTRY_INDEX_BITS    6       // Hash index of 64 slots (load <= 0.5)
+#define TOOL_REGISTRY_INDEX_SIZE    (1 << TOOL_REGISTRY_INDEX_BITS)
+#define TOOL_PAIRED_MAX             8       // Paired tools in the allow-list
+#define TOOL_PAYLOAD_MAX            16      // Longest advert kept for repeat detection
+#define TOOL_NONE                   0xFF
+
+/**
+ * @brief One tracked tool
+ */
+typedef struct {
+    uint8_t addr[6];
+    int8_t rssi;                // RSSI of the last advert
+    proximity_t prox;           // Filtered RSSI and working-radius gate
+    bool paired;                // In the allow-list
+    bool active;                // Tool reports running
+    int64_t last_seen_us;       // Last AWS advert
+    int64_t active_until_us;    // Active state expires at this time
+    uint32_t payload_hash;      // aws_adv_hash() of the last advert
+    uint8_t payload_len;        // Its length, 0 if none or longer than TOOL_PAYLOAD_MAX
+    bool payload_active;        // Its decoded tool state
+    uint8_t payload[TOOL_PAYLOAD_MAX];  // The advert itself, payload_len bytes
+    uint8_t lru_prev;           // LRU list links (entry indices)
+    uint8_t lru_next;
+} tool_entry_t;
+
+/**
+ * @brief Fixed-capacity, allocation-free registry of AWS tools in range
+ *
+ * Entries are found through an open-addressing hash index keyed by BLE
+ * address and kept on an LRU list; when the registry is full the least
+ * recently seen tool is evicted. Not thread safe: callers serialize access.
+ */
+typedef struct {
+    tool_entry_t entries[TOOL_REGISTRY_CAPACITY];
+    uint8_t index[TOOL_REGISTRY_INDEX_SIZE];    // Entry index or TOOL_NONE
+    uint8_t count;
+    uint8_t lru_head;                           // Most recently seen
+    uint8_t lru_tail;                           // Eviction candidate
+    uint8_t paired[TOOL_PAIRED_MAX][6];
+    uint8_t paired_count;
+    uint8_t driving;                            // Active tools allowed to drive the vacuum
+    uint32_t evictions;
+    proximity_cfg_t prox_cfg;
+    bool prox_gate;                             // Only tools inside the radius drive
+    uint32_t prox_rejects;                      // Active adverts from paired tools outside it
+} tool_registry_t;
+
+/**
+ * @brief Empty the registry and the allow-list
+ *
+ * RSSI is filtered with the default proximity parameters but the gate is off.
+ *
+ * @param reg Registry
+ */
+void tool_registry_init(tool_registry_t *reg);
+
+/**
+ * @brief Only let tools inside the working radius drive the vacuum
+ * @param reg Registry
+ * @param cfg Gate parameters, or NULL to let tools drive at any distance
+ */
+void tool_registry_set_proximity(tool_registry_t *reg, const proximity_cfg_t *cfg);
+
+/**
+ * @brief Find a tool by address
+ * @param reg Registry
+ * @param addr BLE address
+ * @return Entry or NULL
+ */
+tool_entry_t *tool_registry_lookup(tool_registry_t *reg, const uint8_t *addr);
+
+/**
+ * @brief Record an AWS advert from a tool, inserting it if needed
+ *
+ * Active adverts extend the tool's active state by active_hold_us. Every
+ * advert updates the tool's filtered RSSI and proximity gate.
+ *
+ * @param reg Registry
+ * @param addr BLE address
+ * @param rssi Advert RSSI
+ * @param active Tool reported running
+ * @param now_us Advert time
+ * @param active_hold_us How long an active advert keeps the tool active
+ * @return The tool's entry
+ */
+tool_entry_t *tool_registry_seen(tool_registry_t *reg, const uint8_t *addr, int8_t rssi,
+                                 bool active, int64_t now_us, int64_t active_hold_us);
+
+/**
+ * @brief Clear the active state of tools whose hold time has passed
+ * @param reg Registry
+ * @param now_us Current time
+ */
+void tool_registry_expire(tool_registry_t *reg, int64_t now_us);
+
+/**
+ * @brief Earliest time an active tool that may drive the vacuum expires
+ * @param reg Registry
+ * @return Deadline in us, INT64_MAX if no such tool is active
+ */
+int64_t tool_registry_next_deadline(const tool_registry_t *reg);
+
+/**
+ * @brief Addresses of the active tools that may drive the vacuum
+ * @param reg Registry
+ * @param addrs Destination, most recently seen first
+ * @param max Addresses that fit in addrs
+ * @return Number of such tools (reg->driving), which may exceed max
+ */
+uint8_t tool_registry_driving_tools(const tool_registry_t *reg, uint8_t (*addrs)[6], uint8_t max);
+
+/**
+ * @brief Whether a tool may drive the vacuum
+ *
+ * With an empty allow-list every tool may (unpaired setup); otherwise only
+ * paired tools do. With the proximity gate on, the tool must also be inside
+ * the working radius.
+ */
+bool tool_registry_may_drive(const tool_registry_t *reg, const tool_entry_t *tool);
+
+/**
+ * @brief Add an address to the allow-list
+ * @param reg Registry
+ * @param addr BLE address
+ * @return true if added or already present, false if the list is full
+ */
+bool tool_registry_pair(tool_registry_t *reg, const uint8_t *addr);
+
+/**
+ * @brief Pair every tool that is currently active
+ * @param reg Registry
+ * @return Number of tools newly paired
+ */
+int tool_registry_pair_active(tool_registry_t *reg);
+
+/**
+ * @brief Clear the allow-list
+ * @param reg Registry
+ */
+void tool_registry_unpair_all(tool_registry_t *reg);
+
+#endif // TOOL_REGISTRY_H
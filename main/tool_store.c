@@ -0,0 +1,31 @@
+#include "tool_store.h"
+#include "app_config.h"
+#include "nvs.h"
+#include "esp_log.h"
+
+static const char *TAG = "TOOL_STORE";
+
+// The allow-list lives in the configuration blob (see app_config.h), which
+// is already in RAM by the time the BLE manager starts
+esp_err_t tool_store_load(tool_registry_t *reg)
+{
+    const app_config_t *cfg = app_config();
+
+    if (cfg->paired_count == 0) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    for (uint8_t i = 0; i < cfg->paired_count; i++) {
+        tool_registry_pair(reg, cfg->paired[i]);
+    }
+    ESP_LOGI(TAG, "Loaded %u paired tools", cfg->paired_count);
+    return ESP_OK;
+}
+
+esp_err_t tool_store_save(const uint8_t (*paired)[6], uint8_t count)
+{
+    esp_err_t ret = app_config_set_paired(paired, count);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save paired tools: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
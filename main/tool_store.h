@@ -0,0 +1,22 @@
+#ifndef TOOL_STORE_H
+#define TOOL_STORE_H
+
+#include "esp_err.h"
+#include "tool_registry.h"
+
+/**
+ * @brief Load the paired-tool allow-list from the configuration into the registry
+ * @param reg Registry
+ * @return ESP_OK on success, ESP_ERR_NVS_NOT_FOUND if no tool is paired
+ */
+esp_err_t tool_store_load(tool_registry_t *reg);
+
+/**
+ * @brief Save the registry's paired-tool allow-list to NVS
+ * @param paired Paired addresses
+ * @param count Number of addresses
+ * @return ESP_OK on success
+ */
+esp_err_t tool_store_save(const uint8_t (*paired)[6], uint8_t count);
+
+#endif // TOOL_STORE_H
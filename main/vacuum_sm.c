@@ -0,0 +1,206 @@
+#include "vacuum_sm.h"
+#include "esp_log.h"
+#include "led_control.h"
+#include "lat_trace.h"
+
+static const char *TAG = "MAKITA_VACUUM";
+
+static void feedback_timer_cb(void *arg)
+{
+    vacuum_sm_post(VACUUM_EVENT_FEEDBACK_DONE, esp_timer_get_time());
+}
+
+// Every relay write goes through here so trigger-to-relay latency is measured
+static void relay_set(vacuum_sm_t *sm, uint32_t level, int64_t trigger_us)
+{
+    gpio_set_level(sm->relay_gpio, level);
+    sm->relay_level = level;
+    lat_trace_record(LAT_STAGE_RELAY, trigger_us);
+
+    int64_t latency = esp_timer_get_time() - trigger_us;
+    sm->relay_writes++;
+    sm->latency_last_us = latency;
+    if (latency > sm->latency_max_us) {
+        sm->latency_max_us = latency;
+    }
+    if (latency > CONFIG_VACUUM_RELAY_LATENCY_BUDGET_US) {
+        sm->latency_budget_misses++;
+        ESP_LOGW(TAG, "Relay switched %lld us after trigger (budget %d us)",
+                 (long long)latency, CONFIG_VACUUM_RELAY_LATENCY_BUDGET_US);
+    }
+}
+
+// LED changes are deferred while the auto-mode feedback pattern is showing
+static void led_for_state(vacuum_sm_t *sm, led_pattern_t pattern)
+{
+    if (!sm->feedback_active) {
+        led_set_pattern(pattern);
+    }
+}
+
+static led_pattern_t state_pattern(vacuum_state_t state)
+{
+    switch (state) {
+        case VACUUM_STATE_STANDBY:
+            return LED_PATTERN_SLOW_BLINK;
+        case VACUUM_STATE_ACTIVE:
+            return LED_PATTERN_ON;
+        default:
+            return LED_PATTERN_OFF;
+    }
+}
+
+static void toggle_auto(vacuum_sm_t *sm, int64_t trigger_us)
+{
+    sm->auto_mode = !sm->auto_mode;
+    sm->prestarted = false;
+
+    ESP_LOGI(TAG, "🔘 Automatic mode %s",
+             sm->auto_mode ? "ENABLED" : "DISABLED");
+
+    if (sm->auto_mode) {
+        relay_set(sm, 1, trigger_us);
+    } else {
+        relay_set(sm, 0, trigger_us); // Deactivate relay
+    }
+
+    led_channel_set_pattern(LED_CHANNEL_AUX, sm->auto_mode ? LED_PATTERN_ON : LED_PATTERN_OFF);
+
+    // Visual feedback: fast blink for a while, then back to the state pattern
+    led_set_pattern(LED_PATTERN_FAST_BLINK);
+    sm->feedback_active = true;
+    if (sm->feedback_timer) {
+        esp_timer_stop(sm->feedback_timer);
+        esp_timer_start_once(sm->feedback_timer, VACUUM_FEEDBACK_DURATION_US);
+    }
+}
+
+// Run transitions for the current input levels
+static void evaluate(vacuum_sm_t *sm, int64_t trigger_us)
+{
+    switch (sm->state) {
+        case VACUUM_STATE_IDLE:
+            if (sm->tool_detected) {
+                ESP_LOGI(TAG, "Bluetooth connected - entering STANDBY mode");
+                sm->state = VACUUM_STATE_STANDBY;
+                led_for_state(sm, LED_PATTERN_SLOW_BLINK);
+            }
+            break;
+
+        case VACUUM_STATE_STANDBY:
+            if (!sm->tool_detected) {
+                ESP_LOGI(TAG, "Bluetooth disconnected - returning to IDLE");
+                sm->state = VACUUM_STATE_IDLE;
+                if (sm->prestarted) {
+                    sm->prestarted = false;
+                    relay_set(sm, 1, trigger_us);
+                }
+                led_for_state(sm, LED_PATTERN_OFF);
+            } else if (sm->tool_power) {
+                if (sm->auto_mode) {
+                    sm->state = VACUUM_STATE_ACTIVE;
+                    sm->prestarted = false;
+                    relay_set(sm, 0, trigger_us);
+                    led_for_state(sm, LED_PATTERN_ON);
+                    ESP_LOGI(TAG, "🌪️  VACUUM CLEANER ACTIVATED! 🌪️");
+                } else {
+                    ESP_LOGI(TAG, "Tool power detected but automatic mode is DISABLED - ignoring");
+                }
+            }
+            break;
+
+        case VACUUM_STATE_ACTIVE:
+            if (!sm->tool_detected) {
+                ESP_LOGI(TAG, "Bluetooth disconnected during operation - emergency stop!");
+                sm->state = VACUUM_STATE_IDLE;
+                led_for_state(sm, LED_PATTERN_OFF);
+            } else if (!sm->tool_power) {
+                sm->state = VACUUM_STATE_STANDBY;
+                relay_set(sm, 1, trigger_us); // Deactivate relay for indication
+                led_for_state(sm, LED_PATTERN_SLOW_BLINK);
+                ESP_LOGI(TAG, "🛑 VACUUM CLEANER DEACTIVATED! 🛑");
+            }
+            break;
+    }
+}
+
+esp_err_t vacuum_sm_init(vacuum_sm_t *sm, gpio_num_t relay_gpio)
+{
+    *sm = (vacuum_sm_t){
+        .state = VACUUM_STATE_IDLE,
+        .relay_gpio = relay_gpio,
+    };
+
+    esp_timer_create_args_t timer_args = {
+        .callback = feedback_timer_cb,
+        .name = "vacuum_feedback"
+    };
+    esp_err_t ret = esp_timer_create(&timer_args, &sm->feedback_timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create feedback timer: %s", esp_err_to_name(ret));
+        sm->feedback_timer = NULL;
+    }
+    return ret;
+}
+
+void vacuum_sm_restore(vacuum_sm_t *sm, bool auto_mode)
+{
+    sm->auto_mode = auto_mode;
+    sm->relay_level = auto_mode ? 1 : 0;
+    gpio_set_level(sm->relay_gpio, sm->relay_level);
+    led_channel_set_pattern(LED_CHANNEL_AUX, auto_mode ? LED_PATTERN_ON : LED_PATTERN_OFF);
+}
+
+void vacuum_sm_handle_event(vacuum_sm_t *sm, const vacuum_event_t *ev)
+{
+    switch (ev->type) {
+        case VACUUM_EVENT_TOOL_DETECTED:
+            sm->tool_detected = true;
+            break;
+        case VACUUM_EVENT_TOOL_LOST:
+            sm->tool_detected = false;
+            break;
+        case VACUUM_EVENT_TOOL_POWER_ON:
+            sm->tool_power = true;
+            break;
+        case VACUUM_EVENT_TOOL_POWER_OFF:
+            sm->tool_power = false;
+            break;
+        case VACUUM_EVENT_AUTO_TOGGLE:
+            toggle_auto(sm, ev->timestamp_us);
+            break;
+        case VACUUM_EVENT_FEEDBACK_DONE:
+            sm->feedback_active = false;
+            led_set_pattern(state_pattern(sm->state));
+            break;
+        case VACUUM_EVENT_PRESTART:
+            if (sm->state == VACUUM_STATE_STANDBY && sm->auto_mode && !sm->tool_power &&
+                !sm->prestarted) {
+                sm->prestarted = true;
+                relay_set(sm, 0, ev->timestamp_us);
+                ESP_LOGI(TAG, "🌀 Tool use expected - pre-starting vacuum");
+            }
+            break;
+        case VACUUM_EVENT_PRESTART_CANCEL:
+            if (sm->prestarted) {
+                sm->prestarted = false;
+                relay_set(sm, 1, ev->timestamp_us);
+                ESP_LOGI(TAG, "Pre-start not followed by tool power - vacuum stopped");
+            }
+            break;
+        case VACUUM_EVENT_TOOLS_CHANGED:
+            break;
+    }
+
+    vacuum_state_t prev = sm->state;
+    evaluate(sm, ev->timestamp_us);
+    if (sm->state != prev) {
+        sm->transition_us = ev->timestamp_us;
+    }
+}
+
+const char *vacuum_state_name(vacuum_state_t state)
+{
+    return state == VACUUM_STATE_IDLE ? "IDLE" :
+           state == VACUUM_STATE_STANDBY ? "STANDBY" : "ACTIVE";
+}
@@ -0,0 +1,112 @@
+#ifndef VACUUM_SM_H
+#define VACUUM_SM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "driver/gpio.h"
+#include "esp_timer.h"
+
+// Upper bound for event timestamp to relay write; misses are counted
+#ifndef CONFIG_VACUUM_RELAY_LATENCY_BUDGET_US
+#define CONFIG_VACUUM_RELAY_LATENCY_BUDGET_US 2000
+#endif
+
+// How long the auto-mode toggle feedback pattern is shown
+#define VACUUM_FEEDBACK_DURATION_US 2000000
+
+// Vacuum state
+typedef enum {
+    VACUUM_STATE_IDLE,
+    VACUUM_STATE_STANDBY,
+    VACUUM_STATE_ACTIVE
+} vacuum_state_t;
+
+// Events driving the state machine
+typedef enum {
+    VACUUM_EVENT_TOOL_DETECTED,     // First AWS advert seen
+    VACUUM_EVENT_TOOL_LOST,         // No AWS tool in range any more
+    VACUUM_EVENT_TOOL_POWER_ON,     // Tool started advertising "active"
+    VACUUM_EVENT_TOOL_POWER_OFF,    // Power-off delay expired
+    VACUUM_EVENT_AUTO_TOGGLE,       // Valid button press
+    VACUUM_EVENT_FEEDBACK_DONE,     // Auto-mode feedback pattern finished
+    VACUUM_EVENT_PRESTART,          // Tool use looks imminent: spin up early
+    VACUUM_EVENT_PRESTART_CANCEL,   // No active advert followed the pre-start
+    VACUUM_EVENT_TOOLS_CHANGED,     // Set of driving tools changed (state snapshot only)
+} vacuum_event_type_t;
+
+/**
+ * @brief Event posted to the state machine
+ */
+typedef struct {
+    vacuum_event_type_t type;
+    int64_t timestamp_us;           // esp_timer_get_time() when the trigger happened
+} vacuum_event_t;
+
+/**
+ * @brief Vacuum state machine context
+ */
+typedef struct {
+    vacuum_state_t state;
+    bool auto_mode;                 // Automatic mode (disabled on startup)
+    bool tool_detected;             // Level of TOOL_DETECTED/TOOL_LOST
+    bool tool_power;                // Level of TOOL_POWER_ON/TOOL_POWER_OFF
+    bool feedback_active;           // Auto-mode feedback owns the LED
+    bool prestarted;                // Vacuum spun up in STANDBY ahead of the tool
+    gpio_num_t relay_gpio;
+    uint8_t relay_level;            // Level last written to the relay
+    int64_t transition_us;          // Trigger time of the last state change
+    esp_timer_handle_t feedback_timer;
+
+    // Trigger-to-relay latency accounting
+    uint32_t relay_writes;
+    uint32_t latency_budget_misses;
+    int64_t latency_last_us;
+    int64_t latency_max_us;
+} vacuum_sm_t;
+
+/**
+ * @brief Post an event to the state machine
+ *
+ * Implemented by the platform (main.c queues it for the reactor).
+ * Safe to call from any task; must not block.
+ *
+ * @param type Event type
+ * @param timestamp_us Time the trigger happened (esp_timer_get_time())
+ */
+void vacuum_sm_post(vacuum_event_type_t type, int64_t timestamp_us);
+
+/**
+ * @brief Initialize the state machine in IDLE with automatic mode disabled
+ * @param sm State machine context
+ * @param relay_gpio Relay output driven by the state machine
+ * @return ESP_OK on success
+ */
+esp_err_t vacuum_sm_init(vacuum_sm_t *sm, gpio_num_t relay_gpio);
+
+/**
+ * @brief Restore automatic mode saved before a restart
+ *
+ * Sets the relay and the automatic-mode LED as toggling would, without the
+ * feedback pattern. Call after vacuum_sm_init(), before events are handled.
+ * Tool state is not restored; the BLE manager reports it afresh.
+ *
+ * @param sm State machine context
+ * @param auto_mode Automatic mode
+ */
+void vacuum_sm_restore(vacuum_sm_t *sm, bool auto_mode);
+
+/**
+ * @brief Apply one event and run any resulting transition immediately
+ * @param sm State machine context
+ * @param ev Event
+ */
+void vacuum_sm_handle_event(vacuum_sm_t *sm, const vacuum_event_t *ev);
+
+/**
+ * @brief Human readable state name
+ * @param state State
+ * @return Constant string
+ */
+const char *vacuum_state_name(vacuum_state_t state);
+
+#endif // VACUUM_SM_H
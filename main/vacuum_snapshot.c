@@ -0,0 +1,64 @@
+#include "vacuum_snapshot.h"
+#include <string.h>
+
+// The copies are stored as relaxed atomic words so concurrent reads and
+// writes are well defined; the fences order them against the counter.
+
+static void store_copy(atomic_uint *dst, const vacuum_snapshot_t *snap)
+{
+    uint32_t words[VACUUM_SNAPSHOT_WORDS] = { 0 };
+    memcpy(words, snap, sizeof(*snap));
+    for (unsigned i = 0; i < VACUUM_SNAPSHOT_WORDS; i++) {
+        atomic_store_explicit(&dst[i], words[i], memory_order_relaxed);
+    }
+}
+
+void vacuum_snapshot_init(vacuum_snapshot_latch_t *latch)
+{
+    vacuum_snapshot_t snap;
+
+    memset(&snap, 0, sizeof(snap));     // Padding included, so copies compare equal
+    snap.state = VACUUM_STATE_IDLE;
+
+    atomic_store_explicit(&latch->seq, 0, memory_order_relaxed);
+    atomic_store_explicit(&latch->retries, 0, memory_order_relaxed);
+    store_copy(latch->copies[0], &snap);
+    store_copy(latch->copies[1], &snap);
+    atomic_thread_fence(memory_order_release);
+}
+
+void vacuum_snapshot_publish(vacuum_snapshot_latch_t *latch, vacuum_snapshot_t *snap)
+{
+    unsigned seq = atomic_load_explicit(&latch->seq, memory_order_relaxed);
+    snap->version = seq / 2 + 1;
+
+    // Odd: readers use copy 1 while copy 0 is rewritten
+    atomic_store_explicit(&latch->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    store_copy(latch->copies[0], snap);
+
+    // Even: readers use the new copy 0 while copy 1 catches up
+    atomic_store_explicit(&latch->seq, seq + 2, memory_order_release);
+    atomic_thread_fence(memory_order_release);
+    store_copy(latch->copies[1], snap);
+}
+
+void vacuum_snapshot_read(vacuum_snapshot_latch_t *latch, vacuum_snapshot_t *out)
+{
+    uint32_t words[VACUUM_SNAPSHOT_WORDS];
+    unsigned seq;
+
+    for (;;) {
+        seq = atomic_load_explicit(&latch->seq, memory_order_acquire);
+        const atomic_uint *src = latch->copies[seq & 1];
+        for (unsigned i = 0; i < VACUUM_SNAPSHOT_WORDS; i++) {
+            words[i] = atomic_load_explicit(&src[i], memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&latch->seq, memory_order_relaxed) == seq) {
+            break;
+        }
+        atomic_fetch_add_explicit(&latch->retries, 1, memory_order_relaxed);
+    }
+    memcpy(out, words, sizeof(*out));
+}
@@ -0,0 +1,80 @@
+#ifndef VACUUM_SNAPSHOT_H
+#define VACUUM_SNAPSHOT_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "vacuum_sm.h"
+
+// Consistent, lock-free view of the vacuum state for readers outside the
+// reactor task (diagnostics, telemetry, other tasks). One writer publishes;
+// any number of readers on either core copy it without locks and without
+// ever making the writer wait.
+//
+// Implemented as a seqcount latch: two copies and a sequence counter. The
+// writer bumps the counter, updates the copy readers are not directed to,
+// bumps it again and updates the other. A reader copies the copy selected by
+// the counter and retries only if a whole update completed meanwhile, so
+// even a reader that interrupts the writer reads a stable copy.
+
+#define VACUUM_SNAPSHOT_TOOLS   4       // Driving tool addresses kept
+
+/**
+ * @brief Published vacuum state
+ */
+typedef struct {
+    uint32_t version;               // Publish count, set by vacuum_snapshot_publish()
+    vacuum_state_t state;
+    bool auto_mode;
+    bool tool_detected;
+    bool tool_power;
+    bool prestarted;
+    uint8_t relay_level;            // Level last written to the relay GPIO
+    uint8_t tools_active;           // Active tools allowed to drive the vacuum
+    uint8_t tools[VACUUM_SNAPSHOT_TOOLS][6];   // The first of them
+    int64_t transition_us;          // Trigger time of the last state change
+    int64_t published_us;           // Trigger time of the event that published it
+} vacuum_snapshot_t;
+
+#define VACUUM_SNAPSHOT_WORDS   ((sizeof(vacuum_snapshot_t) + 3) / 4)
+
+typedef struct {
+    atomic_uint seq;
+    atomic_uint copies[2][VACUUM_SNAPSHOT_WORDS];
+    atomic_uint retries;            // Reads repeated because an update overlapped
+} vacuum_snapshot_latch_t;
+
+/**
+ * @brief Publish an all-zero snapshot (IDLE, automatic mode off)
+ * @param latch Latch
+ */
+void vacuum_snapshot_init(vacuum_snapshot_latch_t *latch);
+
+/**
+ * @brief Publish a new snapshot (single writer)
+ *
+ * Never blocks. Sets snap->version.
+ *
+ * @param latch Latch
+ * @param snap New state
+ */
+void vacuum_snapshot_publish(vacuum_snapshot_latch_t *latch, vacuum_snapshot_t *snap);
+
+/**
+ * @brief Copy the latest snapshot (any number of readers, any core)
+ * @param latch Latch
+ * @param out Destination
+ */
+void vacuum_snapshot_read(vacuum_snapshot_latch_t *latch, vacuum_snapshot_t *out);
+
+/**
+ * @brief Read the snapshot the reactor published last
+ *
+ * Implemented by the platform (main.c publishes after every event). Safe to
+ * call from any task; never blocks.
+ *
+ * @param out Destination
+ */
+void vacuum_state_get(vacuum_snapshot_t *out);
+
+#endif // VACUUM_SNAPSHOT_H
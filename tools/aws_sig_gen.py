@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+"""Compile the AWS signature table into bit-parallel match tables.
+
+Usage: aws_sig_gen.py <signatures.txt> <out.h> [--name aws_sigs]
+
+Run by main/CMakeLists.txt and host/CMakeLists.txt whenever the table
+changes. Every signature gets one bit. For each payload offset and byte
+value the output holds the set of signatures that accept that byte there,
+and for each payload length the set of signatures of that length, so
+aws_sig_match() ANDs one word per payload byte into the length's set: the
+cost depends on the payload length only, not on the number of signatures,
+and the match has no data-dependent branches.
+"""
+
+import argparse
+import re
+import sys
+
+MAX_SIGS = 32           # Bits in a match word
+MAX_LEN = 8             # AWS_SIG_MAX_LEN in aws_adv.h
+STATES = ('present', 'active')
+NAME_RE = re.compile(r'^[A-Za-z_][A-Za-z0-9_]*$')
+BYTE_RE = re.compile(r'^([0-9a-fA-F]{2})(?:/([0-9a-fA-F]{2}))?$')
+
+
+def parse_byte(text):
+    """(value, mask) of one byte pattern"""
+    if text == '*':
+        return 0, 0
+    m = BYTE_RE.match(text)
+    if not m:
+        raise ValueError(f"bad byte pattern '{text}'")
+    value = int(m.group(1), 16)
+    mask = int(m.group(2), 16) if m.group(2) else 0xff
+    if value & ~mask:
+        raise ValueError(f"'{text}' can never match: value has bits outside the mask")
+    return value, mask
+
+
+def parse(path):
+    sigs = []
+    with open(path) as f:
+        for lineno, line in enumerate(f, 1):
+            fields = line.split('#', 1)[0].split()
+            if not fields:
+                continue
+            try:
+                if len(fields) < 3:
+                    raise ValueError("expected: name state byte...")
+                name, state, pattern = fields[0], fields[1], fields[2:]
+                if not NAME_RE.match(name):
+                    raise ValueError(f"bad name '{name}'")
+                if state not in STATES:
+                    raise ValueError(f"state must be one of {', '.join(STATES)}")
+                if len(pattern) > MAX_LEN:
+                    raise ValueError(f"longer than {MAX_LEN} bytes")
+                if any(s['name'] == name for s in sigs):
+                    raise ValueError(f"duplicate name '{name}'")
+                sigs.append({'name': name, 'active': state == 'active',
+                             'bytes': [parse_byte(b) for b in pattern]})
+            except ValueError as e:
+                sys.exit(f"{path}:{lineno}: {e}")
+    if not sigs:
+        sys.exit(f"{path}: no signatures")
+    if len(sigs) > MAX_SIGS:
+        sys.exit(f"{path}: {len(sigs)} signatures, at most {MAX_SIGS}")
+    return sigs
+
+
+def emit(sigs, name, src):
+    max_len = max(len(s['bytes']) for s in sigs)
+    min_len = min(len(s['bytes']) for s in sigs)
+    byte_bits = [[0] * 256 for _ in range(max_len)]
+    len_bits = [0] * (max_len + 1)
+    active_bits = 0
+
+    for bit, s in enumerate(sigs):
+        len_bits[len(s['bytes'])] |= 1 << bit
+        if s['active']:
+            active_bits |= 1 << bit
+        for offset, (value, mask) in enumerate(s['bytes']):
+            for b in range(256):
+                if b & mask == value:
+                    byte_bits[offset][b] |= 1 << bit
+
+    out = [f"// Generated by tools/aws_sig_gen.py from {src}; do not edit.",
+           "//"]
+    for bit, s in enumerate(sigs):
+        out.append(f"// bit {bit:2}  {s['name']:<24} {'active' if s['active'] else 'present'}")
+    guard = name.upper() + "_H"
+    out += ["",
+            f"#ifndef {guard}",
+            f"#define {guard}",
+            "",
+            '#include "aws_adv.h"',
+            "",
+            f"static const uint32_t {name}_byte_bits[{max_len}][256] = {{"]
+    for offset, row in enumerate(byte_bits):
+        out.append(f"    {{   // Offset {offset}")
+        for i in range(0, 256, 8):
+            out.append("        " + ", ".join(f"0x{v:08x}" for v in row[i:i + 8]) + ",")
+        out.append("    },")
+    out += ["};",
+            "",
+            f"static const uint32_t {name}_len_bits[{max_len + 1}] = {{",
+            "    " + ", ".join(f"0x{v:08x}" for v in len_bits) + ",",
+            "};",
+            "",
+            f"static const char *const {name}_names[{len(sigs)}] = {{"]
+    out += [f'    "{s["name"]}",' for s in sigs]
+    out += ["};",
+            "",
+            f"static const aws_sig_table_t {name} = {{",
+            f"    .byte_bits = {name}_byte_bits,",
+            f"    .len_bits = {name}_len_bits,",
+            f"    .names = {name}_names,",
+            f"    .active_bits = 0x{active_bits:08x},",
+            f"    .count = {len(sigs)},",
+            f"    .min_len = {min_len},",
+            f"    .max_len = {max_len},",
+            "};",
+            "",
+            f"#endif // {guard}",
+            ""]
+    return "\n".join(out)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument('table')
+    ap.add_argument('output')
+    ap.add_argument('--name', default='aws_sigs', help="C name of the table")
+    args = ap.parse_args()
+
+    text = emit(parse(args.table), args.name, args.table.replace('\\', '/').split('/')[-1])
+    with open(args.output, 'w') as f:
+        f.write(text)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+"""RAM budget per subsystem from the firmware's link map.
+
+Usage: ram_budget.py <project.map> [sdkconfig.json] [-o report.txt]
+
+Run after every link by the project CMakeLists.txt. Sums the internal DRAM
+(.dram0.*, .noinit) and RTC (.rtc*) input sections of every object:
+
+- firmware sources in main/ are one subsystem each, other components one
+  per library; the BT controller is split from the NimBLE host
+- "stacks" are .bss arrays named *_stack, i.e. the task stacks of
+  CONFIG_VACUUM_STATIC_ALLOC builds; their other RTOS objects count as bss
+- the NimBLE mbuf/HCI buffer pools and the IDF's own task stacks are taken
+  from sdkconfig.json, as they come from the heap at init and never appear
+  in the map
+"""
+
+import argparse
+import json
+import re
+import sys
+from collections import defaultdict
+
+OUTPUT_RE = re.compile(r'^(\.\S+)(?:\s+0x[0-9a-fA-F]+\s+0x[0-9a-fA-F]+)?\s*$')
+INPUT_RE = re.compile(r'^ (\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$')
+INPUT_NAME_RE = re.compile(r'^ (\S+)\s*$')
+WRAPPED_RE = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$')
+OBJECT_RE = re.compile(r'(?:.*/)?(lib[\w\-]+\.a)\((.+?)\)$')
+STACK_RE = re.compile(r'\.bss\.\w+_stack$')
+
+BT_CONTROLLER_LIBS = {'libbtdm_app.a', 'libbtbb.a', 'libble_app.a'}
+
+
+def subsystem(obj):
+    m = OBJECT_RE.match(obj.strip())
+    if not m:
+        return 'linker'
+    lib, member = m.groups()
+    if lib == 'libmain.a':
+        return 'main/' + re.sub(r'\.c\.obj$|\.obj$|\.o$', '', member)
+    if lib in BT_CONTROLLER_LIBS:
+        return 'BT controller'
+    if lib == 'libbt.a':
+        return 'BT host (NimBLE)'
+    return lib[3:-2]
+
+
+def memory_of(output):
+    if output.startswith('.dram0') or output == '.noinit':
+        return 'dram'
+    if output.startswith('.rtc'):
+        return 'rtc'
+    return None
+
+
+def parse_map(path):
+    """Returns {subsystem: {'data', 'bss', 'stacks', 'rtc'}} in bytes."""
+    usage = defaultdict(lambda: defaultdict(int))
+    output = None
+    pending = None
+    in_map = False
+
+    with open(path, errors='replace') as f:
+        for line in f:
+            line = line.rstrip('\n')
+            if not in_map:
+                in_map = line.startswith('Linker script and memory map')
+                continue
+            m = OUTPUT_RE.match(line)
+            if m:
+                output = m.group(1)
+                pending = None
+                continue
+            mem = memory_of(output or '')
+            if mem is None:
+                continue
+            name = size = obj = None
+            m = INPUT_RE.match(line)
+            if m:
+                name, size, obj = m.group(1), int(m.group(3), 16), m.group(4)
+            elif pending:
+                m = WRAPPED_RE.match(line)
+                if m:
+                    name, size, obj = pending, int(m.group(2), 16), m.group(3)
+                pending = None
+            else:
+                m = INPUT_NAME_RE.match(line)
+                if m and m.group(1) != '*fill*':
+                    pending = m.group(1)
+                continue
+            if name is None or size == 0 or name == '*fill*':
+                continue
+            sub = subsystem(obj)
+            if mem == 'rtc':
+                usage[sub]['rtc'] += size
+            elif STACK_RE.search(name):
+                usage[sub]['stacks'] += size
+            elif 'bss' in name or name == 'COMMON' or output == '.noinit':
+                usage[sub]['bss'] += size
+            else:
+                usage[sub]['data'] += size
+    return usage
+
+
+def heap_at_init(cfg):
+    """Heap the IDF and NimBLE take at init, from sdkconfig.json."""
+    def get(*keys):
+        for k in keys:
+            if k in cfg:
+                return int(cfg[k])
+        return 0
+
+    items = []
+    if cfg.get('BT_NIMBLE_ENABLED'):
+        msys = (get('BT_NIMBLE_MSYS_1_BLOCK_COUNT') * get('BT_NIMBLE_MSYS_1_BLOCK_SIZE') +
+                get('BT_NIMBLE_MSYS_2_BLOCK_COUNT') * get('BT_NIMBLE_MSYS_2_BLOCK_SIZE'))
+        acl = (get('BT_NIMBLE_TRANSPORT_ACL_FROM_LL_COUNT', 'BT_NIMBLE_ACL_BUF_COUNT') *
+               get('BT_NIMBLE_TRANSPORT_ACL_SIZE', 'BT_NIMBLE_ACL_BUF_SIZE'))
+        evt = ((get('BT_NIMBLE_TRANSPORT_EVT_COUNT', 'BT_NIMBLE_HCI_EVT_HI_BUF_COUNT') +
+                get('BT_NIMBLE_TRANSPORT_EVT_DISCARD_COUNT', 'BT_NIMBLE_HCI_EVT_LO_BUF_COUNT')) *
+               get('BT_NIMBLE_TRANSPORT_EVT_SIZE', 'BT_NIMBLE_HCI_EVT_BUF_SIZE'))
+        items += [('NimBLE msys mbuf pools', msys),
+                  ('NimBLE ACL buffers', acl),
+                  ('NimBLE HCI event buffers', evt),
+                  ('NimBLE host task stack', get('BT_NIMBLE_HOST_TASK_STACK_SIZE'))]
+    items += [('main task stack (until app_main returns)', get('ESP_MAIN_TASK_STACK_SIZE')),
+              ('esp_timer task stack', get('ESP_TIMER_TASK_STACK_SIZE')),
+              ('timer service task stack', get('FREERTOS_TIMER_TASK_STACK_DEPTH')),
+              ('idle task stacks', get('FREERTOS_IDLE_TASK_STACKSIZE') *
+               (1 if cfg.get('FREERTOS_UNICORE') else 2)),
+              ('system event task stack', get('ESP_SYSTEM_EVENT_TASK_STACK_SIZE'))]
+    return [(n, s) for n, s in items if s]
+
+
+def report(usage, heap, static_alloc):
+    lines = []
+    cols = ('data', 'bss', 'stacks', 'rtc')
+    lines.append('RAM budget (bytes), %s build' % ('static allocation' if static_alloc else 'heap allocation'))
+    lines.append('  %-28s %8s %8s %8s %8s %8s' % (('subsystem',) + cols + ('total',)))
+    totals = defaultdict(int)
+    rows = sorted(usage.items(), key=lambda kv: -sum(kv[1][c] for c in cols))
+    for sub, u in rows:
+        total = sum(u[c] for c in cols)
+        if total == 0:
+            continue
+        for c in cols:
+            totals[c] += u[c]
+        lines.append('  %-28s %8d %8d %8d %8d %8d' % ((sub,) + tuple(u[c] for c in cols) + (total,)))
+    lines.append('  %-28s %8d %8d %8d %8d %8d' % (('total',) + tuple(totals[c] for c in cols) +
+                                                 (sum(totals.values()),)))
+    if heap:
+        lines.append('Heap taken at init (from sdkconfig)')
+        for name, size in heap:
+            lines.append('  %-28s %8d' % (name, size))
+        lines.append('  %-28s %8d' % ('total', sum(s for _, s in heap)))
+    return '\n'.join(lines)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument('map')
+    ap.add_argument('sdkconfig', nargs='?')
+    ap.add_argument('-o', '--output', help='also write the report here')
+    args = ap.parse_args()
+
+    cfg = {}
+    if args.sdkconfig:
+        try:
+            with open(args.sdkconfig) as f:
+                cfg = json.load(f)
+        except (OSError, ValueError) as e:
+            print('ram_budget: %s: %s' % (args.sdkconfig, e), file=sys.stderr)
+
+    text = report(parse_map(args.map), heap_at_init(cfg), bool(cfg.get('VACUUM_STATIC_ALLOC')))
+    print(text)
+    if args.output:
+        with open(args.output, 'w') as f:
+            f.write(text + '\n')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())